@@ -5,37 +5,86 @@ DEFINES += "QHEXVIEW_ENABLE_DIALOGS=1"
 HEADERS += $$PWD/include/QHexView/model/commands/hexviewcommand.h \
            $$PWD/include/QHexView/model/commands/insertcommand.h \
            $$PWD/include/QHexView/model/commands/removecommand.h \
+           $$PWD/include/QHexView/model/commands/replaceallcommand.h \
            $$PWD/include/QHexView/model/commands/replacecommand.h \
            $$PWD/include/QHexView/model/buffer/qdevicebuffer.h \
            $$PWD/include/QHexView/model/buffer/qhexbuffer.h \
            $$PWD/include/QHexView/model/buffer/qmemorybuffer.h \
            $$PWD/include/QHexView/model/buffer/qmemoryrefbuffer.h \
            $$PWD/include/QHexView/model/buffer/qmappedfilebuffer.h \
+           $$PWD/include/QHexView/model/buffer/qsparsefilebuffer.h \
            $$PWD/include/QHexView/model/qhexdelegate.h \
            $$PWD/include/QHexView/model/qhexchanges.h \
            $$PWD/include/QHexView/model/qhexutils.h \
            $$PWD/include/QHexView/model/qhexcursor.h \
            $$PWD/include/QHexView/model/qhexmetadata.h \
            $$PWD/include/QHexView/model/qhexoptions.h \
+           $$PWD/include/QHexView/model/qhexprofiler.h \
            $$PWD/include/QHexView/model/qhexdocument.h \
+           $$PWD/include/QHexView/model/qhexinspector.h \
+           $$PWD/include/QHexView/model/qhexworker.h \
+           $$PWD/include/QHexView/model/qhexdiff.h \
+           $$PWD/include/QHexView/model/qhexchunkindex.h \
+           $$PWD/include/QHexView/model/qhexsearchindex.h \
+           $$PWD/include/QHexView/model/qhexpatternset.h \
+           $$PWD/include/QHexView/model/qhexregex.h \
+           $$PWD/include/QHexView/model/qhexfuzzy.h \
+           $$PWD/include/QHexView/model/qhexvaluerange.h \
+           $$PWD/include/QHexView/model/qhexmatches.h \
+           $$PWD/include/QHexView/model/qhexblockstats.h \
+           $$PWD/include/QHexView/model/qhexhistogram.h \
            $$PWD/include/QHexView/dialogs/hexfinddialog.h \
+           $$PWD/include/QHexView/dialogs/hexinspectorpane.h \
+           $$PWD/include/QHexView/qhexmimedata.h \
+           $$PWD/include/QHexView/qhexminimap.h \
            $$PWD/include/QHexView/qhexview.h
 
 SOURCES += $$PWD/src/model/commands/hexviewcommand.cpp \
            $$PWD/src/model/commands/insertcommand.cpp \
            $$PWD/src/model/commands/removecommand.cpp \
+           $$PWD/src/model/commands/replaceallcommand.cpp \
            $$PWD/src/model/commands/replacecommand.cpp \
            $$PWD/src/model/buffer/qdevicebuffer.cpp \
            $$PWD/src/model/buffer/qhexbuffer.cpp \
            $$PWD/src/model/buffer/qmemorybuffer.cpp \
            $$PWD/src/model/buffer/qmemoryrefbuffer.cpp \
            $$PWD/src/model/buffer/qmappedfilebuffer.cpp \
+           $$PWD/src/model/buffer/qsparsefilebuffer.cpp \
            $$PWD/src/model/qhexdelegate.cpp \
            $$PWD/src/model/qhexutils.cpp \
            $$PWD/src/model/qhexcursor.cpp \
            $$PWD/src/model/qhexmetadata.cpp \
+           $$PWD/src/model/qhexprofiler.cpp \
            $$PWD/src/model/qhexdocument.cpp \
+           $$PWD/src/model/qhexinspector.cpp \
+           $$PWD/src/model/qhexworker.cpp \
+           $$PWD/src/model/qhexdiff.cpp \
+           $$PWD/src/model/qhexchunkindex.cpp \
+           $$PWD/src/model/qhexsearchindex.cpp \
+           $$PWD/src/model/qhexpatternset.cpp \
+           $$PWD/src/model/qhexregex.cpp \
+           $$PWD/src/model/qhexfuzzy.cpp \
+           $$PWD/src/model/qhexvaluerange.cpp \
+           $$PWD/src/model/qhexmatches.cpp \
+           $$PWD/src/model/qhexblockstats.cpp \
+           $$PWD/src/model/qhexhistogram.cpp \
            $$PWD/src/dialogs/hexfinddialog.cpp \
+           $$PWD/src/dialogs/hexinspectorpane.cpp \
+           $$PWD/src/qhexmimedata.cpp \
+           $$PWD/src/qhexminimap.cpp \
            $$PWD/src/qhexview.cpp
 
 INCLUDEPATH += $$PWD/include
+
+# CONFIG += qhexview_profile enables the hot path instrumentation
+qhexview_profile {
+    DEFINES += "QHEXVIEW_PROFILE=1"
+}
+
+# CONFIG += qhexview_zlib enables the compressed file backend
+qhexview_zlib {
+    DEFINES += "QHEXVIEW_ENABLE_ZLIB=1"
+    HEADERS += $$PWD/include/QHexView/model/buffer/qcompressedfilebuffer.h
+    SOURCES += $$PWD/src/model/buffer/qcompressedfilebuffer.cpp
+    LIBS += -lz
+}
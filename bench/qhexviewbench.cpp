@@ -0,0 +1,439 @@
+#include <QApplication>
+#include <QFile>
+#include <QHash>
+#include <QHexView/model/buffer/qdevicebuffer.h>
+#include <QHexView/model/buffer/qmappedfilebuffer.h>
+#include <QHexView/model/buffer/qmemorybuffer.h>
+#include <QHexView/model/qhexutils.h>
+#include <QHexView/qhexview.h>
+#include <QImage>
+#include <QScopedPointer>
+#include <QScrollBar>
+#include <QTemporaryDir>
+#include <QtTest>
+#include <limits>
+
+// Synthetic file sizes are read from QHEXVIEW_BENCH_SIZES (ie. "1M,512M,4G"),
+// results can be saved in a machine readable format with the QtTest
+// options (ie. "QHexView_bench -o results.csv,csv").
+
+namespace {
+
+const qint64 CHUNK_SIZE = 1024 * 1024;
+const int SAMPLES = 4096;
+const int METADATA_COUNT = 10000;
+
+qint64 parseSize(QString s) {
+    s = s.trimmed().toUpper();
+    qint64 m = 1;
+
+    if(s.endsWith('K'))
+        m = 1024;
+    else if(s.endsWith('M'))
+        m = 1024 * 1024;
+    else if(s.endsWith('G'))
+        m = 1024 * 1024 * 1024;
+
+    if(m > 1)
+        s.chop(1);
+
+    bool ok = false;
+    qint64 size = s.toLongLong(&ok);
+    return ok ? size * m : -1;
+}
+
+QList<qint64> benchSizes() {
+    QString env = qEnvironmentVariable("QHEXVIEW_BENCH_SIZES", "1M,64M");
+    QList<qint64> sizes;
+
+    for(const QString& s : env.split(',')) {
+        qint64 size = parseSize(s);
+        if(size > 0)
+            sizes.append(size);
+    }
+
+    return sizes;
+}
+
+QByteArray sizeName(qint64 size) {
+    if(size >= 1024 * 1024 * 1024 && !(size % (1024 * 1024 * 1024)))
+        return QByteArray::number(size / (1024 * 1024 * 1024)) + "G";
+    if(size >= 1024 * 1024 && !(size % (1024 * 1024)))
+        return QByteArray::number(size / (1024 * 1024)) + "M";
+    if(size >= 1024 && !(size % 1024))
+        return QByteArray::number(size / 1024) + "K";
+    return QByteArray::number(size);
+}
+
+// Deterministic offsets for random access
+quint32 nextRandom(quint32& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+qint64 randomOffset(quint32& state, qint64 size) {
+    quint64 r = (quint64{nextRandom(state)} << 32) | nextRandom(state);
+    return static_cast<qint64>(r % static_cast<quint64>(size));
+}
+
+} // namespace
+
+class QHexViewBench: public QObject {
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void bufferRead_data();
+    void bufferRead();
+    void bufferAt_data();
+    void bufferAt();
+    void bufferInsert_data();
+    void bufferInsert();
+    void bufferRemove_data();
+    void bufferRemove();
+    void find_data();
+    void find();
+    void setMetadata_data();
+    void setMetadata();
+    void findMetadata_data();
+    void findMetadata();
+    void paint_data();
+    void paint();
+
+private:
+    void addBufferRows(bool editable = false);
+    void addSizeRows();
+    QString file(qint64 size);
+    QHexBuffer* buffer(const QString& backend, qint64 size);
+    QHexDocument* document(const QString& backend, qint64 size);
+
+private:
+    QTemporaryDir m_dir;
+    QList<qint64> m_sizes;
+    QHash<qint64, QString> m_files;
+};
+
+void QHexViewBench::initTestCase() {
+    QVERIFY(m_dir.isValid());
+    m_sizes = benchSizes();
+    QVERIFY(!m_sizes.isEmpty());
+}
+
+void QHexViewBench::bufferRead_data() { this->addBufferRows(); }
+
+void QHexViewBench::bufferRead() {
+    QFETCH(QString, backend);
+    QFETCH(qint64, size);
+
+    QScopedPointer<QHexBuffer> buffer{this->buffer(backend, size)};
+    QVERIFY(buffer);
+
+    quint32 state = 1;
+
+    QBENCHMARK {
+        for(int i = 0; i < SAMPLES; i++)
+            buffer->read(randomOffset(state, size), 4096);
+    }
+}
+
+void QHexViewBench::bufferAt_data() { this->addBufferRows(); }
+
+void QHexViewBench::bufferAt() {
+    QFETCH(QString, backend);
+    QFETCH(qint64, size);
+
+    QScopedPointer<QHexBuffer> buffer{this->buffer(backend, size)};
+    QVERIFY(buffer);
+
+    quint32 state = 1;
+    uchar acc = 0;
+
+    QBENCHMARK {
+        for(int i = 0; i < SAMPLES; i++)
+            acc ^= buffer->at(randomOffset(state, size));
+    }
+
+    Q_UNUSED(acc);
+}
+
+void QHexViewBench::bufferInsert_data() { this->addBufferRows(true); }
+
+void QHexViewBench::bufferInsert() {
+    QFETCH(QString, backend);
+    QFETCH(qint64, size);
+
+    QScopedPointer<QHexBuffer> buffer{this->buffer(backend, size)};
+    QVERIFY(buffer);
+
+    quint32 state = 1;
+
+    QBENCHMARK {
+        for(int i = 0; i < SAMPLES; i++)
+            buffer->insert(randomOffset(state, size), QByteArray(1, 'X'));
+    }
+}
+
+void QHexViewBench::bufferRemove_data() { this->addBufferRows(true); }
+
+void QHexViewBench::bufferRemove() {
+    QFETCH(QString, backend);
+    QFETCH(qint64, size);
+
+    QScopedPointer<QHexBuffer> buffer{this->buffer(backend, size)};
+    QVERIFY(buffer);
+
+    quint32 state = 1;
+
+    QBENCHMARK {
+        for(int i = 0; i < SAMPLES && buffer->length() > 1; i++)
+            buffer->remove(randomOffset(state, buffer->length()), 1);
+    }
+}
+
+void QHexViewBench::find_data() {
+    QTest::addColumn<qint64>("size");
+    QTest::addColumn<int>("mode");
+    QTest::addColumn<QVariant>("value");
+    QTest::addColumn<uint>("options");
+
+    // Synthetic data is 7-bit only, none of these values will be found
+    for(qint64 size : m_sizes) {
+        QByteArray n = sizeName(size);
+
+        QTest::newRow(("text/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Text)
+            << QVariant{QStringLiteral("QHexView bench needle")}
+            << uint{QHexFindOptions::None};
+        QTest::newRow(("text-cs/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Text)
+            << QVariant{QStringLiteral("QHexView bench needle")}
+            << uint{QHexFindOptions::CaseSensitive};
+        QTest::newRow(("hex/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Hex)
+            << QVariant{QStringLiteral("FFEE??DD")}
+            << uint{QHexFindOptions::None};
+        QTest::newRow(("int/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Int)
+            << QVariant{0xFFFFFFFFu} << uint{QHexFindOptions::Int32};
+        QTest::newRow(("float/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Float)
+            << QVariant{-1.0} << uint{QHexFindOptions::Double};
+        QTest::newRow(("regex/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Regex)
+            << QVariant{QStringLiteral("\\xff[\\x80-\\xfe]{4}|MZ\\x90")}
+            << uint{QHexFindOptions::None};
+        QTest::newRow(("fuzzy/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Fuzzy)
+            << QVariant{QStringLiteral("FF FE FD FC FB FA F9 F8")}
+            << QHexFindOptions::withDistance(2);
+        QTest::newRow(("fuzzy-lev/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Fuzzy)
+            << QVariant{QStringLiteral("FF FE FD FC FB FA F9 F8")}
+            << (QHexFindOptions::Levenshtein |
+                QHexFindOptions::withDistance(2));
+        QTest::newRow(("range/" + n).constData())
+            << size << static_cast<int>(QHexFindMode::Range)
+            << QVariant{QStringLiteral("0x80000000..0xffffffff")}
+            << uint{QHexFindOptions::Int32 | QHexFindOptions::LittleEndian |
+                    QHexFindOptions::BigEndian};
+    }
+}
+
+void QHexViewBench::find() {
+    QFETCH(qint64, size);
+    QFETCH(int, mode);
+    QFETCH(QVariant, value);
+    QFETCH(uint, options);
+
+    QHexView view;
+    view.setDocument(this->document(QStringLiteral("mapped"), size));
+    QVERIFY(view.hexDocument());
+
+    QBENCHMARK {
+        auto res = QHexUtils::find(&view, value, 0,
+                                   static_cast<QHexFindMode>(mode), options);
+        QCOMPARE(res.first, qint64{-1});
+    }
+}
+
+void QHexViewBench::setMetadata_data() { this->addSizeRows(); }
+
+void QHexViewBench::setMetadata() {
+    QFETCH(qint64, size);
+
+    QHexView view;
+    view.setDocument(this->document(QStringLiteral("mapped"), size));
+    QVERIFY(view.hexDocument());
+
+    quint32 state = 1;
+
+    QBENCHMARK {
+        view.clearMetadata();
+
+        for(int i = 0; i < METADATA_COUNT; i++) {
+            qint64 b = randomOffset(state, size);
+            view.setMetadata(b, qMin(b + 64, size), Qt::red, Qt::yellow,
+                             QStringLiteral("Comment"));
+        }
+    }
+}
+
+void QHexViewBench::findMetadata_data() { this->addSizeRows(); }
+
+void QHexViewBench::findMetadata() {
+    QFETCH(qint64, size);
+
+    QHexView view;
+    view.setDocument(this->document(QStringLiteral("mapped"), size));
+    QVERIFY(view.hexDocument());
+
+    quint32 state = 1;
+
+    for(int i = 0; i < METADATA_COUNT; i++) {
+        qint64 b = randomOffset(state, size);
+        view.setMetadata(b, qMin(b + 64, size), Qt::red, Qt::yellow,
+                         QStringLiteral("Comment"));
+    }
+
+    quint64 lines = view.lines();
+    unsigned int linelength = view.lineLength();
+    const QHexMetadata* metadata = view.hexMetadata();
+    int hits = 0;
+
+    QBENCHMARK {
+        for(int i = 0; i < SAMPLES; i++) {
+            qint64 line = randomOffset(state, static_cast<qint64>(lines));
+            if(metadata->find(line, linelength))
+                hits++;
+        }
+    }
+
+    Q_UNUSED(hits);
+}
+
+void QHexViewBench::paint_data() { this->addBufferRows(); }
+
+void QHexViewBench::paint() {
+    QFETCH(QString, backend);
+    QFETCH(qint64, size);
+
+    QHexView view;
+    view.resize(1280, 800);
+    view.setDocument(this->document(backend, size));
+    QVERIFY(view.hexDocument());
+
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+
+    QScrollBar* vscrollbar = view.verticalScrollBar();
+    vscrollbar->setValue(vscrollbar->maximum() / 2);
+
+    QImage image(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+
+    QBENCHMARK {
+        view.viewport()->render(&image);
+    }
+}
+
+void QHexViewBench::addBufferRows(bool editable) {
+    QTest::addColumn<QString>("backend");
+    QTest::addColumn<qint64>("size");
+
+    for(qint64 size : m_sizes) {
+        QByteArray n = sizeName(size);
+
+        if(size <= std::numeric_limits<int>::max()) {
+            QTest::newRow(("memory/" + n).constData())
+                << QStringLiteral("memory") << size;
+        }
+
+        // The file backed buffers don't support editing
+        if(editable)
+            continue;
+
+        QTest::newRow(("device/" + n).constData())
+            << QStringLiteral("device") << size;
+        QTest::newRow(("mapped/" + n).constData())
+            << QStringLiteral("mapped") << size;
+    }
+}
+
+void QHexViewBench::addSizeRows() {
+    QTest::addColumn<qint64>("size");
+
+    for(qint64 size : m_sizes)
+        QTest::newRow(sizeName(size).constData()) << size;
+}
+
+QString QHexViewBench::file(qint64 size) {
+    auto it = m_files.find(size);
+    if(it != m_files.end())
+        return it.value();
+
+    QString filename = m_dir.filePath(QString::fromLatin1(sizeName(size)));
+    QFile f(filename);
+    if(!f.open(QFile::WriteOnly))
+        return {};
+
+    QByteArray chunk(CHUNK_SIZE, Qt::Uninitialized);
+    quint32 state = 0x12345678;
+
+    for(qint64 pos = 0; pos < size; pos += chunk.size()) {
+        for(char& c : chunk)
+            c = static_cast<char>(nextRandom(state) & 0x7F);
+
+        f.write(chunk.constData(), qMin<qint64>(chunk.size(), size - pos));
+    }
+
+    m_files[size] = filename;
+    return filename;
+}
+
+QHexBuffer* QHexViewBench::buffer(const QString& backend, qint64 size) {
+    QString filename = this->file(size);
+    if(filename.isEmpty())
+        return nullptr;
+
+    QHexBuffer* buffer = nullptr;
+
+    if(backend == QStringLiteral("memory")) {
+        QFile f(filename);
+        if(!f.open(QFile::ReadOnly))
+            return nullptr;
+
+        // Fully loaded, QMemoryBuffer would map a file device
+        buffer = new QMemoryBuffer();
+        buffer->read(f.readAll());
+        return buffer;
+    }
+
+    if(backend == QStringLiteral("device"))
+        buffer = new QDeviceBuffer();
+    else
+        buffer = new QMappedFileBuffer();
+
+    if(!buffer->read(new QFile(filename, buffer))) {
+        delete buffer;
+        return nullptr;
+    }
+
+    return buffer;
+}
+
+QHexDocument* QHexViewBench::document(const QString& backend, qint64 size) {
+    QHexBuffer* buffer = this->buffer(backend, size);
+    return buffer ? QHexDocument::fromBuffer(buffer) : nullptr;
+}
+
+int main(int argc, char** argv) {
+    if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app{argc, argv};
+    QHexViewBench bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "qhexviewbench.moc"
@@ -0,0 +1,313 @@
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHexView/model/buffer/qmemorybuffer.h>
+#include <QHexView/qhexview.h>
+#include <QImage>
+#include <QScrollBar>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <new>
+#include <vector>
+
+// Headless paint harness: every scenario drives the viewport through a
+// number of frames and reports frame time percentiles and allocations.
+
+namespace {
+
+std::atomic<quint64> g_allocations{0};
+
+} // namespace
+
+#if defined(__GLIBC__)
+// Counts every heap allocation, Qt containers included
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+
+void free(void* p) noexcept { __libc_free(p); }
+}
+#else
+// C++ allocations only
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if(!p)
+        throw std::bad_alloc{};
+    return p;
+}
+
+void* operator new[](size_t size) { return ::operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+#endif
+
+namespace {
+
+// Synthetic data is a single QByteArray, leave room for its header
+const qint64 MAX_SIZE = std::numeric_limits<int>::max() - 64;
+const qint64 ACTIVE_RANGE = 1024 * 1024; // Scenarios stay in the first MiB
+
+struct Scenario {
+    QString name;
+    std::function<void(QHexView*)> setup;
+    std::function<void(QHexView*, int)> step;
+};
+
+struct FrameStats {
+    double mean, p50, p95, p99; // Milliseconds
+    double allocations;         // Per frame
+};
+
+class BenchDelegate: public QHexDelegate {
+public:
+    explicit BenchDelegate(QObject* parent = nullptr): QHexDelegate{parent} {}
+
+    bool renderByte(quint64 offset, quint8 b, QHexCharFormat& outcf,
+                    const QHexView* hexview) const override {
+        Q_UNUSED(offset);
+        Q_UNUSED(hexview);
+
+        if(b < 0x20)
+            outcf.foreground = Qt::darkRed;
+        else if(b < 0x40)
+            outcf.foreground = Qt::darkBlue;
+        else
+            return false;
+
+        return true;
+    }
+};
+
+void setLayout(QHexView* hexview, unsigned int linelength,
+               unsigned int grouplength) {
+    QHexOptions options = hexview->options();
+    options.line_length = linelength;
+    options.group_length = grouplength;
+    hexview->setOptions(options);
+}
+
+void scroll(QHexView* hexview, int frame) {
+    QScrollBar* vscrollbar = hexview->verticalScrollBar();
+    qint64 lines = ACTIVE_RANGE / hexview->options().line_length;
+    int max = static_cast<int>(qMin<qint64>(vscrollbar->maximum(), lines));
+    vscrollbar->setValue(max > 0 ? (frame * 3) % max : 0);
+}
+
+QList<Scenario> scenarios() {
+    QList<Scenario> s;
+
+    s.append({"scroll", [](QHexView*) {}, scroll});
+
+    s.append({"scroll-line32-group4",
+              [](QHexView* hv) { setLayout(hv, 32, 4); }, scroll});
+
+    s.append({"scroll-line64-group8",
+              [](QHexView* hv) { setLayout(hv, 64, 8); }, scroll});
+
+    s.append({"selection-drag",
+              [](QHexView* hv) { hv->hexCursor()->move(0); },
+              [](QHexView* hv, int frame) {
+                  // Extends the selection over the visible area
+                  qint64 visible = hv->viewport()->height() /
+                                   qMax(hv->fontMetrics().height(), 1) *
+                                   hv->options().line_length;
+                  hv->hexCursor()->select(frame % qMax<qint64>(visible, 1));
+              }});
+
+    s.append({"metadata-heavy",
+              [](QHexView* hv) {
+                  for(qint64 i = 0; i < ACTIVE_RANGE; i += 8) {
+                      hv->setMetadata(i, i + 6, Qt::darkGreen,
+                                      QColor(0xFF, 0xF0, (i >> 3) & 0xFF),
+                                      (i % 64) ? QString{}
+                                               : QStringLiteral("Comment"));
+                  }
+              },
+              scroll});
+
+    s.append({"delegate",
+              [](QHexView* hv) { hv->setDelegate(new BenchDelegate(hv)); },
+              scroll});
+
+    s.append({"trackchanges",
+              [](QHexView* hv) {
+                  hv->setTrackChanges(true);
+                  QHexDocument* doc = hv->hexDocument();
+
+                  for(qint64 i = 0; i < ACTIVE_RANGE; i += 16)
+                      doc->replace(i, QByteArray(2, '\xFF'));
+              },
+              scroll});
+
+    return s;
+}
+
+QByteArray syntheticData(qint64 size) {
+    QByteArray data(static_cast<int>(size), Qt::Uninitialized);
+    quint32 state = 0x12345678;
+
+    for(char& c : data) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        c = static_cast<char>(state);
+    }
+
+    return data;
+}
+
+double percentile(const std::vector<double>& sorted, double p) {
+    if(sorted.empty())
+        return 0;
+
+    auto idx = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[qMin(qMax<size_t>(idx, 1), sorted.size()) - 1];
+}
+
+FrameStats run(const Scenario& scenario, const QByteArray& data, QSize size,
+               int warmup, int frames) {
+    QHexView view;
+    view.resize(size);
+    view.setDocument(QHexDocument::fromMemory<QMemoryBuffer>(data));
+    scenario.setup(&view);
+    view.show();
+    QApplication::processEvents();
+
+    QImage image(view.viewport()->size(), QImage::Format_ARGB32_Premultiplied);
+    std::vector<double> times;
+    quint64 allocations = 0;
+    QElapsedTimer timer;
+
+    times.reserve(frames);
+
+    for(int i = 0; i < warmup + frames; i++) {
+        scenario.step(&view, i);
+        QApplication::processEvents(); // Not part of the frame
+
+        quint64 a = g_allocations.load(std::memory_order_relaxed);
+        timer.start();
+        view.viewport()->render(&image);
+        qint64 ns = timer.nsecsElapsed();
+        a = g_allocations.load(std::memory_order_relaxed) - a;
+
+        if(i < warmup)
+            continue;
+
+        times.push_back(ns / 1e6);
+        allocations += a;
+    }
+
+    FrameStats stats{};
+    if(times.empty())
+        return stats;
+
+    double total = 0;
+    for(double t : times)
+        total += t;
+
+    std::sort(times.begin(), times.end());
+    stats.mean = total / times.size();
+    stats.p50 = percentile(times, 0.50);
+    stats.p95 = percentile(times, 0.95);
+    stats.p99 = percentile(times, 0.99);
+    stats.allocations = static_cast<double>(allocations) / times.size();
+    return stats;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app{argc, argv};
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("QHexView render benchmark");
+    parser.addHelpOption();
+    parser.addOptions({
+        {"frames", "Measured frames per scenario.", "n", "500"},
+        {"warmup", "Unmeasured frames per scenario.", "n", "20"},
+        {"size", "Document size in bytes, up to 2 GiB.", "bytes", "16777216"},
+        {"width", "Viewport width.", "px", "1280"},
+        {"height", "Viewport height.", "px", "800"},
+        {"scenario", "Run only the matching scenarios.", "name"},
+        {"csv", "Machine readable output."},
+    });
+    parser.process(app);
+
+    int frames = parser.value("frames").toInt();
+    int warmup = parser.value("warmup").toInt();
+    qint64 size = qBound(ACTIVE_RANGE, parser.value("size").toLongLong(),
+                         MAX_SIZE);
+    QSize viewsize{parser.value("width").toInt(),
+                   parser.value("height").toInt()};
+    QStringList filter = parser.values("scenario");
+    bool csv = parser.isSet("csv");
+
+    QByteArray data = syntheticData(size);
+    QTextStream out(stdout);
+
+    if(csv)
+        out << "scenario,frames,mean_ms,p50_ms,p95_ms,p99_ms,"
+               "allocs_per_frame\n";
+    else {
+        out << QString("%1 %2 %3 %4 %5 %6\n")
+                   .arg(QStringLiteral("Scenario"), -24)
+                   .arg(QStringLiteral("Mean"), 9)
+                   .arg(QStringLiteral("p50"), 9)
+                   .arg(QStringLiteral("p95"), 9)
+                   .arg(QStringLiteral("p99"), 9)
+                   .arg(QStringLiteral("Allocs"), 10);
+    }
+
+    for(const Scenario& s : scenarios()) {
+        if(!filter.isEmpty() && !filter.contains(s.name))
+            continue;
+
+        FrameStats st = run(s, data, viewsize, warmup, frames);
+
+        if(csv) {
+            out << s.name << ',' << frames << ',' << st.mean << ',' << st.p50
+                << ',' << st.p95 << ',' << st.p99 << ',' << st.allocations
+                << '\n';
+        }
+        else {
+            out << QString("%1 %2 %3 %4 %5 %6\n")
+                       .arg(s.name, -24)
+                       .arg(st.mean, 9, 'f', 3)
+                       .arg(st.p50, 9, 'f', 3)
+                       .arg(st.p95, 9, 'f', 3)
+                       .arg(st.p99, 9, 'f', 3)
+                       .arg(st.allocations, 10, 'f', 1);
+        }
+
+        out.flush();
+    }
+
+    return 0;
+}
@@ -10,7 +10,7 @@ int main(int argc, char** argv) {
     QHexView view;
     view.setWindowTitle(
         QString{"QHexView Example (Qt %1)"}.arg(QT_VERSION_STR));
-    view.setDocument(doc); // No parent, take the ownership of 'doc'
+    view.setDocument(doc); // No parent: 'doc' becomes a child of the view
     view.show();
 
     return a.exec();
@@ -23,7 +23,9 @@ private Q_SLOTS:
     void updateFindOptions(int);
     void validateActions();
     void replace();
+    void replaceAll();
     void find();
+    void findAll();
 
 private:
     bool prepareOptions(QString& q, QHexFindMode& mode, QHexFindDirection& fd);
@@ -33,12 +35,16 @@ private:
     void prepareHexMode(QLayout* l);
     void prepareIntMode(QLayout* l);
     void prepareFloatMode(QLayout* l);
+    void prepareFuzzyMode(QLayout* l);
+    void prepareRangeMode(QLayout* l);
+    unsigned int fuzzyOptions() const;
+    unsigned int rangeOptions() const;
 
 private:
     QRegularExpressionValidator *m_hexvalidator, *m_hexpvalidator;
     QDoubleValidator* m_dblvalidator;
     QIntValidator* m_intvalidator;
-    int m_oldidxbits{-1}, m_oldidxendian{-1};
+    int m_oldidxbits{-1}, m_oldidxendian{-1}, m_oldidxencoding{-1};
     unsigned int m_findoptions{0};
     qint64 m_startoffset{-1};
     Type m_type;
@@ -46,8 +52,15 @@ private:
 private:
     static const QString BUTTONBOX;
     static const QString CBFINDMODE;
+    static const QString CBENCODING;
+    static const QString CBMETRIC;
+    static const QString SBDISTANCE;
+    static const QString BGRANGETYPES;
+    static const QString CBRANGEENDIAN;
     static const QString LEFIND;
     static const QString LEREPLACE;
+    static const QString PBREPLACEALL;
+    static const QString PBFINDALL;
     static const QString HLAYOUT;
     static const QString GBOPTIONS;
     static const QString RBALL;
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QHexView/model/qhexinspector.h>
+#include <QPointer>
+#include <QWidget>
+
+class QCheckBox;
+class QTreeWidget;
+class QHexView;
+
+class HexInspectorPane: public QWidget {
+    Q_OBJECT
+
+public:
+    explicit HexInspectorPane(QHexView* hexview, QWidget* parent = nullptr);
+    QHexView* hexView() const;
+    const QHexInspector* inspector() const;
+
+public Q_SLOTS:
+    void updateValues();
+
+protected:
+    void showEvent(QShowEvent* e) override;
+
+private:
+    QPointer<QHexView> m_hexview;
+    QHexInspector m_inspector;
+    QTreeWidget* m_twvalues;
+    QCheckBox* m_cbbigendian;
+};
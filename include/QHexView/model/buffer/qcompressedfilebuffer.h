@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QHash>
+#include <QHexView/model/buffer/qhexbuffer.h>
+#include <QVector>
+
+class QFile;
+
+class QCompressedFileBuffer: public QHexBuffer {
+    Q_OBJECT
+
+private:
+    struct AccessPoint {
+        qint64 out; // Uncompressed offset
+        qint64 in;  // Compressed offset
+        int bits;   // Unused bits of the byte before 'in'
+    };
+
+    struct CachedBlock {
+        QByteArray data;
+        quint64 stamp;
+    };
+
+public:
+    explicit QCompressedFileBuffer(QObject* parent = nullptr);
+    static QString indexFileName(const QString& filename);
+    uchar at(qint64 idx) override;
+    qint64 length() const override;
+    void insert(qint64 offset, const QByteArray& data) override;
+    void replace(qint64 offset, const QByteArray& data) override;
+    void remove(qint64 offset, int length) override;
+    QByteArray read(qint64 offset, int length) override;
+    bool read(QIODevice* device) override;
+    void write(QIODevice* device) override;
+    QHexBuffer* createReader() const override;
+    qint64 indexOf(const QByteArray& ba, qint64 from) override;
+    qint64 lastIndexOf(const QByteArray& ba, qint64 from) override;
+
+private:
+    bool loadIndex(const QString& indexname);
+    bool buildIndex(const QString& indexname);
+    bool writeIndexHeader();
+    int findPoint(qint64 offset) const;
+    QByteArray window(int point);
+    QByteArray inflateBlock(int point);
+    const QByteArray& block(int point);
+
+private:
+    QIODevice* m_device{nullptr};
+    QFile* m_indexfile{nullptr};
+    QVector<AccessPoint> m_points;
+    QHash<int, CachedBlock> m_blocks;
+    quint64 m_stamp{0};
+    qint64 m_length{0};
+    qint64 m_compressedsize{0};
+    qint64 m_mtime{0};
+    bool m_gzip{false};
+};
@@ -1,24 +1,56 @@
 #pragma once
 
+#include <QHash>
 #include <QHexView/model/buffer/qhexbuffer.h>
+#include <QMutex>
+
+class QDeviceBufferWorker;
 
 class QDeviceBuffer: public QHexBuffer {
     Q_OBJECT
 
+private:
+    struct CachedPage {
+        QByteArray data;
+        quint64 stamp;
+    };
+
 public:
     explicit QDeviceBuffer(QObject* parent = nullptr);
     virtual ~QDeviceBuffer();
     uchar at(qint64 idx) override;
     qint64 length() const override;
+    bool isAvailable(qint64 offset, qint64 length) const override;
+    void prefetch(qint64 offset, qint64 length) override;
+    QByteArray peek(qint64 offset, int length) override;
     void insert(qint64 offset, const QByteArray& data) override;
     void replace(qint64 offset, const QByteArray& data) override;
     void remove(qint64 offset, int length) override;
     QByteArray read(qint64 offset, int length) override;
     bool read(QIODevice* device) override;
     void write(QIODevice* device) override;
+    QHexBuffer* createReader() const override;
     qint64 indexOf(const QByteArray& ba, qint64 from) override;
     qint64 lastIndexOf(const QByteArray& ba, qint64 from) override;
 
+private:
+    bool isCached(qint64 page, quint64& generation) const;
+    bool cachePage(qint64 page, const QByteArray& data, quint64 generation);
+    QByteArray page(qint64 page, bool wait);
+    QByteArray readPages(qint64 offset, int length, bool wait);
+    void startWorker();
+    void invalidatePages(qint64 offset, qint64 length);
+    void stopWorker();
+
 protected:
     QIODevice* m_device{nullptr};
+
+private:
+    QDeviceBufferWorker* m_worker{nullptr};
+    QHash<qint64, CachedPage> m_pages;
+    quint64 m_stamp{0}, m_generation{0};
+    qint64 m_length{0};
+    mutable QMutex m_mutex;
+
+    friend class QDeviceBufferWorker;
 };
@@ -3,16 +3,25 @@
 #include <QIODevice>
 #include <QObject>
 
+class QHexProfiler;
+
 class QHexBuffer: public QObject {
     Q_OBJECT
 
 public:
     explicit QHexBuffer(QObject* parent = nullptr);
     bool isEmpty() const;
+    void setProfiler(QHexProfiler* profiler);
 
 public:
     virtual uchar at(qint64 idx);
     virtual bool accept(qint64 idx) const;
+    virtual bool holeAt(qint64 offset, qint64& begin, qint64& end) const;
+    virtual bool isAvailable(qint64 offset, qint64 length) const;
+    virtual void prefetch(qint64 offset, qint64 length);
+    virtual QByteArray peek(qint64 offset, int length); // Never waits
+    virtual void release(const QString& filename); // About to be overwritten
+    virtual QHexBuffer* createReader() const;
     virtual void replace(qint64 offset, const QByteArray& data);
     virtual void read(char* data, int size);
     virtual void read(const QByteArray& ba);
@@ -26,4 +35,14 @@ public:
     virtual void write(QIODevice* iodevice) = 0;
     virtual qint64 indexOf(const QByteArray& ba, qint64 from) = 0;
     virtual qint64 lastIndexOf(const QByteArray& ba, qint64 from) = 0;
+
+protected:
+    QHexProfiler* m_profiler{nullptr};
+
+protected:
+    qint64 scanForward(const QByteArray& ba, qint64 begin, qint64 end);
+    qint64 scanBackward(const QByteArray& ba, qint64 begin, qint64 end);
+
+Q_SIGNALS:
+    void dataAvailable(qint64 offset, qint64 length);
 };
@@ -8,6 +8,9 @@ public:
     virtual ~QMappedFileBuffer();
 
 public:
+    uchar at(qint64 idx) override;
+    bool isAvailable(qint64 offset, qint64 length) const override;
+    void prefetch(qint64 offset, qint64 length) override;
     QByteArray read(qint64 offset, int length) override;
     bool read(QIODevice* iodevice) override;
     void write(QIODevice* iodevice) override;
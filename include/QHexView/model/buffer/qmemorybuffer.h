@@ -1,22 +1,53 @@
 #pragma once
 
 #include <QHexView/model/buffer/qhexbuffer.h>
+#include <QVector>
+
+class QFileDevice;
 
 class QMemoryBuffer: public QHexBuffer {
     Q_OBJECT
 
+private:
+    struct Node;
+
 public:
     explicit QMemoryBuffer(QObject* parent = nullptr);
+    virtual ~QMemoryBuffer();
     uchar at(qint64 idx) override;
     qint64 length() const override;
     void insert(qint64 offset, const QByteArray& data) override;
+    void replace(qint64 offset, const QByteArray& data) override;
     void remove(qint64 offset, int length) override;
     QByteArray read(qint64 offset, int length) override;
+    void read(char* data, int size) override;
+    void read(const QByteArray& ba) override;
     bool read(QIODevice* device) override;
+    bool map(QFileDevice* f); // Instead of read(), f must outlive it
     void write(QIODevice* device) override;
+    void release(const QString& filename) override;
     qint64 indexOf(const QByteArray& ba, qint64 from) override;
     qint64 lastIndexOf(const QByteArray& ba, qint64 from) override;
 
 private:
-    QByteArray m_buffer;
+    void reset(const QByteArray& ba);
+    void unmap(bool keep = false);
+    bool isMapped(const Node* leaf) const;
+    void copyMapped(Node* node);
+    void splitRoot();
+    Node* findLeaf(qint64 offset, qint64& leafbegin);
+    QVector<Node*> insertAt(Node* node, qint64 offset, const QByteArray& data);
+    void removeAt(Node* node, qint64 offset, qint64 length);
+    void writeNode(const Node* node, QIODevice* device) const;
+    static Node* createLeaf(const QByteArray& data, int begin, int size);
+    static QVector<Node*> splitLeaf(Node* leaf);
+    static void materialize(Node* leaf);
+
+private:
+    Node* m_root;
+    Node* m_lastleaf{nullptr};
+    qint64 m_lastbegin{0};
+    QFileDevice* m_mappedfile{nullptr};
+    uchar* m_mappeddata{nullptr};
+    qint64 m_mappedsize{0};
 };
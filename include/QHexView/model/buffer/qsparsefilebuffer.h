@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QHexView/model/buffer/qdevicebuffer.h>
+#include <QList>
+
+struct QSparseExtent {
+    qint64 begin, end;
+    bool hole;
+};
+
+using QSparseExtents = QList<QSparseExtent>;
+
+class QSparseFileBuffer: public QDeviceBuffer {
+    Q_OBJECT
+
+public:
+    explicit QSparseFileBuffer(QObject* parent = nullptr);
+    const QSparseExtents& extents() const;
+    uchar at(qint64 idx) override;
+    bool holeAt(qint64 offset, qint64& begin, qint64& end) const override;
+    bool isAvailable(qint64 offset, qint64 length) const override;
+    void prefetch(qint64 offset, qint64 length) override;
+    QByteArray peek(qint64 offset, int length) override;
+    void replace(qint64 offset, const QByteArray& data) override;
+    QByteArray read(qint64 offset, int length) override;
+    bool read(QIODevice* iodevice) override;
+    qint64 indexOf(const QByteArray& ba, qint64 from) override;
+    qint64 lastIndexOf(const QByteArray& ba, qint64 from) override;
+
+private:
+    QByteArray readExtents(qint64 offset, int length, bool wait);
+    void scanExtents();
+    int findExtent(qint64 offset) const;
+
+Q_SIGNALS:
+    void extentsChanged();
+
+private:
+    QSparseExtents m_extents;
+};
@@ -12,6 +12,10 @@ public:
                     QHexDocument* document, QUndoCommand* parent = nullptr);
     const QHexChanges& changes() const { return m_changes; }
 
+protected:
+    void emitDataChanged(const QByteArray& data, qint64 offset,
+                         QHexChangeReason reason);
+
 protected:
     QHexChanges m_changes;
     QHexDocument* m_hexdocument;
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QHexView/model/commands/hexviewcommand.h>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+// Sorted, non overlapping {offset, length} matches replaced with the same
+// data: one undo step, one dataChanged() per run of close matches (or one
+// from the first match on, when the lengths change)
+class QHexViewReplaceAllCommand: public QHexViewCommand {
+public:
+    QHexViewReplaceAllCommand(QHexBuffer* buffer, const QHexChanges& changes,
+                              QHexDocument* document,
+                              const QList<QPair<qint64, qint64>>& matches,
+                              const QByteArray& data,
+                              QUndoCommand* parent = nullptr);
+    void undo() override;
+    void redo() override;
+
+private:
+    void notify(bool undo);
+
+private:
+    QList<QPair<qint64, qint64>> m_matches;
+    QVector<QByteArray> m_olddata;
+    qint64 m_delta{0}; // Length change
+    bool m_inplace{true};
+};
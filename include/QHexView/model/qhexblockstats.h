@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QBitArray>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+class QHexDocument;
+class QHexBlockStatsWorker;
+
+// Scaled to 0-255: Shannon entropy (0-8 bits per byte) and the ratios of
+// zeros, printable ASCII and bytes with the high bit set
+struct QHexBlockStat {
+    quint8 entropy, zeros, printable, high;
+};
+
+// Per block byte statistics of a whole document, computed in background.
+// The block size grows with the document so there are at most MAX_BLOCKS
+// of them; edits only mark the affected blocks (and for inserts and
+// removals the ones after them) as dirty, the old values are kept until
+// the rescan catches up. Owned by the document, see blockStats().
+class QHexBlockStats: public QObject {
+    Q_OBJECT
+
+public:
+    static const qint64 MIN_BLOCK = 4 * 1024;
+    static const int MAX_BLOCKS = 1 << 16;
+
+public:
+    explicit QHexBlockStats(QHexDocument* document, QObject* parent = nullptr);
+    ~QHexBlockStats() override;
+    QHexDocument* document() const;
+    qint64 blockSize() const;
+    int count() const;
+    int blockAt(qint64 offset) const;
+    QHexBlockStat at(int idx) const;
+    bool isDirty(int idx) const;
+    bool isReady() const;
+    bool isRunning() const;
+
+public Q_SLOTS:
+    void start();
+    void cancel();
+
+private:
+    void layout();
+    void invalidate(qint64 offset, qint64 length);
+    void setResults(quint64 generation, int first,
+                    const QVector<QHexBlockStat>& stats);
+
+Q_SIGNALS:
+    void progress(qint64 done, qint64 total);
+    void updated(int first, int count);
+    void finished();
+
+private:
+    QPointer<QHexDocument> m_document;
+    QVector<QHexBlockStat> m_stats;
+    QBitArray m_dirty;
+    qint64 m_blocksize{0};
+    quint64 m_generation{0}; // Drops results of older scans
+    QHexBlockStatsWorker* m_worker{nullptr};
+    QTimer m_restarttimer;
+
+    friend class QHexBlockStatsWorker;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QVector>
+
+class QHexDocument;
+class QHexChunkIndexWorker;
+
+struct QHexChunk {
+    qint64 offset, length;
+    quint64 hash;
+};
+
+using QHexChunks = QVector<QHexChunk>;
+
+// Content defined chunking of a document: boundaries are picked by a
+// Buzhash rolling hash, so they move along with the data on inserts and
+// removals and equal content produces equal chunks anywhere in the file.
+// Lookups work on chunk hashes only, they are answered without reading
+// the document again (an equal hash is a match, not a verified one).
+class QHexChunkIndex: public QObject {
+    Q_OBJECT
+
+public:
+    static const int WINDOW_SIZE = 48;
+    static const qint64 MIN_CHUNK = 2 * 1024;
+    static const qint64 AVG_CHUNK = 8 * 1024;
+    static const qint64 MAX_CHUNK = 64 * 1024;
+
+public:
+    explicit QHexChunkIndex(QHexDocument* document, QObject* parent = nullptr);
+    ~QHexChunkIndex() override;
+    QHexDocument* document() const;
+    const QHexChunks& chunks() const;
+    bool isReady() const;
+    bool isRunning() const;
+    int chunkAt(qint64 offset) const;
+    qint64 nextDifference(const QHexChunkIndex* other, qint64 offset) const;
+    qint64 previousDifference(const QHexChunkIndex* other,
+                              qint64 offset) const;
+    QList<qint64> duplicates(qint64 offset, qint64 length) const;
+
+public Q_SLOTS:
+    void start();
+    void cancel();
+
+private:
+    bool isDifferent(const QHexChunkIndex* other, int idx) const;
+    void setResults(const QHexChunks& chunks);
+    static quint64 pairHash(quint64 a, quint64 b);
+
+Q_SIGNALS:
+    void progress(qint64 done, qint64 total);
+    void finished();
+
+private:
+    QPointer<QHexDocument> m_document;
+    QHexChunks m_chunks;
+    QMultiHash<quint64, int> m_byhash;
+    QSet<quint64> m_pairs;
+    QHexChunkIndexWorker* m_worker{nullptr};
+    QTimer m_restarttimer;
+    bool m_ready{false};
+
+    friend class QHexChunkIndexWorker;
+};
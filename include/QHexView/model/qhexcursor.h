@@ -44,6 +44,9 @@ public:
                    qint64 offset, QHexFindMode mode = QHexFindMode::Text,
                    unsigned int options = QHexFindOptions::None,
                    QHexFindDirection fd = QHexFindDirection::Forward) const;
+    int replaceAll(const QVariant& oldvalue, const QVariant& newvalue,
+                   QHexFindMode mode = QHexFindMode::Text,
+                   unsigned int options = QHexFindOptions::None) const;
     qint64 find(const QVariant& value, qint64 offset,
                 QHexFindMode mode = QHexFindMode::Text,
                 unsigned int options = QHexFindOptions::None,
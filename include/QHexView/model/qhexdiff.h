@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QHexView/model/qhexchanges.h>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+
+class QHexDocument;
+class QHexDiffWorker;
+
+// A difference between the left and the right document: Remove ranges only
+// exist on the left, Insert ranges only on the right, Replace ranges on both
+// (with possibly different lengths).
+struct QHexDiffRange {
+    QHexChangeReason reason;
+    qint64 left, leftlength;
+    qint64 right, rightlength;
+};
+
+using QHexDiffRanges = QList<QHexDiffRange>;
+
+class QHexDiff: public QObject {
+    Q_OBJECT
+
+public:
+    static const int MAX_RANGES = 1 << 20;
+
+public:
+    explicit QHexDiff(QHexDocument* left, QHexDocument* right,
+                      QObject* parent = nullptr);
+    ~QHexDiff() override;
+    QHexDocument* left() const;
+    QHexDocument* right() const;
+    const QHexDiffRanges& ranges() const;
+    bool isRunning() const;
+    QHexChangeReason reasonAt(const QHexDocument* document,
+                              qint64 offset) const;
+    qint64 mapOffset(const QHexDocument* document, qint64 offset) const;
+
+public Q_SLOTS:
+    void start();
+    void cancel();
+
+private:
+    int findRange(bool left, qint64 offset) const;
+    void takeResults();
+
+Q_SIGNALS:
+    void progress(qint64 done, qint64 total);
+    void changed();
+    void finished();
+
+private:
+    QPointer<QHexDocument> m_left, m_right;
+    QHexDiffRanges m_ranges;
+    QHexDiffWorker* m_worker{nullptr};
+    QTimer m_restarttimer;
+
+    friend class QHexDiffWorker;
+};
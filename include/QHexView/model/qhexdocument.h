@@ -3,9 +3,16 @@
 #include <QHexView/model/buffer/qhexbuffer.h>
 #include <QHexView/model/qhexchanges.h>
 #include <QHexView/model/qhexmetadata.h>
+#include <QHexView/model/qhexprofiler.h>
+#include <QPair>
+#include <QPointer>
 #include <QUndoStack>
 
+class QHexBlockStats;
 class QHexCursor;
+class QHexHistogramEngine;
+class QHexSearchIndex;
+class QHexView;
 
 class QHexDocument: public QObject {
     Q_OBJECT
@@ -21,10 +28,18 @@ private:
     void removeChange(qint64 offset, qint64 n);
     void moveChanges(qint64 offset, qint64 n);
     void restoreChanges();
+    void attachView(QHexView* hexview);
+    void detachView(QHexView* hexview);
+    void emitDataChanged(const QByteArray& data, qint64 offset,
+                         QHexChangeReason reason);
+    void flushDataChanged();
 
 public:
+    virtual ~QHexDocument();
     QHexChangeReason getChangeReason(qint64 offset) const;
+    bool holeAt(qint64 offset, qint64& begin, qint64& end) const;
     bool isEmpty() const;
+    bool isAvailable(qint64 offset, qint64 len) const;
     bool isModified() const;
     bool canUndo() const;
     bool canRedo() const;
@@ -35,8 +50,20 @@ public:
     qint64 length() const;
     qint64 indexOf(const QByteArray& ba, qint64 from = 0);
     qint64 lastIndexOf(const QByteArray& ba, qint64 from = 0);
+    QList<qint64> findAll(const QByteArray& ba, int limit = -1);
     QByteArray read(qint64 offset, int len = 0) const;
+    QByteArray peek(qint64 offset, int len) const;
+    QHexBuffer* createReader() const; // See QHexBuffer::createReader()
     uchar at(qint64 offset) const;
+    QHexMetadata* metadata() const;
+    QHexSearchIndex* searchIndex() const;
+    void setSearchIndex(QHexSearchIndex* index);
+    QHexBlockStats* blockStats();
+    QHexHistogramEngine* histogram();
+    QList<QHexView*> views() const;
+    QHexProfiler* profiler() const;
+    QHexStats stats() const;
+    void resetStats();
 
 public Q_SLOTS:
     void clearChanges();
@@ -51,7 +78,11 @@ public Q_SLOTS:
     void insert(qint64 offset, const QByteArray& data);
     void replace(qint64 offset, const QByteArray& data);
     void remove(qint64 offset, int len);
+    void replaceAll(const QList<QPair<qint64, qint64>>& matches,
+                    const QByteArray& data);
+    void prefetch(qint64 offset, qint64 len);
     bool saveTo(QIODevice* device);
+    bool saveTo(const QString& filename);
 
 public:
     template<typename T, bool Owned = true>
@@ -69,6 +100,14 @@ public:
                                        QObject* parent = nullptr);
     static QHexDocument* fromMappedFile(QString filename,
                                         QObject* parent = nullptr);
+    static QHexDocument* fromPrivateMappedFile(QString filename,
+                                               QObject* parent = nullptr);
+    static QHexDocument* fromSparseFile(QString filename,
+                                        QObject* parent = nullptr);
+#if defined(QHEXVIEW_ENABLE_ZLIB)
+    static QHexDocument* fromCompressedFile(QString filename,
+                                            QObject* parent = nullptr);
+#endif
     static QHexDocument* fromFile(QString filename, QObject* parent = nullptr);
     static QHexDocument* create(QObject* parent = nullptr);
 
@@ -79,16 +118,35 @@ Q_SIGNALS:
     void canRedoChanged(bool canredo);
     void dataChanged(const QByteArray& data, quint64 offset,
                      QHexChangeReason reason);
+    void dataAvailable(qint64 offset, qint64 length);
     void changed();
     void reset();
 
 private:
     QHexBuffer* m_buffer;
+    QHexMetadata* m_metadata;
+    QPointer<QHexSearchIndex> m_searchindex;
+    QHexBlockStats* m_blockstats{nullptr};
+    QHexHistogramEngine* m_histogram{nullptr};
+    QHexProfiler* m_profiler;
+    QList<QHexView*> m_views;
     QUndoStack* m_undostack;
     QHexChanges m_changes;
     bool m_trackchanges{false};
 
+    // dataChanged() of commands run by the undo stack, held back until
+    // m_changes is up to date
+    struct PendingChange {
+        QByteArray data;
+        qint64 offset;
+        QHexChangeReason reason;
+    };
+
+    QList<PendingChange> m_pendingchanges;
+    bool m_deferchanges{false};
+
     friend class QHexView;
+    friend class QHexViewCommand;
 };
 
 template<typename T, bool Owned>
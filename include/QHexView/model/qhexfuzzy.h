@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QHexView/model/qhexutils.h>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+class QHexDocument;
+
+// Approximate search of a byte pattern (up to 64 bytes, "??" wildcards
+// allowed) within a maximum Hamming or Levenshtein distance. The text is
+// read in chunks and fed to a Wu-Manber bit-parallel automaton, one
+// machine word per allowed error, so the cost doesn't depend on the data.
+class QHexFuzzy {
+public:
+    enum class Metric { Hamming, Levenshtein };
+
+    static const int MAX_LENGTH = 64;
+    static const int MAX_DISTANCE = 16;
+
+public:
+    QHexFuzzy() = default;
+    QHexFuzzy(const QHexUtils::QHexPattern& pattern, int maxdistance,
+              Metric metric = Metric::Hamming);
+    QHexFuzzy(const QByteArray& pattern, int maxdistance,
+              Metric metric = Metric::Hamming);
+    QHexFuzzy(const QString& pattern, int maxdistance,
+              Metric metric = Metric::Hamming);
+    bool isValid() const;
+    int length() const;
+    int maxDistance() const;
+    Metric metric() const;
+    QPair<qint64, qint64> match(const QHexDocument* document, qint64 from = 0,
+                                qint64 to = -1,
+                                int* distance = nullptr) const;
+    QPair<qint64, qint64> matchBackward(const QHexDocument* document,
+                                        qint64 from,
+                                        int* distance = nullptr) const;
+    QList<QPair<qint64, qint64>> findAll(const QHexDocument* document,
+                                         qint64 from = 0, qint64 length = -1,
+                                         int limit = -1) const;
+
+private:
+    qint64 scan(const QHexDocument* document, qint64 from, qint64 to,
+                qint64 last, bool backward, int& distance) const;
+    int align(const QByteArray& data, bool suffix) const;
+
+private:
+    QHexUtils::QHexPattern m_pattern;
+    QVector<quint64> m_masks, m_rmasks; // Forward and reversed pattern
+    int m_maxdistance{-1};
+    Metric m_metric{Metric::Hamming};
+};
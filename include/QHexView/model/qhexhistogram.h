@@ -0,0 +1,79 @@
+#pragma once
+
+#include <QCache>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <memory>
+
+class QHexDocument;
+class QHexHistogramWorker;
+struct QHexHistogramJob;
+
+// Byte value counts of a range. Counting goes through four interleaved
+// sub-histograms fed by 64-bit loads, so runs of the same byte don't
+// stall on the same counter.
+class QHexHistogram {
+public:
+    QHexHistogram() = default;
+    void add(const uchar* data, qint64 len);
+    void add(const QHexHistogram& h);
+    void clear();
+    bool isEmpty() const;
+    qint64 count(uchar b) const;
+    qint64 total() const;
+    double entropy() const; // Shannon, in bits per byte
+    quint64 sum() const;    // Additive checksums are its low 8/16/32 bits
+
+private:
+    qint64 m_counts[256]{};
+    qint64 m_total{0};
+};
+
+// Histogram of any range of a document, computed by a pool of workers
+// over 1 MiB reads. Histograms of whole BLOCK_SIZE blocks are cached
+// (up to CACHE_BLOCKS of them), so overlapping or repeated queries only
+// read what they didn't see before; edits drop the blocks they touch and,
+// for inserts and removals, the ones after them. One query runs at a time,
+// starting another cancels it. Owned by the document, see histogram().
+class QHexHistogramEngine: public QObject {
+    Q_OBJECT
+
+public:
+    static const qint64 BLOCK_SIZE = 64 * 1024;
+    static const int CACHE_BLOCKS = 8192;
+
+public:
+    explicit QHexHistogramEngine(QHexDocument* document,
+                                 QObject* parent = nullptr);
+    ~QHexHistogramEngine() override;
+    QHexDocument* document() const;
+    QHexHistogram result() const;
+    bool isReady() const;
+    bool isRunning() const;
+
+public Q_SLOTS:
+    void start(qint64 offset, qint64 length);
+    void cancel();
+
+private:
+    void invalidate(qint64 offset, qint64 length);
+    void notify(quint64 generation, qint64 length);
+    void complete(quint64 generation);
+
+Q_SIGNALS:
+    void progress(qint64 done, qint64 total);
+    void finished();
+
+private:
+    QPointer<QHexDocument> m_document;
+    QCache<qint64, QHexHistogram> m_cache; // By block index
+    QList<QHexHistogramWorker*> m_workers;
+    std::shared_ptr<QHexHistogramJob> m_job;
+    QHexHistogram m_result;
+    quint64 m_generation{0}; // Drops notifications of older queries
+    int m_running{0};
+    bool m_ready{false};
+
+    friend class QHexHistogramWorker;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <QDateTime>
+#include <QHexView/model/qhexutils.h>
+#include <QPointer>
+#include <QUuid>
+
+class QHexDocument;
+
+// Decodes typed values at an offset from a small span of bytes, widths and
+// byte order use the QHexFindOptions flags (Int8...Int64, Float, Double and
+// BigEndian). Moving by less than SPAN_SIZE only reads the new bytes.
+class QHexInspector {
+public:
+    static const int SPAN_SIZE = 16;
+
+public:
+    explicit QHexInspector(const QHexDocument* document = nullptr);
+    const QHexDocument* document() const;
+    const uchar* data() const;
+    qint64 offset() const;
+    int size() const;
+    void setDocument(const QHexDocument* document);
+    void setOffset(qint64 offset);
+    void invalidate();
+    bool readInt(unsigned int options, qint64& v) const;
+    bool readUInt(unsigned int options, quint64& v) const;
+    bool readFloat(unsigned int options, double& v) const;
+    bool readULEB128(quint64& v, int* len = nullptr) const;
+    bool readSLEB128(qint64& v, int* len = nullptr) const;
+    bool readUnixTime(unsigned int options, QDateTime& v) const;
+    bool readFileTime(unsigned int options, QDateTime& v) const;
+    bool readGuid(unsigned int options, QUuid& v) const;
+
+public:
+    static int width(unsigned int options);
+
+private:
+    quint64 raw(int w, int pos, bool bigendian) const;
+
+private:
+    QPointer<const QHexDocument> m_document;
+    uchar m_span[SPAN_SIZE];
+    qint64 m_offset{-1};
+    int m_size{0};
+};
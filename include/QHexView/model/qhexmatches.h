@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+// Search results drawn over the document: sorted, non overlapping
+// {offset, length} pairs kept in two flat arrays (12 bytes per match),
+// every lookup is a binary search so millions of matches stay cheap.
+class QHexMatches {
+public:
+    QHexMatches() = default;
+    void setMatches(QList<QPair<qint64, qint64>> matches);
+    void clear();
+    bool isEmpty() const;
+    int size() const;
+    qint64 offset(int idx) const;
+    qint64 length(int idx) const;
+    qint64 end(int idx) const;
+    int lowerBound(qint64 offset) const; // First match ending after offset
+    int indexOf(qint64 offset, int first = 0, int last = -1) const;
+    QPair<int, int> range(qint64 begin, qint64 end) const; // [first, last)
+    bool intersects(qint64 begin, qint64 end) const;
+
+private:
+    QVector<qint64> m_offsets;
+    QVector<qint32> m_lengths;
+};
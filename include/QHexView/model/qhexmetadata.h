@@ -15,19 +15,34 @@ struct QHexMetadataItem {
 
 using QHexMetadataLine = QList<QHexMetadataItem>;
 
+// Owned by QHexDocument and shared by all of its views: items are stored by
+// offset, the per line lookup is built lazily for every line length in use.
 class QHexMetadata: public QObject {
     Q_OBJECT
 
 private:
     using ClearMetadataCallback = std::function<bool(QHexMetadataItem&)>;
+    using LineIndex = QHash<qint64, QHexMetadataLine>;
+
+    struct Layout {
+        LineIndex index;
+        quint64 stamp; // Last use
+    };
 
 private:
-    explicit QHexMetadata(const QHexOptions* options,
-                          QObject* parent = nullptr);
+    explicit QHexMetadata(QObject* parent = nullptr);
 
 public:
+    const QList<QHexMetadataItem>& items() const;
     const QHexMetadataLine* find(qint64 line) const;
+    const QHexMetadataLine* find(qint64 line, unsigned int linelength) const;
     QString getComment(qint64 line, qint64 column) const;
+    QString getComment(qint64 offset, unsigned int linelength) const;
+    void removeMetadata(qint64 line, unsigned int linelength);
+    void removeBackground(qint64 line, unsigned int linelength);
+    void removeForeground(qint64 line, unsigned int linelength);
+    void removeComments(qint64 line, unsigned int linelength);
+    void unhighlight(qint64 line, unsigned int linelength);
     void removeMetadata(qint64 line);
     void removeBackground(qint64 line);
     void removeForeground(qint64 line);
@@ -71,18 +86,25 @@ public:
     }
 
 private:
-    void copy(const QHexMetadata* metadata);
-    void clearMetadata(qint64 line, ClearMetadataCallback&& cb);
+    unsigned int lineLength() const;
+    void clearMetadata(qint64 line, unsigned int linelength,
+                       ClearMetadataCallback&& cb);
     void setMetadata(const QHexMetadataItem& mi);
-    void invalidate();
+
+private:
+    static bool isOnLine(const QHexMetadataItem& mi, qint64 line,
+                         unsigned int linelength);
+    static void indexItem(LineIndex& index, const QHexMetadataItem& mi,
+                          unsigned int linelength);
 
 Q_SIGNALS:
     void changed();
     void cleared();
 
 private:
-    QHash<qint64, QHexMetadataLine> m_metadata;
-    const QHexOptions* m_options;
+    QList<QHexMetadataItem> m_items;
+    mutable QHash<unsigned int, Layout> m_lines; // By line length
+    mutable quint64 m_stamp{0};
 
-    friend class QHexView;
+    friend class QHexDocument;
 };
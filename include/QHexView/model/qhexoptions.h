@@ -39,6 +39,7 @@ struct QHexOptions {
     // Appearance
     QChar unprintable_char{'.'};
     QChar invalid_char{'?'};
+    QChar placeholder_char{'~'};
     QString address_label{""};
     QString hex_label;
     QString ascii_label;
@@ -55,6 +56,9 @@ struct QHexOptions {
     QColor line_background;
     QHexCharFormat trackchange_format_insert;
     QHexCharFormat trackchange_format_overwrite;
+    QHexCharFormat trackchange_format_remove;
+    QHexCharFormat hole_format;
+    QHexCharFormat match_format; // Also the scrollbar markers' color
     QHexCharFormat header_format;
     QHexCharFormat address_format;
     QHexCharFormat addressheader_format;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHexView/model/qhexutils.h>
+#include <QList>
+#include <QVector>
+
+class QHexDocument;
+
+struct QHexPatternMatch {
+    int id;
+    qint64 offset, length;
+};
+
+using QHexPatternMatches = QList<QHexPatternMatch>;
+
+// A set of byte strings and hex patterns matched together in one pass:
+// the longest run of plain bytes before the first ".." of every pattern
+// goes in an Aho-Corasick automaton, hits are verified against the full
+// pattern (wildcards and skips). Patterns without such a run are tried
+// at every offset, keep them rare. A ".." spans up to MAX_SKIP bytes.
+class QHexPatternSet {
+public:
+    static const int CHUNK_SIZE = 1 << 20;
+    static const int MAX_SKIP = 64 * 1024;
+
+public:
+    QHexPatternSet() = default;
+    int addBytes(const QByteArray& ba);
+    int addPattern(const QHexUtils::QHexPattern& pattern);
+    int addPattern(const QString& pattern);
+    int size() const;
+    bool isEmpty() const;
+    void clear();
+    QHexPatternMatches findAll(const QHexDocument* document, qint64 from = 0,
+                               qint64 length = -1, int limit = -1) const;
+
+private:
+    struct Entry {
+        QHexUtils::QHexPattern pattern;
+        int anchor, anchorlength; // In bytes, -1 if unanchored
+        bool exact;               // The anchor is the whole pattern
+        qint64 maxlength;         // Longest possible match
+    };
+
+    void compile() const;
+    bool verify(const QHexDocument* document, const Entry& entry,
+                qint64 offset, qint64 end, const QByteArray& window,
+                qint64 windowbase, qint64& matchlen) const;
+
+private:
+    QVector<Entry> m_entries;
+    mutable QVector<qint32> m_delta; // 256 transitions per state
+    mutable QVector<QVector<int>> m_outputs;
+    mutable QVector<int> m_unanchored;
+    mutable int m_maxprefix{0};
+    mutable int m_maxanchorend{0}; // Hits are this far after their offset
+    mutable bool m_compiled{false};
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+#include <atomic>
+
+class QIODevice;
+
+struct QHexStats {
+    quint64 reads{0};
+    quint64 bytes_read{0};
+    quint64 cache_hits{0};
+    quint64 cache_misses{0};
+    quint64 draw_formats{0};
+    quint64 metadata_lookups{0};
+    quint64 undo_pushes{0};
+    quint64 searches{0};
+    quint64 bytes_searched{0};
+    quint64 frames{0};
+
+    // Nanoseconds
+    qint64 read_time{0};
+    qint64 paint_time{0};
+    qint64 search_time{0};
+};
+
+class QHexProfiler {
+public:
+    enum Counter {
+        Reads = 0,
+        BytesRead,
+        CacheHits,
+        CacheMisses,
+        DrawFormats,
+        MetadataLookups,
+        UndoPushes,
+        Searches,
+        BytesSearched,
+        Frames,
+        ReadTime,
+        PaintTime,
+        SearchTime,
+
+        CountersCount
+    };
+
+private:
+    struct TraceEvent {
+        const char* name;
+        qint64 begin, duration; // Nanoseconds
+        quintptr thread;
+    };
+
+public:
+    QHexProfiler();
+    ~QHexProfiler();
+    QHexStats stats() const;
+    bool isTracing() const;
+    qint64 elapsed() const;
+    void reset();
+    void add(Counter c, qint64 v = 1);
+    void startTrace();
+    void stopTrace();
+    void traceEvent(const char* name, qint64 begin, qint64 duration);
+    bool saveTrace(QIODevice* device) const;
+    bool saveTrace(const QString& filename) const;
+
+private:
+    std::atomic<qint64> m_counters[CountersCount];
+    QElapsedTimer m_clock;
+    QVector<TraceEvent> m_events;
+    QString m_tracefile;
+    mutable QMutex m_mutex;
+    std::atomic<bool> m_tracing{false}; // Read by the profiled threads
+};
+
+// Times a scope, adds it to a time counter and to the trace (if enabled)
+class QHexProfileScope {
+public:
+    inline QHexProfileScope(QHexProfiler* profiler, const char* name,
+                            QHexProfiler::Counter c)
+        : m_profiler{profiler}, m_name{name}, m_counter{c} {
+        if(m_profiler)
+            m_begin = m_profiler->elapsed();
+    }
+
+    inline ~QHexProfileScope() {
+        if(!m_profiler)
+            return;
+
+        qint64 duration = m_profiler->elapsed() - m_begin;
+        m_profiler->add(m_counter, duration);
+
+        if(m_profiler->isTracing())
+            m_profiler->traceEvent(m_name, m_begin, duration);
+    }
+
+private:
+    QHexProfiler* m_profiler;
+    const char* m_name;
+    QHexProfiler::Counter m_counter;
+    qint64 m_begin{0};
+};
+
+#if defined(QHEXVIEW_PROFILE)
+#define QHEXVIEW_PROFILE_COUNT(profiler, counter, value)                       \
+    do {                                                                       \
+        if(profiler)                                                           \
+            (profiler)->add(QHexProfiler::counter, (value));                   \
+    } while(0)
+
+#define QHEXVIEW_PROFILE_SCOPE(profiler, name, counter)                        \
+    QHexProfileScope qhexview_profile_scope {                                  \
+        (profiler), (name), QHexProfiler::counter                              \
+    }
+#else
+#define QHEXVIEW_PROFILE_COUNT(profiler, counter, value)                       \
+    do {                                                                       \
+    } while(0)
+
+#define QHEXVIEW_PROFILE_SCOPE(profiler, name, counter)                        \
+    do {                                                                       \
+    } while(0)
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <memory>
+
+class QHexDocument;
+struct QHexRegexPrivate;
+
+// Regular expressions over raw bytes: "." matches any byte, \xHH any
+// value, other non ASCII characters are matched as UTF-8 (like the Text
+// find mode). Supported: | () (?:) [] [^] * + ? {n} {n,} {n,m} and the
+// \d \w \s classes, lazy quantifiers are accepted but matching is always
+// leftmost-longest. Patterns are run by DFAs built lazily while scanning,
+// so there is no backtracking and matches may span any number of reads.
+class QHexRegex {
+public:
+    static const int MAX_REPEAT = 1000;
+
+public:
+    QHexRegex() = default;
+    explicit QHexRegex(const QString& pattern, bool casesensitive = true);
+    bool isValid() const;
+    QString pattern() const;
+    QString errorString() const;
+    qint64 maxLength() const; // -1 if unbounded
+    QPair<qint64, qint64> match(const QHexDocument* document, qint64 from = 0,
+                                qint64 to = -1) const;
+    QPair<qint64, qint64> matchBackward(const QHexDocument* document,
+                                        qint64 from) const;
+    QList<QPair<qint64, qint64>> findAll(const QHexDocument* document,
+                                         qint64 from = 0, qint64 length = -1,
+                                         int limit = -1) const;
+
+private:
+    qint64 matchEnd(const QHexDocument* document, qint64 from,
+                    qint64 to) const;
+    qint64 matchStart(const QHexDocument* document, qint64 from,
+                      qint64 end) const;
+
+private:
+    std::shared_ptr<QHexRegexPrivate> d;
+};
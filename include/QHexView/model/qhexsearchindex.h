@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVector>
+
+class QFile;
+class QHexDocument;
+class QHexSearchIndexWorker;
+
+// On disk 4-gram filter for repeated searches on large documents.
+// The document is split in BLOCK_SIZE blocks and each block gets a
+// FILTER_BITS bloom filter of its (ASCII lowercased) 4-grams, stored bit
+// sliced: one 64-bit word per filter bit for every 64 blocks, so a query
+// only touches a few words per 4 MiB of data and candidate blocks are
+// verified by reading them (about 1/8 of the document size on disk).
+// Replacements patch the affected blocks in place, inserts and removals
+// rebuild it; the file is reused across sessions while the document is
+// unmodified and its length and sampled content still match.
+class QHexSearchIndex: public QObject {
+    Q_OBJECT
+
+public:
+    static const int GRAM_SIZE = 4;
+    static const int BLOCK_SIZE = 64 * 1024;
+    static const int FILTER_BITS = 1 << 16;
+
+public:
+    // Attaches itself to the document, an empty file name keeps the index
+    // in a temporary file for this session only
+    explicit QHexSearchIndex(QHexDocument* document,
+                             const QString& filename = QString{},
+                             QObject* parent = nullptr);
+    ~QHexSearchIndex() override;
+    QHexDocument* document() const;
+    QString fileName() const;
+    bool isReady() const;
+    bool isRunning() const;
+    bool canSearch(const QByteArray& ba) const;
+    qint64 indexOf(const QByteArray& ba, qint64 from = 0,
+                   bool casesensitive = true) const;
+    qint64 lastIndexOf(const QByteArray& ba, qint64 from,
+                       bool casesensitive = true) const;
+    QList<qint64> findAll(const QByteArray& ba, bool casesensitive = true,
+                          int limit = -1) const;
+
+public Q_SLOTS:
+    void start();
+    void cancel();
+    void invalidate();
+
+private:
+    bool load();
+    bool map();
+    void unmap();
+    void stamp(bool valid);
+    void patch(qint64 offset, qint64 length);
+    void indexBlock(qint64 block);
+    quint64 fingerprint() const;
+    quint64 candidates(const QVector<int>& bits, qint64 batch) const;
+    qint64 scanBlock(const QByteArray& needle, qint64 block, qint64 from,
+                     qint64 to, bool casesensitive, bool backward,
+                     QList<qint64>* all = nullptr, int limit = -1) const;
+
+Q_SIGNALS:
+    void progress(qint64 done, qint64 total);
+    void finished();
+
+private:
+    QPointer<QHexDocument> m_document;
+    QString m_filename;
+    QFile* m_file{nullptr};
+    quint64* m_words{nullptr};
+    qint64 m_length{0};
+    QHexSearchIndexWorker* m_worker{nullptr};
+    QTimer m_restarttimer;
+    bool m_ready{false}, m_stamped{false};
+
+    friend class QHexSearchIndexWorker;
+};
@@ -20,12 +20,36 @@ enum : unsigned int {
     Float = (1 << 6),
     Double = (1 << 7),
 
+    // Range mode
+    Signed = (1 << 8),
+    Aligned = (1 << 9),       // Values at multiples of their width only
+    LittleEndian = (1 << 10), // Along with BigEndian: both byte orders
+
     BigEndian = (1 << 11),
+
+    // Text encoding, UTF-8 if none is set
+    Utf16LE = (1 << 12),
+    Utf16BE = (1 << 13),
+    Utf32LE = (1 << 14),
+    Utf32BE = (1 << 15),
+    Latin1 = (1 << 16),
+
+    // Fuzzy mode: Hamming distance unless Levenshtein is set
+    Levenshtein = (1 << 17),
+    Distance = (1 << 24), // Maximum distance, see withDistance()
 };
 
+inline unsigned int withDistance(int d) {
+    return static_cast<unsigned int>(d) * Distance;
+}
+
+inline int distanceOf(unsigned int options) {
+    return static_cast<int>(options / Distance);
 }
 
-enum class QHexFindMode { Text, Hex, Int, Float };
+}
+
+enum class QHexFindMode { Text, Hex, Int, Float, Regex, Fuzzy, Range };
 enum class QHexFindDirection { All, Forward, Backward };
 enum class QHexArea { Header, Address, Hex, Ascii, Extra };
 
@@ -58,13 +82,18 @@ struct QHexPatternItem {
 using QHexPattern = QList<QHexPatternItem>;
 
 bool isHex(char ch);
+const char* hexDigits(quint8 b, bool upper = false); // Two chars, no NUL
 QByteArray toHex(quint8 b);
-QByteArray toHex(const QByteArray& ba, char sep);
+qint64 toHex(const char* data, qint64 len, char* out, char sep = '\0',
+             bool upper = false);
+QByteArray toHex(const QByteArray& ba, char sep, bool upper = false);
 QByteArray toHex(const QByteArray& ba);
+QByteArray fromHex(const QByteArray& hex);
 qint64 adjustColumn(const QHexOptions* options, qint64 col);
 qint64 positionToOffset(const QHexOptions* options, QHexPosition pos);
 QHexPosition offsetToPosition(const QHexOptions* options, qint64 offset);
 bool checkPattern(const QString& s);
+QHexPattern compilePattern(const QString& s);
 
 QPair<qint64, qint64> find(const QHexView* hexview, QVariant value,
                            qint64 startoffset = 0,
@@ -72,10 +101,21 @@ QPair<qint64, qint64> find(const QHexView* hexview, QVariant value,
                            unsigned int options = QHexFindOptions::None,
                            QHexFindDirection fd = QHexFindDirection::Forward);
 
+// Non overlapping {offset, length} matches, in document order
+QList<QPair<qint64, qint64>>
+findAll(const QHexView* hexview, QVariant value,
+        QHexFindMode mode = QHexFindMode::Text,
+        unsigned int options = QHexFindOptions::None, int limit = -1);
+
 QPair<qint64, qint64>
 replace(const QHexView* hexview, QVariant oldvalue, QVariant newvalue,
         qint64 startoffset = 0, QHexFindMode mode = QHexFindMode::Text,
         unsigned int options = QHexFindOptions::None,
         QHexFindDirection fd = QHexFindDirection::Forward);
 
+// Every match, as a single undo step; returns how many were replaced
+int replaceAll(const QHexView* hexview, QVariant oldvalue, QVariant newvalue,
+               QHexFindMode mode = QHexFindMode::Text,
+               unsigned int options = QHexFindOptions::None);
+
 } // namespace QHexUtils
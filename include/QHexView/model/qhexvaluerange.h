@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+
+class QHexDocument;
+
+// Typed value search: "1000..2000" (bounds included), "3.14~0.01" (value
+// and tolerance) or a single value, decimal or 0x prefixed. Every width
+// and byte order selected by the QHexFindOptions is tested at each offset
+// in a single pass over the data, the widest type wins at the same offset.
+// Integers are unsigned unless Signed is set or the lower bound is
+// negative, floating point bounds are rounded to the type's precision.
+class QHexValueRange {
+public:
+    QHexValueRange() = default;
+    QHexValueRange(const QString& range, unsigned int options);
+    bool isValid() const;
+    QString errorString() const;
+    QPair<qint64, qint64> match(const QHexDocument* document, qint64 from = 0,
+                                qint64 to = -1,
+                                unsigned int* type = nullptr) const;
+    QPair<qint64, qint64> matchBackward(const QHexDocument* document,
+                                        qint64 from,
+                                        unsigned int* type = nullptr) const;
+    QList<QPair<qint64, qint64>> findAll(const QHexDocument* document,
+                                         qint64 from = 0, qint64 length = -1,
+                                         int limit = -1) const;
+
+private:
+    struct Probe {
+        unsigned int type; // Width, BigEndian and Signed options
+        int width;
+        bool floating, swap;
+        quint64 sign, lo, span; // Integers: sign extended - lo <= span
+        double dlo, dhi;
+    };
+
+    qint64 scanForward(const QHexDocument* document, qint64 from, qint64 to,
+                       int& index) const;
+    qint64 scanBackward(const QHexDocument* document, qint64 from,
+                        int& index) const;
+    qint64 probe(const Probe& p, const uchar* data, qint64 i, qint64 end,
+                 bool backward) const;
+
+private:
+    QVector<Probe> m_probes; // Widest first
+    QString m_error;
+    int m_maxwidth{0};
+    bool m_aligned{false};
+};
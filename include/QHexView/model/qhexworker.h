@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QThread>
+#include <memory>
+
+class QHexBuffer;
+class QHexDocument;
+struct QHexWorkerRequest;
+
+// Background job over one or more documents. Buffers are not thread safe:
+// read() goes through a reader of the worker's own when the buffer can
+// create one (see QHexBuffer::createReader()), otherwise it runs the read
+// on the thread owning the document and waits for it, giving up as soon as
+// the job is cancelled. Subclasses call cancel() in their destructor,
+// before their own members go away.
+class QHexWorker: public QThread {
+    Q_OBJECT
+
+public:
+    explicit QHexWorker(QObject* parent = nullptr);
+    ~QHexWorker() override;
+    void cancel();
+    bool isCancelled() const;
+
+protected:
+    QByteArray read(const QHexDocument* document, qint64 offset, int len);
+
+private:
+    QHexBuffer* reader(const QHexDocument* document);
+    void releaseReaders();
+    bool waitFor(const std::shared_ptr<QHexWorkerRequest>& req);
+
+Q_SIGNALS:
+    void progress(qint64 done, qint64 total);
+
+private:
+    QHash<const QHexDocument*, QHexBuffer*> m_readers; // nullptr if none
+    std::shared_ptr<QHexWorkerRequest> m_request;     // Being waited for
+    QMutex m_requestmutex;
+};
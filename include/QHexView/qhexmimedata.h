@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QHexView/qhexview.h>
+#include <QMimeData>
+#include <QPointer>
+
+// Clipboard payload for large selections: nothing is exported when it's
+// created, the range is read and formatted when a consumer first asks for
+// it, then kept in memory. Edits touching the range, or the view going
+// away, empty it rather than handing out different data: call exportData()
+// before changing the range yourself.
+class QHexMimeData: public QMimeData {
+public:
+    explicit QHexMimeData(const QHexView* hexview, qint64 offset,
+                          qint64 length, QHexExportFormat format,
+                          const QHexCopyFormat& cf = {});
+    bool isValid() const;
+    bool exportData() const; // Now, false if it can't be exported anymore
+    QStringList formats() const override;
+    bool hasFormat(const QString& mimetype) const override;
+
+protected:
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QVariant retrieveData(const QString& mimetype,
+                          QMetaType type) const override;
+#else
+    QVariant retrieveData(const QString& mimetype,
+                          QVariant::Type type) const override;
+#endif
+
+private:
+    void checkChange(qint64 offset, qint64 length, QHexChangeReason reason);
+
+private:
+    QPointer<QHexView> m_hexview;
+    QPointer<QHexDocument> m_hexdocument;
+    QHexCopyFormat m_copyformat;
+    qint64 m_offset, m_length;
+    QHexExportFormat m_format;
+    mutable QByteArray m_data; // Exported on the first request
+    bool m_valid{true};
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QPointer>
+#include <QTimer>
+#include <QWidget>
+
+struct QHexBlockStat;
+class QHexBlockStats;
+class QHexView;
+
+// Whole document overview drawn next to the QHexView viewport, one pixel
+// row per 1/height of the document colored from the document's
+// QHexBlockStats. Clicking or dragging scrolls the view there.
+class QHexMinimap: public QWidget {
+    Q_OBJECT
+
+public:
+    enum class Mode { ByteClass, Entropy, Zeros, Printable };
+    Q_ENUM(Mode);
+
+public:
+    explicit QHexMinimap(QHexView* hexview);
+    QHexView* hexView() const;
+    QHexBlockStats* blockStats() const;
+    Mode mode() const;
+    void setMode(Mode mode);
+    void setBlockStats(QHexBlockStats* stats);
+    QSize sizeHint() const override;
+
+private:
+    QColor blockColor(const QHexBlockStat& s) const;
+    int yFromOffset(qint64 offset) const;
+    void scrollTo(int y);
+
+protected:
+    void paintEvent(QPaintEvent*) override;
+    void mousePressEvent(QMouseEvent* e) override;
+    void mouseMoveEvent(QMouseEvent* e) override;
+
+private:
+    QHexView* m_hexview;
+    QPointer<QHexBlockStats> m_blockstats;
+    QTimer m_updatetimer;
+    Mode m_mode{Mode::ByteClass};
+};
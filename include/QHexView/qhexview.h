@@ -3,10 +3,13 @@
 #define QHEXVIEW_VERSION 5.0
 
 #include <QAbstractScrollArea>
+#include <QElapsedTimer>
 #include <QFontMetricsF>
 #include <QHexView/model/qhexcursor.h>
 #include <QHexView/model/qhexdelegate.h>
+#include <QHexView/model/qhexdiff.h>
 #include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexmatches.h>
 #include <QList>
 #include <QRectF>
 
@@ -26,6 +29,11 @@ struct QHexCopyFormat {
     bool use_tabs{false};
 };
 
+enum class QHexExportFormat { Raw, Hex, Format, Visual };
+
+class QHexMimeData;
+class QHexMinimap;
+
 class QHexView: public QAbstractScrollArea {
     Q_OBJECT
 
@@ -34,6 +42,7 @@ class QHexView: public QAbstractScrollArea {
         QPainter* painter;
         const QFontMetricsF* fontmetrics;
         QHexCharFormat format;
+        QPair<int, int> matches{0, 0}; // Visible ones
         qreal x, y;
 
         explicit PaintContext(const QHexView* hv, QPainter* p,
@@ -50,6 +59,7 @@ class QHexView: public QAbstractScrollArea {
 
 public:
     explicit QHexView(QWidget* parent = nullptr);
+    ~QHexView() override;
     QRectF headerRect() const;
     QRectF documentRect() const;
     QRectF addressRect() const;
@@ -58,6 +68,11 @@ public:
     QHexDocument* hexDocument() const;
     QHexCursor* hexCursor() const;
     const QHexMetadata* hexMetadata() const;
+    const QHexMatches* hexMatches() const;
+    QHexMinimap* minimap() const;
+    QHexDiff* hexDiff() const;
+    QHexView* syncView() const;
+    QHexStats stats() const;
     QHexOptions options() const;
     QColor getReadableColor(QColor c) const;
     QByteArray selectedBytes() const;
@@ -81,17 +96,31 @@ public:
     quint64 selectionEndOffset() const;
     quint64 baseAddress() const;
     quint64 lines() const;
+    bool exportSelection(QIODevice* device, QHexExportFormat format,
+                         const QHexCopyFormat& cf = {}) const;
+    bool exportRange(QIODevice* device, qint64 offset, qint64 length,
+                     QHexExportFormat format,
+                     const QHexCopyFormat& cf = {}) const;
+    QHexMimeData* createMimeData(QHexExportFormat format,
+                                 const QHexCopyFormat& cf = {}) const;
     qint64 replace(const QVariant& oldvalue, const QVariant& newvalue,
                    qint64 offset, QHexFindMode mode = QHexFindMode::Text,
                    unsigned int options = QHexFindOptions::None,
                    QHexFindDirection fd = QHexFindDirection::Forward) const;
+    int replaceAll(const QVariant& oldvalue, const QVariant& newvalue,
+                   QHexFindMode mode = QHexFindMode::Text,
+                   unsigned int options = QHexFindOptions::None) const;
     qint64 find(const QVariant& value, qint64 offset,
                 QHexFindMode mode = QHexFindMode::Text,
                 unsigned int options = QHexFindOptions::None,
                 QHexFindDirection fd = QHexFindDirection::Forward) const;
+    int findAll(const QVariant& value, QHexFindMode mode = QHexFindMode::Text,
+                unsigned int options = QHexFindOptions::None);
     void setOptions(const QHexOptions& options);
     void setBaseAddress(quint64 baseaddress);
     void setDelegate(QHexDelegate* rd);
+    void setDiff(QHexDiff* diff);
+    void setSyncView(QHexView* hexview);
     void setDocument(QHexDocument* doc);
     void setData(const QByteArray& ba);
     void setData(QHexBuffer* buffer);
@@ -116,6 +145,10 @@ public:
     void removeComments(qint64 line);
     void unhighlight(qint64 line);
     void clearMetadata();
+    void setMatches(const QList<QPair<qint64, qint64>>& matches);
+    void clearMatches();
+    void setMinimapVisible(bool b);
+    void resetStats();
 
 public Q_SLOTS:
 #if defined(QHEXVIEW_ENABLE_DIALOGS)
@@ -146,10 +179,14 @@ public Q_SLOTS:
 private:
     void paint(QPainter* p) const;
     void checkOptions();
+    void checkGlyphs();
     void checkState();
     void checkAndUpdate(bool calccolumns = false);
     void calcColumns();
     void ensureVisible();
+    void prefetch();
+    void syncScroll();
+    void layoutMinimap();
     void drawSeparators(QPainter* p) const;
     void drawHeader(PaintContext* ctx) const;
     void drawDocument(PaintContext* ctx) const;
@@ -158,11 +195,21 @@ private:
                      quint64 line) const;
     void drawAsciiPart(PaintContext* ctx, const QByteArray& linebytes,
                        quint64 line) const;
+    void drawPlaceholderPart(PaintContext* ctx) const;
+    void drawMatchMarkers(QPainter* p) const;
+    void formatLine(QString& s, const QByteArray& bytes, qint64 offset,
+                    quint64 line) const;
+    const QString& cellText(QHexArea area, const QByteArray& bytes,
+                            qint64 offset, quint64 line, unsigned int col,
+                            quint8* b = nullptr) const;
+    QString formatBytes(const QHexCopyFormat& cf, const QByteArray& bytes,
+                        qint64 index, qint64 total) const;
     QHexCharFormat drawFormat(PaintContext* ctx, quint8 b, const QString& s,
                               QHexArea area, qint64 line, qint64 column,
                               bool applyformat) const;
     unsigned int calcAddressWidth() const;
     int visibleLines(bool absolute = false) const;
+    qint64 firstVisibleLine() const;
     qint64 getLastColumn(qint64 line) const;
     qint64 lastLine() const;
     qreal getNCellsWidth(int n) const;
@@ -186,6 +233,7 @@ private:
 
 protected:
     bool event(QEvent* e) override;
+    bool eventFilter(QObject* o, QEvent* e) override;
     void showEvent(QShowEvent* e) override;
     void paintEvent(QPaintEvent*) override;
     void resizeEvent(QResizeEvent* e) override;
@@ -211,13 +259,26 @@ Q_SIGNALS:
 private:
     bool m_readonly{false}, m_writing{false}, m_autowidth{false};
     QHexArea m_currentarea{QHexArea::Ascii};
+    QElapsedTimer m_scrolltimer;
+    int m_lastscroll{0};
+    bool m_syncing{false};
     QList<QRectF> m_hexcolumns;
     QFontMetricsF m_fontmetrics;
     QHexOptions m_options;
+
+    struct {
+        QString hex[256], ascii[256]; // Cell text for every byte value
+        QString hexblank, asciiblank, hexinvalid, asciiinvalid;
+        QChar unprintable, invalid;
+    } m_glyphs;
+
     QHexCursor* m_hexcursor{nullptr};
-    QHexDocument* m_hexdocument{nullptr};
-    QHexMetadata* m_hexmetadata{nullptr};
+    QPointer<QHexDocument> m_hexdocument;
     QHexDelegate* m_hexdelegate{nullptr};
+    QHexMatches m_matches;
+    QHexMinimap* m_minimap{nullptr};
+    QPointer<QHexDiff> m_hexdiff;
+    QPointer<QHexView> m_syncview;
 #if defined(QHEXVIEW_ENABLE_DIALOGS)
     HexFindDialog *m_hexdlgfind{nullptr}, *m_hexdlgreplace{nullptr};
 #endif
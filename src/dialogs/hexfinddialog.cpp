@@ -1,3 +1,4 @@
+#include <QButtonGroup>
 #include <QCheckBox>
 #include <QComboBox>
 #include <QDialogButtonBox>
@@ -5,6 +6,9 @@
 #include <QGroupBox>
 #include <QHBoxLayout>
 #include <QHexView/dialogs/hexfinddialog.h>
+#include <QHexView/model/qhexfuzzy.h>
+#include <QHexView/model/qhexregex.h>
+#include <QHexView/model/qhexvaluerange.h>
 #include <QHexView/qhexview.h>
 #include <QLabel>
 #include <QLineEdit>
@@ -16,14 +20,22 @@
 #include <QRegularExpression>
 #include <QRegularExpressionValidator>
 #include <QSpacerItem>
+#include <QSpinBox>
 #include <QStackedLayout>
 #include <QVBoxLayout>
 #include <limits>
 
 const QString HexFindDialog::BUTTONBOX = "qhexview_buttonbox";
 const QString HexFindDialog::CBFINDMODE = "qhexview_cbfindmode";
+const QString HexFindDialog::CBENCODING = "qhexview_cbencoding";
+const QString HexFindDialog::CBMETRIC = "qhexview_cbmetric";
+const QString HexFindDialog::SBDISTANCE = "qhexview_sbdistance";
+const QString HexFindDialog::BGRANGETYPES = "qhexview_bgrangetypes";
+const QString HexFindDialog::CBRANGEENDIAN = "qhexview_cbrangeendian";
 const QString HexFindDialog::LEFIND = "qhexview_lefind";
 const QString HexFindDialog::LEREPLACE = "qhexview_lereplace";
+const QString HexFindDialog::PBREPLACEALL = "qhexview_pbreplaceall";
+const QString HexFindDialog::PBFINDALL = "qhexview_pbfindall";
 const QString HexFindDialog::HLAYOUT = "qhexview_hlayout";
 const QString HexFindDialog::GBOPTIONS = "qhexview_gboptions";
 const QString HexFindDialog::RBALL = "qhexview_rball";
@@ -51,6 +63,11 @@ HexFindDialog::HexFindDialog(Type type, QHexView* parent)
     cbfindmode->addItem(tr("Hex"), static_cast<int>(QHexFindMode::Hex));
     cbfindmode->addItem(tr("Int"), static_cast<int>(QHexFindMode::Int));
     cbfindmode->addItem(tr("Float"), static_cast<int>(QHexFindMode::Float));
+    cbfindmode->addItem(tr("Regex"), static_cast<int>(QHexFindMode::Regex));
+    cbfindmode->addItem(tr("Fuzzy"), static_cast<int>(QHexFindMode::Fuzzy));
+
+    if(type == Type::Find) // Matches have no fixed type to replace with
+        cbfindmode->addItem(tr("Range"), static_cast<int>(QHexFindMode::Range));
 
     QLineEdit *lereplace = nullptr, *lefind = new QLineEdit(this);
     lefind->setObjectName(HexFindDialog::LEFIND);
@@ -118,6 +135,20 @@ HexFindDialog::HexFindDialog(Type type, QHexView* parent)
     if(type == Type::Replace) {
         buttonbox->button(QDialogButtonBox::Apply)->setEnabled(false);
         buttonbox->button(QDialogButtonBox::Apply)->setText(tr("Replace"));
+
+        auto* pbreplaceall = buttonbox->addButton(
+            tr("Replace All"), QDialogButtonBox::ActionRole);
+        pbreplaceall->setObjectName(HexFindDialog::PBREPLACEALL);
+        pbreplaceall->setEnabled(false);
+    }
+    else {
+        auto* pbfindall =
+            buttonbox->addButton(tr("Find All"), QDialogButtonBox::ActionRole);
+        pbfindall->setObjectName(HexFindDialog::PBFINDALL);
+        pbfindall->setEnabled(false);
+
+        connect(pbfindall, &QPushButton::clicked, this,
+                &HexFindDialog::findAll);
     }
 
     vlayout->addWidget(buttonbox);
@@ -130,18 +161,24 @@ HexFindDialog::HexFindDialog(Type type, QHexView* parent)
     connect(buttonbox, &QDialogButtonBox::rejected, this, &QDialog::reject);
     connect(parent, &QHexView::positionChanged, this,
             [this]() { m_startoffset = -1; });
+    connect(this, &QDialog::finished, this,
+            [this]() { this->hexView()->clearMatches(); });
 
     if(lereplace) {
         connect(buttonbox->button(QDialogButtonBox::Apply),
                 &QPushButton::clicked, this, &HexFindDialog::replace);
         connect(lereplace, &QLineEdit::textChanged, this,
                 &HexFindDialog::validateActions);
+        connect(this->findChild<QPushButton*>(HexFindDialog::PBREPLACEALL),
+                &QPushButton::clicked, this, &HexFindDialog::replaceAll);
     }
 
     this->prepareTextMode(gboptions->layout());
     this->prepareHexMode(gboptions->layout());
     this->prepareIntMode(gboptions->layout());
     this->prepareFloatMode(gboptions->layout());
+    this->prepareFuzzyMode(gboptions->layout());
+    this->prepareRangeMode(gboptions->layout());
     this->updateFindOptions(-1);
 }
 
@@ -169,16 +206,23 @@ void HexFindDialog::updateFindOptions(int) {
         return;
 
     m_findoptions = QHexFindOptions::None;
-    m_oldidxbits = m_oldidxendian = -1;
+    m_oldidxbits = m_oldidxendian = m_oldidxencoding = -1;
 
     auto* stack = qobject_cast<QStackedLayout*>(gboptions->layout());
 
     switch(mode) {
-        case QHexFindMode::Text: {
+        case QHexFindMode::Text:
+        case QHexFindMode::Regex: {
             lefind->setValidator(nullptr);
             if(lereplace)
                 lereplace->setValidator(nullptr);
 
+            // Regex literals are always UTF-8
+            auto* cbencoding =
+                this->findChild<QComboBox*>(HexFindDialog::CBENCODING);
+            cbencoding->setCurrentIndex(0);
+            cbencoding->setEnabled(mode == QHexFindMode::Text);
+
             stack->setCurrentIndex(0);
             gboptions->setVisible(true);
             break;
@@ -212,9 +256,50 @@ void HexFindDialog::updateFindOptions(int) {
             gboptions->setVisible(true);
             break;
         }
+
+        case QHexFindMode::Fuzzy: {
+            lefind->setValidator(m_hexpvalidator);
+            if(lereplace)
+                lereplace->setValidator(m_hexvalidator);
+
+            m_findoptions = this->fuzzyOptions();
+            stack->setCurrentIndex(4);
+            gboptions->setVisible(true);
+            break;
+        }
+
+        case QHexFindMode::Range: {
+            lefind->setValidator(nullptr);
+            m_findoptions = this->rangeOptions();
+            stack->setCurrentIndex(5);
+            gboptions->setVisible(true);
+            break;
+        }
     }
 }
 
+unsigned int HexFindDialog::fuzzyOptions() const {
+    auto* sbdistance = this->findChild<QSpinBox*>(HexFindDialog::SBDISTANCE);
+    auto* cbmetric = this->findChild<QComboBox*>(HexFindDialog::CBMETRIC);
+
+    return QHexFindOptions::withDistance(sbdistance->value()) |
+           cbmetric->currentData().toUInt();
+}
+
+unsigned int HexFindDialog::rangeOptions() const {
+    auto* bgtypes =
+        this->findChild<QButtonGroup*>(HexFindDialog::BGRANGETYPES);
+    auto* cbendian = this->findChild<QComboBox*>(HexFindDialog::CBRANGEENDIAN);
+    unsigned int options = cbendian->currentData().toUInt();
+
+    for(QAbstractButton* b : bgtypes->buttons()) {
+        if(b->isChecked())
+            options |= static_cast<unsigned int>(bgtypes->id(b));
+    }
+
+    return options;
+}
+
 bool HexFindDialog::validateIntRange(uint v) const {
     if(m_findoptions & QHexFindOptions::Int8)
         return !(v > std::numeric_limits<quint8>::max());
@@ -257,6 +342,23 @@ void HexFindDialog::validateActions() {
             replaceenable = findenable;
             break;
 
+        case QHexFindMode::Regex:
+            findenable = QHexRegex{lefind->text()}.isValid();
+            replaceenable = findenable;
+            break;
+
+        case QHexFindMode::Fuzzy:
+            findenable = QHexFuzzy{lefind->text(),
+                                   QHexFindOptions::distanceOf(m_findoptions)}
+                             .isValid();
+            replaceenable = findenable;
+            break;
+
+        case QHexFindMode::Range:
+            findenable =
+                QHexValueRange{lefind->text(), m_findoptions}.isValid();
+            break;
+
         case QHexFindMode::Float: {
             lefind->text().toFloat(&findenable);
             if(lereplace && findenable)
@@ -279,8 +381,16 @@ void HexFindDialog::validateActions() {
             break;
     }
 
-    if(lereplace)
+    if(lereplace) {
         buttonbox->button(QDialogButtonBox::Apply)->setEnabled(replaceenable);
+        this->findChild<QPushButton*>(HexFindDialog::PBREPLACEALL)
+            ->setEnabled(replaceenable);
+    }
+    else {
+        this->findChild<QPushButton*>(HexFindDialog::PBFINDALL)
+            ->setEnabled(findenable);
+    }
+
     buttonbox->button(QDialogButtonBox::Ok)->setEnabled(findenable);
 }
 
@@ -299,6 +409,28 @@ void HexFindDialog::replace() {
     this->checkResult(q1, offset, fd);
 }
 
+void HexFindDialog::replaceAll() {
+    QString q1;
+    QHexFindMode mode;
+    QHexFindDirection fd;
+
+    if(!this->prepareOptions(q1, mode, fd)) // Direction doesn't matter
+        return;
+
+    QString q2 = this->findChild<QLineEdit*>(HexFindDialog::LEREPLACE)->text();
+    int count =
+        this->hexView()->hexCursor()->replaceAll(q1, q2, mode, m_findoptions);
+
+    if(!count) {
+        QMessageBox::information(this, tr("Not found"),
+                                 tr("Cannot find '%1'").arg(q1));
+        return;
+    }
+
+    QMessageBox::information(this, tr("Replace All"),
+                             tr("Replaced %1 occurrence(s)").arg(count));
+}
+
 void HexFindDialog::find() {
     QString q;
     QHexFindMode mode;
@@ -313,6 +445,20 @@ void HexFindDialog::find() {
     this->checkResult(q, offset, fd);
 }
 
+void HexFindDialog::findAll() {
+    QString q;
+    QHexFindMode mode;
+    QHexFindDirection fd;
+
+    if(!this->prepareOptions(q, mode, fd)) // Whole document
+        return;
+
+    if(!this->hexView()->findAll(q, mode, m_findoptions)) {
+        QMessageBox::information(this, tr("Not found"),
+                                 tr("Cannot find '%1'").arg(q));
+    }
+}
+
 bool HexFindDialog::prepareOptions(QString& q, QHexFindMode& mode,
                                    QHexFindDirection& fd) {
     q = this->findChild<QLineEdit*>(HexFindDialog::LEFIND)->text();
@@ -327,6 +473,39 @@ bool HexFindDialog::prepareOptions(QString& q, QHexFindMode& mode,
         return false;
     }
 
+    if(mode == QHexFindMode::Fuzzy &&
+       !QHexFuzzy{q, QHexFindOptions::distanceOf(m_findoptions)}.isValid()) {
+        QMessageBox::warning(
+            this, tr("Pattern Error"),
+            tr("Fuzzy pattern '%1' is not valid: up to %2 bytes without "
+               "'..', with more bytes than errors")
+                .arg(q)
+                .arg(QHexFuzzy::MAX_LENGTH));
+        return false;
+    }
+
+    if(mode == QHexFindMode::Range) {
+        QHexValueRange range{q, m_findoptions};
+
+        if(!range.isValid()) {
+            QMessageBox::warning(
+                this, tr("Range Error"),
+                tr("Range '%1' is not valid: %2").arg(q, range.errorString()));
+            return false;
+        }
+    }
+
+    if(mode == QHexFindMode::Regex) {
+        QHexRegex rx{q};
+
+        if(!rx.isValid()) {
+            QMessageBox::warning(
+                this, tr("Pattern Error"),
+                tr("Regex '%1' is not valid: %2").arg(q, rx.errorString()));
+            return false;
+        }
+    }
+
     if(this->findChild<QRadioButton*>(HexFindDialog::RBBACKWARD)->isChecked())
         fd = QHexFindDirection::Backward;
     else if(this->findChild<QRadioButton*>(HexFindDialog::RBFORWARD)
@@ -357,8 +536,35 @@ void HexFindDialog::prepareTextMode(QLayout* l) {
     });
 #endif
 
+    static const QList<QPair<QString, unsigned int>> ENCODINGS = {
+        qMakePair<QString, unsigned int>("UTF-8", 0),
+        qMakePair<QString, unsigned int>("UTF-16 LE", QHexFindOptions::Utf16LE),
+        qMakePair<QString, unsigned int>("UTF-16 BE", QHexFindOptions::Utf16BE),
+        qMakePair<QString, unsigned int>("UTF-32 LE", QHexFindOptions::Utf32LE),
+        qMakePair<QString, unsigned int>("UTF-32 BE", QHexFindOptions::Utf32BE),
+        qMakePair<QString, unsigned int>("Latin-1", QHexFindOptions::Latin1)};
+
+    auto* cbencoding = new QComboBox();
+    cbencoding->setObjectName(HexFindDialog::CBENCODING);
+    for(const auto& it : ENCODINGS)
+        cbencoding->addItem(it.first, it.second);
+
+    connect(cbencoding, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, [this, cbencoding](int index) {
+                if(m_oldidxencoding > -1)
+                    m_findoptions &=
+                        ~cbencoding->itemData(m_oldidxencoding).toUInt();
+                m_findoptions |= cbencoding->itemData(index).toUInt();
+                m_oldidxencoding = index;
+            });
+
     auto* vlayout = new QVBoxLayout(new QWidget());
     vlayout->addWidget(cbcasesensitive);
+
+    auto* hlayout = new QHBoxLayout();
+    hlayout->addWidget(new QLabel(tr("Encoding:")));
+    hlayout->addWidget(cbencoding, 1);
+    vlayout->addLayout(hlayout);
     l->addWidget(vlayout->parentWidget());
 }
 
@@ -426,3 +632,101 @@ void HexFindDialog::prepareFloatMode(QLayout* l) {
 
     l->addWidget(vlayout->parentWidget());
 }
+
+void HexFindDialog::prepareFuzzyMode(QLayout* l) {
+    auto* sbdistance = new QSpinBox();
+    sbdistance->setObjectName(HexFindDialog::SBDISTANCE);
+    sbdistance->setRange(0, QHexFuzzy::MAX_DISTANCE);
+    sbdistance->setValue(1);
+
+    auto* cbmetric = new QComboBox();
+    cbmetric->setObjectName(HexFindDialog::CBMETRIC);
+    cbmetric->addItem(tr("Hamming (replaced bytes)"), 0);
+    cbmetric->addItem(tr("Levenshtein (replaced, added, removed)"),
+                      QHexFindOptions::Levenshtein);
+
+    auto update = [this]() {
+        m_findoptions = this->fuzzyOptions();
+        this->validateActions();
+    };
+
+    connect(sbdistance, QOverload<int>::of(&QSpinBox::valueChanged), this,
+            update);
+    connect(cbmetric, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, update);
+
+    auto* vlayout = new QVBoxLayout(new QWidget());
+
+    QGridLayout* gl = new QGridLayout();
+    gl->addWidget(new QLabel(tr("Max distance:")), 0, 0, Qt::AlignRight);
+    gl->addWidget(sbdistance, 0, 1);
+    gl->addWidget(new QLabel(tr("Metric:")), 1, 0, Qt::AlignRight);
+    gl->addWidget(cbmetric, 1, 1);
+    vlayout->addLayout(gl);
+
+    l->addWidget(vlayout->parentWidget());
+}
+
+void HexFindDialog::prepareRangeMode(QLayout* l) {
+    static const QList<QPair<QString, unsigned int>> RANGE_TYPES = {
+        qMakePair<QString, unsigned int>("8", QHexFindOptions::Int8),
+        qMakePair<QString, unsigned int>("16", QHexFindOptions::Int16),
+        qMakePair<QString, unsigned int>("32", QHexFindOptions::Int32),
+        qMakePair<QString, unsigned int>("64", QHexFindOptions::Int64),
+        qMakePair<QString, unsigned int>("float", QHexFindOptions::Float),
+        qMakePair<QString, unsigned int>("double", QHexFindOptions::Double)};
+
+    // Nothing checked: every integer type, or both floating point ones
+    // for fractional bounds
+    auto* bgtypes = new QButtonGroup(this);
+    bgtypes->setObjectName(HexFindDialog::BGRANGETYPES);
+    bgtypes->setExclusive(false);
+
+    auto* typeslayout = new QHBoxLayout();
+
+    for(const auto& it : RANGE_TYPES) {
+        auto* cb = new QCheckBox(it.first);
+        bgtypes->addButton(cb, static_cast<int>(it.second));
+        typeslayout->addWidget(cb);
+    }
+
+    auto* cbsigned = new QCheckBox(tr("Signed"));
+    bgtypes->addButton(cbsigned, static_cast<int>(QHexFindOptions::Signed));
+    auto* cbaligned = new QCheckBox(tr("Aligned"));
+    bgtypes->addButton(cbaligned, static_cast<int>(QHexFindOptions::Aligned));
+
+    auto* cbendian = new QComboBox();
+    cbendian->setObjectName(HexFindDialog::CBRANGEENDIAN);
+    cbendian->addItem("Little Endian", 0);
+    cbendian->addItem("Big Endian", QHexFindOptions::BigEndian);
+    cbendian->addItem("Both", QHexFindOptions::LittleEndian |
+                                  QHexFindOptions::BigEndian);
+
+    auto update = [this]() {
+        m_findoptions = this->rangeOptions();
+        this->validateActions();
+    };
+
+    connect(bgtypes,
+            QOverload<QAbstractButton*, bool>::of(&QButtonGroup::buttonToggled),
+            this, update);
+    connect(cbendian, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, update);
+
+    auto* vlayout = new QVBoxLayout(new QWidget());
+
+    QGridLayout* gl = new QGridLayout();
+    gl->addWidget(new QLabel(tr("Type:")), 0, 0, Qt::AlignRight);
+    gl->addLayout(typeslayout, 0, 1);
+    gl->addWidget(new QLabel(tr("Endian:")), 1, 0, Qt::AlignRight);
+    gl->addWidget(cbendian, 1, 1);
+    vlayout->addLayout(gl);
+
+    auto* hlayout = new QHBoxLayout();
+    hlayout->addWidget(cbsigned);
+    hlayout->addWidget(cbaligned);
+    hlayout->addStretch(1);
+    vlayout->addLayout(hlayout);
+
+    l->addWidget(vlayout->parentWidget());
+}
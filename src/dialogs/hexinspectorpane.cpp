@@ -0,0 +1,172 @@
+#include <QCheckBox>
+#include <QHeaderView>
+#include <QHexView/dialogs/hexinspectorpane.h>
+#include <QHexView/qhexview.h>
+#include <QTreeWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+enum class RowType {
+    Int,
+    UInt,
+    Float,
+    ULEB128,
+    SLEB128,
+    UnixTime,
+    FileTime,
+    Guid,
+};
+
+struct Row {
+    const char* name;
+    RowType type;
+    unsigned int options;
+};
+
+const Row ROWS[] = {
+    {"int8", RowType::Int, QHexFindOptions::Int8},
+    {"uint8", RowType::UInt, QHexFindOptions::Int8},
+    {"int16", RowType::Int, QHexFindOptions::Int16},
+    {"uint16", RowType::UInt, QHexFindOptions::Int16},
+    {"int32", RowType::Int, QHexFindOptions::Int32},
+    {"uint32", RowType::UInt, QHexFindOptions::Int32},
+    {"int64", RowType::Int, QHexFindOptions::Int64},
+    {"uint64", RowType::UInt, QHexFindOptions::Int64},
+    {"float", RowType::Float, QHexFindOptions::Float},
+    {"double", RowType::Float, QHexFindOptions::Double},
+    {"ULEB128", RowType::ULEB128, QHexFindOptions::None},
+    {"SLEB128", RowType::SLEB128, QHexFindOptions::None},
+    {"time32_t", RowType::UnixTime, QHexFindOptions::Int32},
+    {"time64_t", RowType::UnixTime, QHexFindOptions::Int64},
+    {"FILETIME", RowType::FileTime, QHexFindOptions::None},
+    {"GUID", RowType::Guid, QHexFindOptions::None},
+};
+
+const int NROWS = sizeof(ROWS) / sizeof(Row);
+
+} // namespace
+
+HexInspectorPane::HexInspectorPane(QHexView* hexview, QWidget* parent)
+    : QWidget{parent}, m_hexview{hexview} {
+    auto* vlayout = new QVBoxLayout(this);
+    vlayout->setContentsMargins(0, 0, 0, 0);
+
+    m_twvalues = new QTreeWidget(this);
+    m_twvalues->setColumnCount(2);
+    m_twvalues->setHeaderLabels({tr("Type"), tr("Value")});
+    m_twvalues->setRootIsDecorated(false);
+    m_twvalues->setUniformRowHeights(true);
+    m_twvalues->header()->setSectionResizeMode(0,
+                                               QHeaderView::ResizeToContents);
+
+    for(int i = 0; i < NROWS; i++)
+        new QTreeWidgetItem(m_twvalues, {QString::fromLatin1(ROWS[i].name)});
+
+    m_cbbigendian = new QCheckBox(tr("Big Endian"), this);
+
+    vlayout->addWidget(m_twvalues, 1);
+    vlayout->addWidget(m_cbbigendian);
+
+    connect(m_cbbigendian, &QCheckBox::toggled, this,
+            &HexInspectorPane::updateValues);
+    connect(hexview, &QHexView::positionChanged, this,
+            &HexInspectorPane::updateValues);
+
+    connect(hexview, &QHexView::dataChanged, this, [this]() {
+        // The view may have switched document since the last update
+        m_inspector.setDocument(m_hexview->hexDocument());
+        m_inspector.invalidate();
+        this->updateValues();
+    });
+}
+
+QHexView* HexInspectorPane::hexView() const { return m_hexview; }
+const QHexInspector* HexInspectorPane::inspector() const {
+    return &m_inspector;
+}
+
+void HexInspectorPane::updateValues() {
+    // Hidden panes catch up in showEvent()
+    if(!m_hexview || !this->isVisible())
+        return;
+
+    m_inspector.setDocument(m_hexview->hexDocument());
+    m_inspector.setOffset(m_hexview->offset());
+
+    unsigned int endian =
+        m_cbbigendian->isChecked() ? QHexFindOptions::BigEndian : 0;
+
+    for(int i = 0; i < NROWS; i++) {
+        unsigned int options = ROWS[i].options | endian;
+        QString s;
+
+        switch(ROWS[i].type) {
+            case RowType::Int: {
+                qint64 v;
+                if(m_inspector.readInt(options, v))
+                    s = QString::number(v);
+                break;
+            }
+
+            case RowType::UInt: {
+                quint64 v;
+                if(m_inspector.readUInt(options, v))
+                    s = QString::number(v);
+                break;
+            }
+
+            case RowType::Float: {
+                double v;
+                int prec = (options & QHexFindOptions::Float) ? 9 : 17;
+                if(m_inspector.readFloat(options, v))
+                    s = QString::number(v, 'g', prec);
+                break;
+            }
+
+            case RowType::ULEB128: {
+                quint64 v;
+                int len;
+                if(m_inspector.readULEB128(v, &len))
+                    s = tr("%1 (%2 bytes)").arg(v).arg(len);
+                break;
+            }
+
+            case RowType::SLEB128: {
+                qint64 v;
+                int len;
+                if(m_inspector.readSLEB128(v, &len))
+                    s = tr("%1 (%2 bytes)").arg(v).arg(len);
+                break;
+            }
+
+            case RowType::UnixTime: {
+                QDateTime v;
+                if(m_inspector.readUnixTime(options, v))
+                    s = v.toString(Qt::ISODate);
+                break;
+            }
+
+            case RowType::FileTime: {
+                QDateTime v;
+                if(m_inspector.readFileTime(options, v))
+                    s = v.toString(Qt::ISODate);
+                break;
+            }
+
+            case RowType::Guid: {
+                QUuid v;
+                if(m_inspector.readGuid(options, v))
+                    s = v.toString();
+                break;
+            }
+        }
+
+        m_twvalues->topLevelItem(i)->setText(1, s);
+    }
+}
+
+void HexInspectorPane::showEvent(QShowEvent* e) {
+    QWidget::showEvent(e);
+    this->updateValues();
+}
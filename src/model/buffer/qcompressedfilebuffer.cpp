@@ -0,0 +1,493 @@
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHexView/model/buffer/qcompressedfilebuffer.h>
+#include <QHexView/model/qhexprofiler.h>
+#include <QTemporaryFile>
+#include <cstring>
+#include <zlib.h>
+
+// Seek index layout (zran style):
+//   header (INDEX_HEADER_SIZE bytes)
+//   one WINDOW_SIZE dictionary per access point
+//   access point table
+
+namespace {
+
+const char INDEX_MAGIC[] = "QHXIDX01";
+const quint32 INDEX_VERSION = 1;
+const qint64 INDEX_HEADER_SIZE = 64;
+const int WINDOW_SIZE = 32768; // Max deflate back reference
+const int CHUNK_SIZE = 64 * 1024;
+const int GZIP_TRAILER_SIZE = 8; // CRC32 + ISIZE
+const int ZLIB_TRAILER_SIZE = 4; // Adler-32
+const qint64 POINT_SIZE = 8 + 8 + 4; // Serialized access point
+const qint64 SPAN = 1024 * 1024; // Uncompressed distance between points
+const int CACHE_BLOCKS = 8;
+
+} // namespace
+
+QCompressedFileBuffer::QCompressedFileBuffer(QObject* parent)
+    : QHexBuffer{parent} {}
+
+QString QCompressedFileBuffer::indexFileName(const QString& filename) {
+    return filename + QStringLiteral(".qhxidx");
+}
+
+uchar QCompressedFileBuffer::at(qint64 idx) {
+    int i = this->findPoint(idx);
+    if(i == -1)
+        return uchar{};
+
+    const QByteArray& b = this->block(i);
+    qint64 pos = idx - m_points[i].out;
+    return pos < b.size() ? static_cast<uchar>(b.at(pos)) : uchar{};
+}
+
+qint64 QCompressedFileBuffer::length() const { return m_length; }
+
+void QCompressedFileBuffer::insert(qint64 offset, const QByteArray& data) {
+    Q_UNUSED(offset)
+    Q_UNUSED(data)
+    // Read only
+}
+
+void QCompressedFileBuffer::replace(qint64 offset, const QByteArray& data) {
+    Q_UNUSED(offset)
+    Q_UNUSED(data)
+    // Read only
+}
+
+void QCompressedFileBuffer::remove(qint64 offset, int length) {
+    Q_UNUSED(offset)
+    Q_UNUSED(length)
+    // Read only
+}
+
+QByteArray QCompressedFileBuffer::read(qint64 offset, int length) {
+    if(offset < 0 || offset >= m_length || length <= 0)
+        return {};
+
+    length = static_cast<int>(qMin<qint64>(length, m_length - offset));
+
+    QByteArray res;
+    res.reserve(length);
+
+    for(int i = this->findPoint(offset); i != -1 && res.size() < length;
+        i++) {
+        const QByteArray& b = this->block(i);
+        qint64 pos = offset + res.size() - m_points[i].out;
+        if(pos >= b.size())
+            break;
+
+        res.append(b.constData() + pos,
+                   static_cast<int>(qMin<qint64>(b.size() - pos,
+                                                 length - res.size())));
+
+        if(i + 1 >= m_points.size())
+            break;
+    }
+
+    return res;
+}
+
+bool QCompressedFileBuffer::read(QIODevice* device) {
+    m_device = device;
+    if(!m_device)
+        return false;
+
+    if(!m_device->isOpen())
+        m_device->open(QIODevice::ReadOnly);
+    if(!m_device->isOpen() || m_device->isSequential())
+        return false;
+
+    m_blocks.clear();
+    m_points.clear();
+    m_length = 0;
+    m_compressedsize = m_device->size();
+    m_mtime = 0;
+
+    // Tells which trailer and header follow the end of a member
+    QByteArray magic = m_device->peek(2);
+    m_gzip = magic.size() == 2 && static_cast<uchar>(magic[0]) == 0x1f &&
+             static_cast<uchar>(magic[1]) == 0x8b;
+
+    QString indexname;
+    QFile* f = qobject_cast<QFile*>(m_device);
+
+    if(f) {
+        indexname = QCompressedFileBuffer::indexFileName(f->fileName());
+        m_mtime = QFileInfo(f->fileName()).lastModified().toMSecsSinceEpoch();
+    }
+
+    return this->loadIndex(indexname) || this->buildIndex(indexname);
+}
+
+void QCompressedFileBuffer::write(QIODevice* device) {
+    for(int i = 0; i < m_points.size(); i++)
+        device->write(this->block(i));
+}
+
+QHexBuffer* QCompressedFileBuffer::createReader() const {
+    auto* f = qobject_cast<QFile*>(m_device);
+    if(!f || f->fileName().isEmpty() || !m_indexfile || m_points.isEmpty())
+        return nullptr;
+
+    // Same index, separate handles and block cache
+    auto* reader = new QCompressedFileBuffer();
+    auto* rf = new QFile(f->fileName(), reader);
+    auto* ri = new QFile(m_indexfile->fileName(), reader);
+
+    if(!rf->open(QFile::ReadOnly) || !ri->open(QFile::ReadOnly)) {
+        delete reader;
+        return nullptr;
+    }
+
+    reader->m_device = rf;
+    reader->m_indexfile = ri;
+    reader->m_points = m_points;
+    reader->m_length = m_length;
+    reader->m_compressedsize = m_compressedsize;
+    reader->m_mtime = m_mtime;
+    reader->m_gzip = m_gzip;
+    return reader;
+}
+
+qint64 QCompressedFileBuffer::indexOf(const QByteArray& ba, qint64 from) {
+    if(ba.isEmpty())
+        return -1;
+    return this->scanForward(ba, qMax<qint64>(from, 0), m_length);
+}
+
+qint64 QCompressedFileBuffer::lastIndexOf(const QByteArray& ba,
+                                          qint64 from) {
+    if(ba.isEmpty())
+        return -1;
+    return this->scanBackward(ba, 0, qMin(from + ba.size(), m_length));
+}
+
+bool QCompressedFileBuffer::loadIndex(const QString& indexname) {
+    if(indexname.isEmpty())
+        return false;
+
+    auto* f = new QFile(indexname, this);
+
+    if(!f->open(QFile::ReadOnly)) {
+        delete f;
+        return false;
+    }
+
+    QDataStream ds(f);
+    char magic[sizeof(INDEX_MAGIC) - 1];
+    quint32 version = 0;
+    qint64 compressedsize = 0, mtime = 0, length = 0, tableoffset = 0;
+    qint32 npoints = 0;
+
+    ds.readRawData(magic, sizeof(magic));
+    ds >> version >> compressedsize >> mtime >> length >> npoints >>
+        tableoffset;
+
+    // Stale, incomplete or truncated indexes are simply rebuilt
+    if(ds.status() != QDataStream::Ok ||
+       std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) ||
+       version != INDEX_VERSION || compressedsize != m_compressedsize ||
+       mtime != m_mtime || npoints <= 0 || length <= 0 ||
+       tableoffset != INDEX_HEADER_SIZE + qint64{npoints} * WINDOW_SIZE ||
+       f->size() < tableoffset + npoints * POINT_SIZE ||
+       !f->seek(tableoffset)) {
+        delete f;
+        return false;
+    }
+
+    QVector<AccessPoint> points;
+    points.reserve(npoints);
+
+    for(qint32 i = 0; i < npoints; i++) {
+        qint64 out = 0, in = 0;
+        qint32 bits = 0;
+        ds >> out >> in >> bits;
+
+        if(out >= length || in > compressedsize || bits < 0 || bits > 7 ||
+           (!points.isEmpty() && out <= points.last().out))
+            break;
+
+        points.append({out, in, bits});
+    }
+
+    if(ds.status() != QDataStream::Ok || points.size() != npoints) {
+        delete f;
+        return false;
+    }
+
+    delete m_indexfile;
+    m_indexfile = f;
+    m_points = points;
+    m_length = length;
+    return true;
+}
+
+bool QCompressedFileBuffer::buildIndex(const QString& indexname) {
+    QFile* f = nullptr;
+
+    if(!indexname.isEmpty()) {
+        f = new QFile(indexname, this);
+
+        if(!f->open(QFile::ReadWrite | QFile::Truncate)) {
+            delete f;
+            f = nullptr;
+        }
+    }
+
+    if(!f) { // Not persistable, keep it for this session only
+        auto* tf = new QTemporaryFile(this);
+
+        if(!tf->open()) {
+            delete tf;
+            return false;
+        }
+
+        f = tf;
+    }
+
+    delete m_indexfile;
+    m_indexfile = f;
+
+    // Leave the header zeroed until the index is complete
+    QByteArray header(INDEX_HEADER_SIZE, 0);
+    if(m_indexfile->write(header) != INDEX_HEADER_SIZE)
+        return false;
+
+    z_stream strm{};
+    if(inflateInit2(&strm, 47) != Z_OK) // Auto detect gzip/zlib header
+        return false;
+
+    QByteArray input(CHUNK_SIZE, Qt::Uninitialized);
+    QByteArray window(WINDOW_SIZE, Qt::Uninitialized);
+    QByteArray dict(WINDOW_SIZE, Qt::Uninitialized);
+    qint64 totin = 0, totout = 0, last = 0, endout = -1;
+    bool ok = true;
+    int ret = Z_OK;
+
+    m_device->seek(0);
+    strm.avail_out = 0;
+
+    while(ok) {
+        qint64 n = m_device->read(input.data(), input.size());
+        if(n <= 0)
+            break;
+
+        strm.next_in = reinterpret_cast<Bytef*>(input.data());
+        strm.avail_in = static_cast<uInt>(n);
+
+        do {
+            if(!strm.avail_out) {
+                strm.avail_out = WINDOW_SIZE;
+                strm.next_out = reinterpret_cast<Bytef*>(window.data());
+            }
+
+            totin += strm.avail_in;
+            totout += strm.avail_out;
+            ret = inflate(&strm, Z_BLOCK);
+            totin -= strm.avail_in;
+            totout -= strm.avail_out;
+
+            if(ret == Z_NEED_DICT || ret == Z_DATA_ERROR ||
+               ret == Z_MEM_ERROR) {
+                // Trailing garbage after a complete member is ignored
+                if(ret == Z_MEM_ERROR)
+                    endout = -1;
+                ok = false;
+                break;
+            }
+
+            if(ret == Z_STREAM_END) { // Concatenated members
+                endout = totout;
+                inflateReset(&strm);
+                continue;
+            }
+
+            // At the end of a deflate block, but not the last one
+            if((strm.data_type & 128) && !(strm.data_type & 64) &&
+               (totout == 0 || totout - last > SPAN)) {
+                int left = static_cast<int>(strm.avail_out);
+
+                if(left)
+                    std::memcpy(dict.data(),
+                                window.constData() + WINDOW_SIZE - left, left);
+                if(left < WINDOW_SIZE)
+                    std::memcpy(dict.data() + left, window.constData(),
+                                WINDOW_SIZE - left);
+
+                if(m_indexfile->write(dict) != WINDOW_SIZE) {
+                    m_points.clear();
+                    ok = false;
+                    break;
+                }
+
+                m_points.append({totout, totin, strm.data_type & 7});
+                last = totout;
+            }
+        } while(strm.avail_in);
+    }
+
+    inflateEnd(&strm);
+
+    // Drop points of a truncated trailing member
+    while(!m_points.isEmpty() && m_points.last().out >= endout)
+        m_points.removeLast();
+
+    if(endout <= 0 || m_points.isEmpty()) {
+        m_points.clear();
+        return false;
+    }
+
+    m_length = endout;
+    return this->writeIndexHeader();
+}
+
+bool QCompressedFileBuffer::writeIndexHeader() {
+    qint64 tableoffset =
+        INDEX_HEADER_SIZE + qint64{m_points.size()} * WINDOW_SIZE;
+
+    if(!m_indexfile->seek(tableoffset))
+        return false;
+
+    QDataStream ds(m_indexfile);
+
+    for(const AccessPoint& p : m_points)
+        ds << p.out << p.in << qint32{p.bits};
+
+    m_indexfile->seek(0);
+    ds.writeRawData(INDEX_MAGIC, sizeof(INDEX_MAGIC) - 1);
+    ds << INDEX_VERSION << m_compressedsize << m_mtime << m_length
+       << static_cast<qint32>(m_points.size()) << tableoffset;
+
+    m_indexfile->flush();
+    return ds.status() == QDataStream::Ok;
+}
+
+int QCompressedFileBuffer::findPoint(qint64 offset) const {
+    if(offset < 0 || offset >= m_length || m_points.isEmpty())
+        return -1;
+
+    int lo = 0, hi = m_points.size() - 1;
+
+    while(lo < hi) { // Last point with out <= offset
+        int mid = (lo + hi + 1) / 2;
+
+        if(m_points[mid].out <= offset)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    return lo;
+}
+
+QByteArray QCompressedFileBuffer::window(int point) {
+    if(!m_indexfile->seek(INDEX_HEADER_SIZE + qint64{point} * WINDOW_SIZE))
+        return {};
+    return m_indexfile->read(WINDOW_SIZE);
+}
+
+QByteArray QCompressedFileBuffer::inflateBlock(int point) {
+    const AccessPoint& p = m_points[point];
+    qint64 end = point + 1 < m_points.size() ? m_points[point + 1].out
+                                             : m_length;
+
+    QByteArray dict = this->window(point);
+    if(dict.size() != WINDOW_SIZE)
+        return {};
+
+    z_stream strm{};
+    if(inflateInit2(&strm, -15) != Z_OK) // Raw deflate
+        return {};
+
+    m_device->seek(p.in - (p.bits ? 1 : 0));
+
+    if(p.bits) {
+        char c;
+
+        if(!m_device->getChar(&c)) {
+            inflateEnd(&strm);
+            return {};
+        }
+
+        inflatePrime(&strm, p.bits, static_cast<uchar>(c) >> (8 - p.bits));
+    }
+
+    inflateSetDictionary(&strm, reinterpret_cast<const Bytef*>(dict.data()),
+                         WINDOW_SIZE);
+
+    QByteArray data(static_cast<int>(end - p.out), Qt::Uninitialized);
+    QByteArray input(CHUNK_SIZE, Qt::Uninitialized);
+    bool raw = true;
+    int skip = 0;
+
+    strm.next_out = reinterpret_cast<Bytef*>(data.data());
+    strm.avail_out = static_cast<uInt>(data.size());
+
+    while(strm.avail_out) {
+        if(!strm.avail_in) {
+            qint64 n = m_device->read(input.data(), input.size());
+            if(n <= 0)
+                break;
+
+            strm.next_in = reinterpret_cast<Bytef*>(input.data());
+            strm.avail_in = static_cast<uInt>(n);
+        }
+
+        if(skip) {
+            uInt n = qMin(static_cast<uInt>(skip), strm.avail_in);
+            strm.next_in += n;
+            strm.avail_in -= n;
+            skip -= n;
+            continue;
+        }
+
+        int ret = inflate(&strm, Z_NO_FLUSH);
+
+        if(ret == Z_STREAM_END) {
+            // Raw mode doesn't consume the trailer, then the next member
+            // starts with its own gzip or zlib header
+            if(raw)
+                skip = m_gzip ? GZIP_TRAILER_SIZE : ZLIB_TRAILER_SIZE;
+
+            raw = false;
+            inflateReset2(&strm, m_gzip ? 31 : 15);
+        }
+        else if(ret != Z_OK && ret != Z_BUF_ERROR)
+            break;
+    }
+
+    data.resize(data.size() - static_cast<int>(strm.avail_out));
+    inflateEnd(&strm);
+    return data;
+}
+
+const QByteArray& QCompressedFileBuffer::block(int point) {
+    auto it = m_blocks.find(point);
+
+    if(it != m_blocks.end()) {
+        it->stamp = ++m_stamp;
+        QHEXVIEW_PROFILE_COUNT(m_profiler, CacheHits, 1);
+        return it->data;
+    }
+
+    QHEXVIEW_PROFILE_COUNT(m_profiler, CacheMisses, 1);
+
+    if(m_blocks.size() >= CACHE_BLOCKS) { // Evict the least recently used
+        auto lru = m_blocks.begin();
+
+        for(auto bit = m_blocks.begin(); bit != m_blocks.end(); bit++) {
+            if(bit->stamp < lru->stamp)
+                lru = bit;
+        }
+
+        m_blocks.erase(lru);
+    }
+
+    it = m_blocks.insert(point, {this->inflateBlock(point), ++m_stamp});
+    return it->data;
+}
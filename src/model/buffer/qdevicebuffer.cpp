@@ -1,10 +1,120 @@
+#include <QAtomicInt>
+#include <QFile>
 #include <QHexView/model/buffer/qdevicebuffer.h>
+#include <QHexView/model/qhexprofiler.h>
 #include <QIODevice>
+#include <QList>
+#include <QThread>
+#include <QWaitCondition>
 #include <limits>
 
+namespace {
+
+const qint64 PAGE_SIZE = 64 * 1024;
+const int CACHE_PAGES = 256;      // 16 MiB
+const int MAX_PENDING_PAGES = 64; // 4 MiB
+const qint64 MAX_CACHED_READ = PAGE_SIZE * CACHE_PAGES / 4;
+
+} // namespace
+
+// Reads pages through a private file handle so that the GUI thread
+// never waits on the device while painting
+class QDeviceBufferWorker: public QThread {
+public:
+    explicit QDeviceBufferWorker(const QString& filename, QDeviceBuffer* buffer)
+        : QThread{buffer}, m_filename{filename}, m_buffer{buffer} {}
+
+    bool hasFailed() const { return m_failed.loadAcquire(); }
+
+    void enqueue(const QList<qint64>& pages) {
+        QMutexLocker locker(&m_mutex);
+
+        // Latest requests (the ones closer to the viewport) go first
+        for(auto it = pages.crbegin(); it != pages.crend(); it++) {
+            m_queue.removeOne(*it);
+            m_queue.prepend(*it);
+        }
+
+        while(m_queue.size() > MAX_PENDING_PAGES)
+            m_queue.removeLast();
+
+        m_cond.wakeOne();
+    }
+
+    void stop() {
+        this->requestInterruption();
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_cond.wakeOne();
+        }
+
+        this->wait();
+    }
+
+protected:
+    void run() override {
+        QFile f(m_filename);
+        QDeviceBuffer* buffer = m_buffer;
+
+        if(!f.open(QFile::ReadOnly)) {
+            m_failed.storeRelease(1); // Fallback to synchronous reads
+
+            QMetaObject::invokeMethod(
+                buffer,
+                [buffer]() {
+                    Q_EMIT buffer->dataAvailable(0, buffer->length());
+                },
+                Qt::QueuedConnection);
+            return;
+        }
+
+        while(!this->isInterruptionRequested()) {
+            qint64 page = -1;
+
+            {
+                QMutexLocker locker(&m_mutex);
+
+                while(m_queue.isEmpty() && !this->isInterruptionRequested())
+                    m_cond.wait(&m_mutex);
+
+                if(this->isInterruptionRequested())
+                    break;
+
+                page = m_queue.takeFirst();
+            }
+
+            quint64 generation = 0;
+            if(buffer->isCached(page, generation) || !f.seek(page * PAGE_SIZE))
+                continue;
+
+            QByteArray data = f.read(PAGE_SIZE);
+            if(!buffer->cachePage(page, data, generation))
+                continue;
+
+            QMetaObject::invokeMethod(
+                buffer,
+                [buffer, page, data]() {
+                    Q_EMIT buffer->dataAvailable(page * PAGE_SIZE, data.size());
+                },
+                Qt::QueuedConnection);
+        }
+    }
+
+private:
+    QString m_filename;
+    QDeviceBuffer* m_buffer;
+    QMutex m_mutex;
+    QWaitCondition m_cond;
+    QList<qint64> m_queue;
+    QAtomicInt m_failed{0};
+};
+
 QDeviceBuffer::QDeviceBuffer(QObject* parent): QHexBuffer{parent} {}
 
 QDeviceBuffer::~QDeviceBuffer() {
+    this->stopWorker();
+
     if(!m_device)
         return;
 
@@ -18,14 +128,55 @@ QDeviceBuffer::~QDeviceBuffer() {
 }
 
 uchar QDeviceBuffer::at(qint64 idx) {
-    m_device->seek(idx);
+    if(!m_worker || m_worker->hasFailed()) {
+        m_device->seek(idx);
+
+        char c = '\0';
+        m_device->getChar(&c);
+        return static_cast<uchar>(c);
+    }
 
-    char c = '\0';
-    m_device->getChar(&c);
-    return static_cast<uchar>(c);
+    QByteArray data = this->page(idx / PAGE_SIZE, true);
+    int pgoffset = static_cast<int>(idx % PAGE_SIZE);
+    return pgoffset < data.size() ? static_cast<uchar>(data.at(pgoffset))
+                                  : uchar{};
 }
 
-qint64 QDeviceBuffer::length() const { return m_device->size(); }
+qint64 QDeviceBuffer::length() const { return m_length; }
+
+bool QDeviceBuffer::isAvailable(qint64 offset, qint64 length) const {
+    if(!m_worker || m_worker->hasFailed())
+        return true;
+
+    qint64 end = qMin(offset + length, this->length());
+    QMutexLocker locker(&m_mutex);
+
+    for(qint64 p = qMax<qint64>(offset, 0) / PAGE_SIZE; p * PAGE_SIZE < end;
+        p++) {
+        if(!m_pages.contains(p))
+            return false;
+    }
+
+    return true;
+}
+
+void QDeviceBuffer::prefetch(qint64 offset, qint64 length) {
+    if(!m_worker || m_worker->hasFailed() || length <= 0)
+        return;
+
+    qint64 end = qMin(offset + length, this->length());
+    QList<qint64> pages;
+    quint64 generation = 0;
+
+    for(qint64 p = qMax<qint64>(offset, 0) / PAGE_SIZE; p * PAGE_SIZE < end;
+        p++) {
+        if(!this->isCached(p, generation))
+            pages.push_back(p);
+    }
+
+    if(!pages.isEmpty())
+        m_worker->enqueue(pages);
+}
 
 void QDeviceBuffer::insert(qint64 offset, const QByteArray& data) {
     Q_UNUSED(offset)
@@ -35,7 +186,15 @@ void QDeviceBuffer::insert(qint64 offset, const QByteArray& data) {
 
 void QDeviceBuffer::replace(qint64 offset, const QByteArray& data) {
     m_device->seek(offset);
-    m_device->write(data);
+    if(m_device->write(data) > 0)
+        m_length = qMax(m_length, m_device->pos());
+
+    if(m_worker) {
+        // Make the change visible to the worker's file handle too
+        if(auto* fd = qobject_cast<QFileDevice*>(m_device))
+            fd->flush();
+        this->invalidatePages(offset, data.size());
+    }
 }
 
 void QDeviceBuffer::remove(qint64 offset, int length) {
@@ -44,18 +203,39 @@ void QDeviceBuffer::remove(qint64 offset, int length) {
     // Not implemented
 }
 
+QByteArray QDeviceBuffer::peek(qint64 offset, int length) {
+    if(!m_worker || m_worker->hasFailed() || length > MAX_CACHED_READ)
+        return QHexBuffer::peek(offset, length);
+
+    // Stops at the first missing page, which gets queued
+    return this->readPages(offset, length, false);
+}
+
 QByteArray QDeviceBuffer::read(qint64 offset, int length) {
-    m_device->seek(offset);
-    return m_device->read(length);
+    if(!m_worker || m_worker->hasFailed() || length > MAX_CACHED_READ) {
+        m_device->seek(offset);
+        return m_device->read(length);
+    }
+
+    return this->readPages(offset, length, true);
 }
 
 bool QDeviceBuffer::read(QIODevice* device) {
+    this->stopWorker();
+
     m_device = device;
     if(!m_device)
         return false;
     if(!m_device->isOpen())
         m_device->open(QIODevice::ReadWrite);
-    return m_device->isOpen();
+
+    // QFile::size() is a stat() call, the views ask for it on every paint
+    m_length = m_device->isOpen() ? m_device->size() : 0;
+    if(!m_device->isOpen())
+        return false;
+
+    this->startWorker();
+    return true;
 }
 
 void QDeviceBuffer::write(QIODevice* device) {
@@ -63,6 +243,25 @@ void QDeviceBuffer::write(QIODevice* device) {
     // Not implemented
 }
 
+QHexBuffer* QDeviceBuffer::createReader() const {
+    // Edits are written through to the file, opening it again sees them
+    auto* f = qobject_cast<QFile*>(m_device);
+    if(!f || f->fileName().isEmpty())
+        return nullptr;
+
+    auto* reader = new QDeviceBuffer();
+    auto* rf = new QFile(f->fileName(), reader);
+
+    if(!rf->open(QFile::ReadOnly)) {
+        delete reader;
+        return nullptr;
+    }
+
+    reader->m_device = rf; // No prefetch worker, reads go to the file
+    reader->m_length = m_length;
+    return reader;
+}
+
 qint64 QDeviceBuffer::indexOf(const QByteArray& ba, qint64 from) {
     const auto MAX = std::numeric_limits<int>::max();
     qint64 idx = -1;
@@ -116,3 +315,114 @@ qint64 QDeviceBuffer::lastIndexOf(const QByteArray& ba, qint64 from) {
 
     return idx;
 }
+
+bool QDeviceBuffer::isCached(qint64 page, quint64& generation) const {
+    QMutexLocker locker(&m_mutex);
+    generation = m_generation;
+    return m_pages.contains(page);
+}
+
+QByteArray QDeviceBuffer::page(qint64 page, bool wait) {
+    quint64 generation = 0;
+
+    {
+        QMutexLocker locker(&m_mutex);
+        auto it = m_pages.find(page);
+
+        if(it != m_pages.end()) {
+            it->stamp = ++m_stamp;
+            QHEXVIEW_PROFILE_COUNT(m_profiler, CacheHits, 1);
+            return it->data;
+        }
+
+        generation = m_generation;
+    }
+
+    QHEXVIEW_PROFILE_COUNT(m_profiler, CacheMisses, 1);
+
+    if(!wait) { // Placeholder until dataAvailable()
+        m_worker->enqueue({page});
+        return {};
+    }
+
+    m_device->seek(page * PAGE_SIZE);
+    QByteArray data = m_device->read(PAGE_SIZE);
+    this->cachePage(page, data, generation);
+    return data;
+}
+
+QByteArray QDeviceBuffer::readPages(qint64 offset, int length, bool wait) {
+    qint64 end = qMin(offset + length, this->length());
+    QByteArray data;
+
+    if(end > offset)
+        data.reserve(static_cast<int>(end - offset));
+
+    while(offset < end) {
+        QByteArray page = this->page(offset / PAGE_SIZE, wait);
+        int pgoffset = static_cast<int>(offset % PAGE_SIZE);
+        int n = static_cast<int>(
+            qMin<qint64>(page.size() - pgoffset, end - offset));
+        if(n <= 0)
+            break;
+
+        data.append(page.constData() + pgoffset, n);
+        offset += n;
+    }
+
+    return data;
+}
+
+bool QDeviceBuffer::cachePage(qint64 page, const QByteArray& data,
+                              quint64 generation) {
+    QMutexLocker locker(&m_mutex);
+
+    // Page has been modified while it was being read
+    if(generation != m_generation)
+        return false;
+
+    if(m_pages.size() >= CACHE_PAGES && !m_pages.contains(page)) {
+        auto lru = m_pages.begin();
+
+        for(auto it = m_pages.begin(); it != m_pages.end(); it++) {
+            if(it->stamp < lru->stamp)
+                lru = it;
+        }
+
+        m_pages.erase(lru);
+    }
+
+    m_pages.insert(page, {data, ++m_stamp});
+    return true;
+}
+
+void QDeviceBuffer::invalidatePages(qint64 offset, qint64 length) {
+    QMutexLocker locker(&m_mutex);
+    m_generation++;
+
+    for(qint64 p = offset / PAGE_SIZE; p * PAGE_SIZE < offset + length; p++)
+        m_pages.remove(p);
+}
+
+void QDeviceBuffer::startWorker() {
+    // Pages are read through a private handle, only files have one
+    QFile* f = qobject_cast<QFile*>(m_device);
+    if(!f || f->fileName().isEmpty())
+        return;
+
+    m_worker = new QDeviceBufferWorker(f->fileName(), this);
+    m_worker->start();
+}
+
+void QDeviceBuffer::stopWorker() {
+    if(!m_worker)
+        return;
+
+    m_worker->stop();
+    delete m_worker;
+    m_worker = nullptr;
+
+    QMutexLocker locker(&m_mutex);
+    m_pages.clear();
+    m_generation++;
+}
@@ -1,10 +1,20 @@
 #include <QBuffer>
 #include <QHexView/model/buffer/qhexbuffer.h>
 
+namespace {
+
+const qint64 SCAN_CHUNK_SIZE = 1024 * 1024;
+
+} // namespace
+
 QHexBuffer::QHexBuffer(QObject* parent): QObject{parent} {}
 uchar QHexBuffer::at(qint64 idx) { return this->read(idx, 1).at(0); }
 bool QHexBuffer::isEmpty() const { return this->length() <= 0; }
 
+void QHexBuffer::setProfiler(QHexProfiler* profiler) {
+    m_profiler = profiler;
+}
+
 void QHexBuffer::replace(qint64 offset, const QByteArray& data) {
     this->remove(offset, data.length());
     this->insert(offset, data);
@@ -15,6 +25,38 @@ bool QHexBuffer::accept(qint64 idx) const {
     return true;
 }
 
+bool QHexBuffer::holeAt(qint64 offset, qint64& begin, qint64& end) const {
+    Q_UNUSED(offset);
+    Q_UNUSED(begin);
+    Q_UNUSED(end);
+    return false;
+}
+
+bool QHexBuffer::isAvailable(qint64 offset, qint64 length) const {
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+    return true;
+}
+
+void QHexBuffer::prefetch(qint64 offset, qint64 length) {
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+}
+
+QByteArray QHexBuffer::peek(qint64 offset, int length) {
+    if(this->isAvailable(offset, length))
+        return this->read(offset, length);
+
+    this->prefetch(offset, length); // Comes back with dataAvailable()
+    return {};
+}
+
+void QHexBuffer::release(const QString& filename) { Q_UNUSED(filename); }
+
+// A read only buffer with handles of its own on the same data, for reading
+// from another thread. Buffers without one are only read by their thread.
+QHexBuffer* QHexBuffer::createReader() const { return nullptr; }
+
 void QHexBuffer::read(char* data, int size) {
     QBuffer* buffer = new QBuffer(this);
     buffer->setData(data, size);
@@ -34,3 +76,40 @@ void QHexBuffer::read(const QByteArray& ba) {
 
     this->read(buffer);
 }
+
+qint64 QHexBuffer::scanForward(const QByteArray& ba, qint64 begin,
+                               qint64 end) {
+    for(qint64 pos = begin; pos < end;) {
+        int n = static_cast<int>(
+            qMin<qint64>(SCAN_CHUNK_SIZE + ba.size() - 1, end - pos));
+        QByteArray chunk = this->read(pos, n);
+
+        int idx = chunk.indexOf(ba);
+        if(idx != -1)
+            return pos + idx;
+        if(pos + chunk.size() >= end || chunk.size() < ba.size())
+            break;
+
+        pos += chunk.size() - ba.size() + 1;
+    }
+
+    return -1;
+}
+
+qint64 QHexBuffer::scanBackward(const QByteArray& ba, qint64 begin,
+                                qint64 end) {
+    for(qint64 pos = end; pos > begin;) {
+        qint64 cb = qMax(begin, pos - SCAN_CHUNK_SIZE - ba.size() + 1);
+        QByteArray chunk = this->read(cb, static_cast<int>(pos - cb));
+
+        int idx = chunk.lastIndexOf(ba);
+        if(idx != -1)
+            return cb + idx;
+        if(cb <= begin)
+            break;
+
+        pos = cb + ba.size() - 1;
+    }
+
+    return -1;
+}
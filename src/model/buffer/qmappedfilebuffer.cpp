@@ -12,6 +12,19 @@ QMappedFileBuffer::~QMappedFileBuffer() {
     m_mappeddata = nullptr;
 }
 
+uchar QMappedFileBuffer::at(qint64 idx) { return m_mappeddata[idx]; }
+
+bool QMappedFileBuffer::isAvailable(qint64 offset, qint64 length) const {
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+    return true; // Paging is handled by the OS
+}
+
+void QMappedFileBuffer::prefetch(qint64 offset, qint64 length) {
+    Q_UNUSED(offset);
+    Q_UNUSED(length);
+}
+
 QByteArray QMappedFileBuffer::read(qint64 offset, int length) {
     if(offset >= this->length())
         return {};
@@ -1,39 +1,507 @@
+#include <QFileDevice>
+#include <QFileInfo>
 #include <QHexView/model/buffer/qmemorybuffer.h>
 #include <QIODevice>
+#include <cstring>
+#include <limits>
 
-QMemoryBuffer::QMemoryBuffer(QObject* parent): QHexBuffer{parent} {}
+// The data is kept in a B+ tree (rope): leaves hold at most LEAF_SIZE bytes,
+// inner nodes hold up to FANOUT children and the byte count of their
+// subtree, so inserting, removing and locating an offset are O(log n).
+// Leaves can be slices of a larger shared QByteArray, freshly loaded data is
+// a single leaf that is sliced (without copying) on the first edit.
 
-uchar QMemoryBuffer::at(qint64 idx) {
-    return static_cast<uchar>(m_buffer.at(idx));
+namespace {
+
+const int LEAF_SIZE = 64 * 1024;
+const int FANOUT = 32;
+
+} // namespace
+
+struct QMemoryBuffer::Node {
+    bool leaf{true};
+    qint64 size{0};
+    QVector<Node*> children; // Inner nodes only
+    QByteArray data;         // Leaves only: [begin, begin + size)
+    int begin{0};
+
+    ~Node() { qDeleteAll(children); }
+    const char* constData() const { return data.constData() + begin; }
+};
+
+QMemoryBuffer::QMemoryBuffer(QObject* parent)
+    : QHexBuffer{parent}, m_root{new Node} {}
+
+QMemoryBuffer::~QMemoryBuffer() {
+    this->unmap();
+    delete m_root;
 }
 
-qint64 QMemoryBuffer::length() const {
-    return static_cast<qint64>(m_buffer.length());
+uchar QMemoryBuffer::at(qint64 idx) {
+    qint64 leafbegin = 0;
+    const Node* leaf = this->findLeaf(idx, leafbegin);
+    return leaf ? static_cast<uchar>(leaf->constData()[idx - leafbegin])
+                : uchar{};
 }
 
+qint64 QMemoryBuffer::length() const { return m_root->size; }
+
 void QMemoryBuffer::insert(qint64 offset, const QByteArray& data) {
-    m_buffer.insert(static_cast<int>(offset), data);
+    offset = qBound<qint64>(0, offset, m_root->size);
+    this->splitRoot();
+
+    for(int pos = 0; pos < data.size(); pos += LEAF_SIZE) {
+        QVector<Node*> siblings =
+            this->insertAt(m_root, offset + pos, data.mid(pos, LEAF_SIZE));
+        if(siblings.isEmpty())
+            continue;
+
+        auto* root = new Node;
+        root->leaf = false;
+        root->size = m_root->size;
+        root->children.append(m_root);
+
+        for(Node* s : siblings) {
+            root->children.append(s);
+            root->size += s->size;
+        }
+
+        m_root = root;
+    }
+
+    m_lastleaf = nullptr;
+}
+
+void QMemoryBuffer::replace(qint64 offset, const QByteArray& data) {
+    if(offset < 0 || offset + data.size() > m_root->size) {
+        QHexBuffer::replace(offset, data);
+        return;
+    }
+
+    this->splitRoot();
+
+    // Same length: overwrite the leaves in place
+    for(int done = 0; done < data.size();) {
+        qint64 leafbegin = 0;
+        Node* leaf = this->findLeaf(offset + done, leafbegin);
+        if(!leaf)
+            break;
+
+        QMemoryBuffer::materialize(leaf);
+        int pos = static_cast<int>(offset + done - leafbegin);
+        int n = static_cast<int>(
+            qMin<qint64>(leaf->size - pos, data.size() - done));
+        std::memcpy(leaf->data.data() + pos, data.constData() + done, n);
+        done += n;
+    }
 }
 
 void QMemoryBuffer::remove(qint64 offset, int length) {
-    m_buffer.remove(static_cast<int>(offset), length);
+    if(offset < 0 || offset >= m_root->size || length <= 0)
+        return;
+
+    this->splitRoot();
+    this->removeAt(m_root, offset,
+                   qMin<qint64>(length, m_root->size - offset));
+
+    while(!m_root->leaf && m_root->children.size() == 1) {
+        Node* child = m_root->children.first();
+        m_root->children.clear();
+        delete m_root;
+        m_root = child;
+    }
+
+    if(!m_root->leaf && m_root->children.isEmpty())
+        m_root->leaf = true;
+
+    m_lastleaf = nullptr;
 }
 
 QByteArray QMemoryBuffer::read(qint64 offset, int length) {
-    return m_buffer.mid(static_cast<int>(offset), length);
+    if(offset < 0 || offset >= m_root->size || length <= 0)
+        return {};
+
+    length = static_cast<int>(qMin<qint64>(length, m_root->size - offset));
+
+    qint64 leafbegin = 0;
+    const Node* leaf = this->findLeaf(offset, leafbegin);
+
+    if(offset + length <= leafbegin + leaf->size) {
+        // Views of the mapping would outlive it
+        if(!leaf->begin && offset == leafbegin &&
+           length == leaf->data.size() && !this->isMapped(leaf))
+            return leaf->data; // Shared
+
+        return QByteArray(leaf->constData() + (offset - leafbegin), length);
+    }
+
+    QByteArray res;
+    res.reserve(length);
+
+    while(res.size() < length) {
+        qint64 pos = offset + res.size();
+        leaf = this->findLeaf(pos, leafbegin);
+        qint64 b = pos - leafbegin;
+
+        res.append(leaf->constData() + b,
+                   static_cast<int>(
+                       qMin<qint64>(leaf->size - b, length - res.size())));
+    }
+
+    return res;
+}
+
+void QMemoryBuffer::read(char* data, int size) {
+    this->unmap();
+    this->reset(QByteArray(data, size));
+}
+
+void QMemoryBuffer::read(const QByteArray& ba) {
+    this->unmap();
+    this->reset(ba); // Implicitly shared, copied on first edit
 }
 
 bool QMemoryBuffer::read(QIODevice* device) {
-    m_buffer = device->readAll();
+    this->unmap();
+
+    if(!device->isOpen() && !device->open(QIODevice::ReadOnly))
+        return false;
+
+    this->reset(device->readAll());
     return true;
 }
 
-void QMemoryBuffer::write(QIODevice* device) { device->write(m_buffer); }
+bool QMemoryBuffer::map(QFileDevice* f) {
+    this->unmap();
+
+    if(!f->isOpen() && !f->open(QIODevice::ReadOnly))
+        return false;
+
+    if(f->size() > std::numeric_limits<int>::max())
+        return false;
+
+    // Private: edits never reach the file, the leaves touched by an edit
+    // are copied out of the mapping
+    m_mappeddata = f->map(0, f->size(), QFileDevice::MapPrivateOption);
+    if(!m_mappeddata)
+        return false;
+
+    m_mappedfile = f;
+    m_mappedsize = f->size();
+    this->reset(QByteArray::fromRawData(
+        reinterpret_cast<const char*>(m_mappeddata),
+        static_cast<int>(f->size())));
+    return true;
+}
+
+void QMemoryBuffer::write(QIODevice* device) {
+    auto* f = qobject_cast<QFileDevice*>(device);
+
+    // Don't write the mapping back into the file it comes from. If that
+    // file has been truncated already its pages are gone: bail out instead
+    // of faulting on them, QHexDocument::saveTo(filename) releases it first.
+    if(f && m_mappedfile &&
+       QFileInfo(f->fileName()) == QFileInfo(m_mappedfile->fileName())) {
+        if(m_mappedfile->size() < m_mappedsize) {
+            qWarning("QMemoryBuffer: mapped file truncated before writing");
+            return;
+        }
+
+        this->unmap(true);
+    }
+
+    this->writeNode(m_root, device);
+}
+
+void QMemoryBuffer::release(const QString& filename) {
+    if(m_mappedfile &&
+       QFileInfo(filename) == QFileInfo(m_mappedfile->fileName()))
+        this->unmap(true);
+}
 
 qint64 QMemoryBuffer::indexOf(const QByteArray& ba, qint64 from) {
-    return m_buffer.indexOf(ba, static_cast<int>(from));
+    if(m_root->leaf) {
+        return QByteArray::fromRawData(m_root->constData(),
+                                       static_cast<int>(m_root->size))
+            .indexOf(ba, static_cast<int>(from));
+    }
+
+    if(ba.isEmpty())
+        return -1;
+    return this->scanForward(ba, qMax<qint64>(from, 0), m_root->size);
 }
 
 qint64 QMemoryBuffer::lastIndexOf(const QByteArray& ba, qint64 from) {
-    return m_buffer.lastIndexOf(ba, static_cast<int>(from));
+    if(m_root->leaf) {
+        return QByteArray::fromRawData(m_root->constData(),
+                                       static_cast<int>(m_root->size))
+            .lastIndexOf(ba, static_cast<int>(from));
+    }
+
+    if(from < 0)
+        from += m_root->size;
+    if(ba.isEmpty() || from < 0)
+        return -1;
+
+    return this->scanBackward(ba, 0, qMin(from + ba.size(), m_root->size));
+}
+
+void QMemoryBuffer::reset(const QByteArray& ba) {
+    delete m_root;
+    m_root = QMemoryBuffer::createLeaf(ba, 0, ba.size());
+    m_lastleaf = nullptr;
+}
+
+void QMemoryBuffer::unmap(bool keep) {
+    if(!m_mappeddata)
+        return;
+
+    // Keeping the data copies what is still in the mapping
+    if(keep)
+        this->copyMapped(m_root);
+    else
+        this->reset({});
+
+    m_mappedfile->unmap(m_mappeddata);
+    m_mappedfile = nullptr;
+    m_mappeddata = nullptr;
+    m_mappedsize = 0;
+}
+
+bool QMemoryBuffer::isMapped(const Node* leaf) const {
+    return m_mappeddata && leaf->data.constData() ==
+                               reinterpret_cast<const char*>(m_mappeddata);
+}
+
+void QMemoryBuffer::copyMapped(Node* node) {
+    if(!node->leaf) {
+        for(Node* c : node->children)
+            this->copyMapped(c);
+    }
+    else if(this->isMapped(node)) {
+        node->data =
+            QByteArray(node->constData(), static_cast<int>(node->size));
+        node->begin = 0;
+    }
+}
+
+void QMemoryBuffer::splitRoot() {
+    if(!m_root->leaf || m_root->size <= LEAF_SIZE)
+        return;
+
+    QVector<Node*> level;
+
+    for(qint64 pos = 0; pos < m_root->size; pos += LEAF_SIZE) {
+        level.append(QMemoryBuffer::createLeaf(
+            m_root->data, m_root->begin + static_cast<int>(pos),
+            static_cast<int>(qMin<qint64>(LEAF_SIZE, m_root->size - pos))));
+    }
+
+    delete m_root;
+
+    while(level.size() > 1) {
+        QVector<Node*> parents;
+
+        for(int i = 0; i < level.size(); i += FANOUT) {
+            auto* node = new Node;
+            node->leaf = false;
+            node->children = level.mid(i, FANOUT);
+
+            for(const Node* c : node->children)
+                node->size += c->size;
+
+            parents.append(node);
+        }
+
+        level = parents;
+    }
+
+    m_root = level.first();
+    m_lastleaf = nullptr;
+}
+
+QMemoryBuffer::Node* QMemoryBuffer::findLeaf(qint64 offset,
+                                             qint64& leafbegin) {
+    if(offset < 0 || offset >= m_root->size)
+        return nullptr;
+
+    if(m_lastleaf && offset >= m_lastbegin &&
+       offset < m_lastbegin + m_lastleaf->size) {
+        leafbegin = m_lastbegin;
+        return m_lastleaf;
+    }
+
+    Node* node = m_root;
+    leafbegin = 0;
+
+    while(!node->leaf) {
+        int i = 0;
+
+        for(; i < node->children.size() - 1; i++) {
+            qint64 size = node->children[i]->size;
+            if(offset < leafbegin + size)
+                break;
+            leafbegin += size;
+        }
+
+        node = node->children[i];
+    }
+
+    m_lastleaf = node;
+    m_lastbegin = leafbegin;
+    return node;
+}
+
+QVector<QMemoryBuffer::Node*> QMemoryBuffer::insertAt(Node* node,
+                                                      qint64 offset,
+                                                      const QByteArray& data) {
+    if(node->leaf) {
+        QMemoryBuffer::materialize(node);
+        node->data.insert(static_cast<int>(offset), data);
+        node->size = node->data.size();
+
+        if(node->size <= LEAF_SIZE)
+            return {};
+        return QMemoryBuffer::splitLeaf(node);
+    }
+
+    int i = 0;
+
+    for(; i < node->children.size() - 1; i++) {
+        qint64 size = node->children[i]->size;
+        if(offset <= size)
+            break;
+        offset -= size;
+    }
+
+    QVector<Node*> siblings = this->insertAt(node->children[i], offset, data);
+    node->size += data.size();
+
+    if(siblings.isEmpty())
+        return {};
+
+    for(int j = 0; j < siblings.size(); j++)
+        node->children.insert(i + j + 1, siblings[j]);
+
+    if(node->children.size() <= FANOUT)
+        return {};
+
+    // Too many children, move the right half in a new sibling
+    auto* right = new Node;
+    right->leaf = false;
+
+    int half = node->children.size() / 2;
+    right->children = node->children.mid(half);
+    node->children.resize(half);
+
+    for(const Node* c : right->children)
+        right->size += c->size;
+
+    node->size -= right->size;
+    return {right};
+}
+
+void QMemoryBuffer::removeAt(Node* node, qint64 offset, qint64 length) {
+    if(node->leaf) {
+        int o = static_cast<int>(offset), n = static_cast<int>(length);
+
+        if(!o) // Drop the prefix, no copy needed
+            node->begin += n;
+        else if(o + n != node->size) {
+            QMemoryBuffer::materialize(node);
+            node->data.remove(o, n);
+        }
+
+        node->size -= n;
+        return;
+    }
+
+    qint64 pos = 0;
+
+    for(int i = 0; i < node->children.size() && length > 0;) {
+        Node* c = node->children[i];
+
+        if(offset >= pos + c->size) {
+            pos += c->size;
+            i++;
+            continue;
+        }
+
+        qint64 b = offset - pos, n = qMin(length, c->size - b);
+
+        if(!b && n == c->size) {
+            node->children.removeAt(i);
+            delete c;
+        }
+        else {
+            this->removeAt(c, b, n);
+            pos += c->size;
+            i++;
+        }
+
+        node->size -= n;
+        length -= n;
+    }
+
+    if(node->children.isEmpty() || !node->children.first()->leaf)
+        return;
+
+    // Merge small neighbour leaves
+    for(int i = 0; i + 1 < node->children.size();) {
+        Node *a = node->children[i], *b = node->children[i + 1];
+
+        if(a->size + b->size > LEAF_SIZE) {
+            i++;
+            continue;
+        }
+
+        QMemoryBuffer::materialize(a);
+        a->data.append(b->constData(), static_cast<int>(b->size));
+        a->size += b->size;
+        node->children.removeAt(i + 1);
+        delete b;
+    }
+}
+
+void QMemoryBuffer::writeNode(const Node* node, QIODevice* device) const {
+    if(node->leaf) {
+        device->write(node->constData(), node->size);
+        return;
+    }
+
+    for(const Node* c : node->children)
+        this->writeNode(c, device);
+}
+
+QMemoryBuffer::Node* QMemoryBuffer::createLeaf(const QByteArray& data,
+                                               int begin, int size) {
+    auto* leaf = new Node;
+    leaf->data = data;
+    leaf->begin = begin;
+    leaf->size = size;
+    return leaf;
+}
+
+QVector<QMemoryBuffer::Node*> QMemoryBuffer::splitLeaf(Node* leaf) {
+    int n = static_cast<int>((leaf->size + LEAF_SIZE - 1) / LEAF_SIZE);
+    int piece = static_cast<int>((leaf->size + n - 1) / n);
+    QVector<Node*> siblings;
+
+    // Siblings share the data of the original leaf
+    for(int pos = piece; pos < leaf->size; pos += piece) {
+        siblings.append(QMemoryBuffer::createLeaf(
+            leaf->data, leaf->begin + pos,
+            static_cast<int>(qMin<qint64>(piece, leaf->size - pos))));
+    }
+
+    leaf->size = piece;
+    return siblings;
+}
+
+void QMemoryBuffer::materialize(Node* leaf) {
+    if(!leaf->begin && leaf->data.size() == leaf->size)
+        return;
+
+    leaf->data = leaf->data.mid(leaf->begin, static_cast<int>(leaf->size));
+    leaf->begin = 0;
 }
@@ -0,0 +1,241 @@
+#include <QFile>
+#include <QHexView/model/buffer/qsparsefilebuffer.h>
+
+#if defined(Q_OS_UNIX)
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+QSparseFileBuffer::QSparseFileBuffer(QObject* parent)
+    : QDeviceBuffer{parent} {}
+
+const QSparseExtents& QSparseFileBuffer::extents() const { return m_extents; }
+
+uchar QSparseFileBuffer::at(qint64 idx) {
+    int i = this->findExtent(idx);
+    if(i == -1 || m_extents[i].hole)
+        return uchar{};
+    return QDeviceBuffer::at(idx);
+}
+
+bool QSparseFileBuffer::holeAt(qint64 offset, qint64& begin,
+                               qint64& end) const {
+    int i = this->findExtent(offset);
+    if(i == -1 || !m_extents[i].hole)
+        return false;
+
+    begin = m_extents[i].begin;
+    end = m_extents[i].end;
+    return true;
+}
+
+bool QSparseFileBuffer::isAvailable(qint64 offset, qint64 length) const {
+    int i = this->findExtent(qMax<qint64>(offset, 0));
+    if(i == -1)
+        return true;
+
+    for(qint64 end = offset + length;
+        i < m_extents.size() && m_extents[i].begin < end; i++) {
+        const QSparseExtent& e = m_extents[i];
+        if(e.hole)
+            continue; // Holes don't need any I/O
+
+        qint64 b = qMax(e.begin, offset);
+        if(!QDeviceBuffer::isAvailable(b, qMin(e.end, end) - b))
+            return false;
+    }
+
+    return true;
+}
+
+void QSparseFileBuffer::prefetch(qint64 offset, qint64 length) {
+    int i = this->findExtent(qMax<qint64>(offset, 0));
+    if(i == -1)
+        return;
+
+    for(qint64 end = offset + length;
+        i < m_extents.size() && m_extents[i].begin < end; i++) {
+        const QSparseExtent& e = m_extents[i];
+
+        if(!e.hole) {
+            qint64 b = qMax(e.begin, offset);
+            QDeviceBuffer::prefetch(b, qMin(e.end, end) - b);
+        }
+    }
+}
+
+void QSparseFileBuffer::replace(qint64 offset, const QByteArray& data) {
+    QDeviceBuffer::replace(offset, data);
+
+    // Writing into a hole (or past the end) allocates new blocks
+    int i = this->findExtent(offset);
+    int j = this->findExtent(offset + data.size() - 1);
+
+    if(i == -1 || j == -1 || i != j || m_extents[i].hole)
+        this->scanExtents();
+}
+
+QByteArray QSparseFileBuffer::peek(qint64 offset, int length) {
+    return this->readExtents(offset, length, false);
+}
+
+QByteArray QSparseFileBuffer::read(qint64 offset, int length) {
+    return this->readExtents(offset, length, true);
+}
+
+bool QSparseFileBuffer::read(QIODevice* iodevice) {
+    if(!QDeviceBuffer::read(iodevice))
+        return false;
+
+    this->scanExtents();
+    return true;
+}
+
+qint64 QSparseFileBuffer::indexOf(const QByteArray& ba, qint64 from) {
+    qint64 len = this->length();
+    if(ba.isEmpty() || from >= len)
+        return -1;
+
+    from = qMax<qint64>(from, 0);
+
+    // Zeros can match inside holes too
+    if(ba.count('\0') == ba.size())
+        return this->scanForward(ba, from, len);
+
+    // Any match must overlap at least one data extent
+    for(const QSparseExtent& e : m_extents) {
+        if(e.hole || e.end <= from)
+            continue;
+
+        qint64 idx = this->scanForward(ba, qMax(from, e.begin - ba.size() + 1),
+                                       qMin(len, e.end + ba.size() - 1));
+        if(idx != -1)
+            return idx;
+    }
+
+    return -1;
+}
+
+qint64 QSparseFileBuffer::lastIndexOf(const QByteArray& ba, qint64 from) {
+    if(ba.isEmpty() || from < 0)
+        return -1;
+
+    qint64 end = qMin(from + ba.size(), this->length());
+
+    if(ba.count('\0') == ba.size())
+        return this->scanBackward(ba, 0, end);
+
+    for(int i = m_extents.size() - 1; i >= 0; i--) {
+        const QSparseExtent& e = m_extents[i];
+        if(e.hole || e.begin >= end)
+            continue;
+
+        qint64 idx =
+            this->scanBackward(ba, qMax<qint64>(0, e.begin - ba.size() + 1),
+                               qMin(end, e.end + ba.size() - 1));
+        if(idx != -1)
+            return idx;
+    }
+
+    return -1;
+}
+
+QByteArray QSparseFileBuffer::readExtents(qint64 offset, int length,
+                                          bool wait) {
+    qint64 end = qMin<qint64>(offset + length, this->length());
+    int i = this->findExtent(offset);
+    if(i == -1 || end <= offset)
+        return {};
+
+    if(!m_extents[i].hole && end <= m_extents[i].end) { // Fast path
+        return wait ? QDeviceBuffer::read(offset, length)
+                    : QDeviceBuffer::peek(offset, length);
+    }
+
+    QByteArray data;
+    data.reserve(static_cast<int>(end - offset));
+
+    for(; i < m_extents.size() && offset < end; i++) {
+        const QSparseExtent& e = m_extents[i];
+        int n = static_cast<int>(qMin(e.end, end) - offset);
+
+        if(e.hole)
+            data.append(QByteArray(n, '\0'));
+        else {
+            QByteArray chunk = wait ? QDeviceBuffer::read(offset, n)
+                                    : QDeviceBuffer::peek(offset, n);
+            data.append(chunk);
+
+            if(chunk.size() < n) // Still loading
+                break;
+        }
+
+        offset += n;
+    }
+
+    return data;
+}
+
+void QSparseFileBuffer::scanExtents() {
+    qint64 size = this->length();
+    m_extents.clear();
+
+#if defined(Q_OS_UNIX) && defined(SEEK_DATA) && defined(SEEK_HOLE)
+    QFile* f = qobject_cast<QFile*>(m_device);
+
+    // Use a private handle, lseek() would move QFile's offset
+    QFile probe(f ? f->fileName() : QString{});
+    qint64 pos = 0;
+
+    if(probe.open(QFile::ReadOnly)) {
+        int fd = probe.handle();
+
+        while(pos < size) {
+            off_t data = ::lseek(fd, pos, SEEK_DATA);
+
+            if(data < 0) {
+                // ENXIO: trailing hole, otherwise holes are not supported
+                m_extents.push_back({pos, size, errno == ENXIO});
+                pos = size;
+                break;
+            }
+
+            if(data > pos)
+                m_extents.push_back({pos, qMin<qint64>(data, size), true});
+
+            off_t hole = ::lseek(fd, data, SEEK_HOLE);
+            if(hole < 0)
+                hole = size;
+
+            m_extents.push_back({data, qMin<qint64>(hole, size), false});
+            pos = hole;
+        }
+    }
+
+    if(pos < size) // Fallback, no hole information
+        m_extents.push_back({pos, size, false});
+#else
+    if(size > 0)
+        m_extents.push_back({0, size, false});
+#endif
+
+    Q_EMIT extentsChanged();
+}
+
+int QSparseFileBuffer::findExtent(qint64 offset) const {
+    int left = 0, right = m_extents.size() - 1;
+
+    while(left <= right) {
+        int mid = (left + right) / 2;
+        const QSparseExtent& e = m_extents[mid];
+
+        if(offset < e.begin)
+            right = mid - 1;
+        else if(offset >= e.end)
+            left = mid + 1;
+        else
+            return mid; // found
+    }
+
+    return -1;
+}
@@ -1,6 +1,12 @@
 #include <QHexView/model/commands/hexviewcommand.h>
+#include <QHexView/model/qhexdocument.h>
 
 QHexViewCommand::QHexViewCommand(QHexBuffer* buffer, const QHexChanges& changes,
                                  QHexDocument* document, QUndoCommand* parent)
     : QUndoCommand(parent), m_changes{changes}, m_hexdocument{document},
       m_buffer{buffer}, m_offset{}, m_length{} {}
+
+void QHexViewCommand::emitDataChanged(const QByteArray& data, qint64 offset,
+                                      QHexChangeReason reason) {
+    m_hexdocument->emitDataChanged(data, offset, reason);
+}
@@ -11,8 +11,10 @@ QHexViewInsertCommand::QHexViewInsertCommand(
 
 void QHexViewInsertCommand::undo() {
     m_buffer->remove(m_offset, m_data.length());
-    Q_EMIT m_hexdocument->dataChanged(m_data, m_offset,
-                                      QHexChangeReason::Remove);
+    this->emitDataChanged(m_data, m_offset, QHexChangeReason::Remove);
 }
 
-void QHexViewInsertCommand::redo() { m_buffer->insert(m_offset, m_data); }
+void QHexViewInsertCommand::redo() {
+    m_buffer->insert(m_offset, m_data);
+    this->emitDataChanged(m_data, m_offset, QHexChangeReason::Insert);
+}
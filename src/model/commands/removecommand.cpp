@@ -13,11 +13,11 @@ QHexViewRemoveCommand::QHexViewRemoveCommand(QHexBuffer* buffer,
 
 void QHexViewRemoveCommand::undo() {
     m_buffer->insert(m_offset, m_data);
-    Q_EMIT m_hexdocument->dataChanged(m_data, m_offset,
-                                      QHexChangeReason::Insert);
+    this->emitDataChanged(m_data, m_offset, QHexChangeReason::Insert);
 }
 
 void QHexViewRemoveCommand::redo() {
     m_data = m_buffer->read(m_offset, m_length); // Backup data
     m_buffer->remove(m_offset, m_length);
+    this->emitDataChanged(m_data, m_offset, QHexChangeReason::Remove);
 }
@@ -0,0 +1,95 @@
+#include <QHexView/model/commands/replaceallcommand.h>
+#include <QHexView/model/qhexdocument.h>
+
+namespace {
+
+const qint64 NOTIFY_SPAN = 1 << 20; // Close matches share a dataChanged()
+
+} // namespace
+
+QHexViewReplaceAllCommand::QHexViewReplaceAllCommand(
+    QHexBuffer* buffer, const QHexChanges& changes, QHexDocument* document,
+    const QList<QPair<qint64, qint64>>& matches, const QByteArray& data,
+    QUndoCommand* parent)
+    : QHexViewCommand(buffer, changes, document, parent), m_matches{matches},
+      m_olddata(matches.size()) {
+    m_data = data;
+    m_offset = m_matches.isEmpty() ? 0 : m_matches.first().first;
+
+    for(const auto& m : m_matches) {
+        m_delta += m_data.size() - m.second;
+        m_inplace = m_inplace && m.second == m_data.size();
+    }
+}
+
+void QHexViewReplaceAllCommand::undo() {
+    // Offsets after redo(): every previous match moved the following ones
+    qint64 shift = m_delta;
+
+    for(int i = m_matches.size() - 1; i >= 0; i--) {
+        const auto& m = m_matches.at(i);
+        shift -= m_data.size() - m.second;
+
+        if(m_inplace)
+            m_buffer->replace(m.first, m_olddata.at(i));
+        else {
+            m_buffer->remove(m.first + shift, m_data.size());
+            m_buffer->insert(m.first + shift, m_olddata.at(i));
+        }
+    }
+
+    this->notify(true);
+}
+
+void QHexViewReplaceAllCommand::redo() {
+    // Backwards, so the offsets of the remaining matches don't move
+    for(int i = m_matches.size() - 1; i >= 0; i--) {
+        const auto& m = m_matches.at(i);
+        m_olddata[i] = m_buffer->read(m.first, static_cast<int>(m.second));
+
+        if(m_inplace)
+            m_buffer->replace(m.first, m_data);
+        else {
+            m_buffer->remove(m.first, static_cast<int>(m.second));
+            m_buffer->insert(m.first, m_data);
+        }
+    }
+
+    this->notify(false);
+}
+
+void QHexViewReplaceAllCommand::notify(bool undo) {
+    if(m_matches.isEmpty())
+        return;
+
+    if(!m_inplace) {
+        // Everything after the first match moved, that's all listeners
+        // look at: the data is what was inserted or removed there
+        qint64 delta = undo ? -m_delta : m_delta;
+        QHexChangeReason reason = delta < 0 ? QHexChangeReason::Remove
+                                            : QHexChangeReason::Insert;
+
+        this->emitDataChanged((reason == QHexChangeReason::Insert) != undo
+                                  ? m_data
+                                  : m_olddata.first(),
+                              m_offset, reason);
+        return;
+    }
+
+    // Runs of matches up to NOTIFY_SPAN apart are read back and reported
+    // together, distant ones separately
+    for(int i = 0; i < m_matches.size();) {
+        qint64 begin = m_matches.at(i).first, end = begin;
+
+        for(; i < m_matches.size(); i++) {
+            const auto& m = m_matches.at(i);
+            if(end > begin && m.first + m.second - begin > NOTIFY_SPAN)
+                break;
+            end = m.first + m.second;
+        }
+
+        this->emitDataChanged(
+            m_buffer->read(begin, static_cast<int>(end - begin)), begin,
+            QHexChangeReason::Replace);
+    }
+}
@@ -11,11 +11,11 @@ QHexViewReplaceCommand::QHexViewReplaceCommand(
 
 void QHexViewReplaceCommand::undo() {
     m_buffer->replace(m_offset, m_olddata);
-    Q_EMIT m_hexdocument->dataChanged(m_olddata, m_offset,
-                                      QHexChangeReason::Replace);
+    this->emitDataChanged(m_olddata, m_offset, QHexChangeReason::Replace);
 }
 
 void QHexViewReplaceCommand::redo() {
     m_olddata = m_buffer->read(m_offset, m_data.length());
     m_buffer->replace(m_offset, m_data);
+    this->emitDataChanged(m_data, m_offset, QHexChangeReason::Replace);
 }
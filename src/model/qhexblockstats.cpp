@@ -0,0 +1,276 @@
+#include <QHexView/model/qhexblockstats.h>
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexhistogram.h>
+#include <QHexView/model/qhexworker.h>
+#include <QPair>
+
+namespace {
+
+const qint64 READ_SIZE = 1 << 20;
+const int RESTART_DELAY_MS = 250;
+
+using BlockRuns = QVector<QPair<int, int>>; // First block, count
+
+inline quint8 scaled(double r) {
+    return static_cast<quint8>(qBound(0, qRound(r * 255), 255));
+}
+
+inline bool is_printable(int b) {
+    return (b >= 0x20 && b < 0x7f) || b == '\t' || b == '\n' || b == '\r';
+}
+
+QHexBlockStat block_stat(const QHexHistogram& h) {
+    qint64 n = h.total();
+    if(n <= 0)
+        return QHexBlockStat{};
+
+    qint64 printable = 0, high = 0;
+
+    for(int b = 0; b < 256; b++) {
+        if(is_printable(b))
+            printable += h.count(static_cast<uchar>(b));
+        else if(b & 0x80)
+            high += h.count(static_cast<uchar>(b));
+    }
+
+    return QHexBlockStat{scaled(h.entropy() / 8),
+                         scaled(static_cast<double>(h.count(0)) / n),
+                         scaled(static_cast<double>(printable) / n),
+                         scaled(static_cast<double>(high) / n)};
+}
+
+} // namespace
+
+class QHexBlockStatsWorker: public QHexWorker {
+public:
+    explicit QHexBlockStatsWorker(QHexBlockStats* stats, const BlockRuns& runs)
+        : QHexWorker{stats}, m_stats{stats}, m_document{stats->document()},
+          m_runs{runs}, m_blocksize{stats->m_blocksize},
+          m_length{stats->document()->length()},
+          m_generation{stats->m_generation} {}
+
+    ~QHexBlockStatsWorker() override { this->cancel(); }
+
+protected:
+    void run() override {
+        qint64 done = 0, total = 0;
+
+        for(const auto& r : m_runs)
+            total += this->runEnd(r) - r.first * m_blocksize;
+
+        for(const auto& r : m_runs) {
+            qint64 pos = r.first * m_blocksize, end = this->runEnd(r);
+            int block = r.first;
+            QHexHistogram h;
+
+            while(!this->isCancelled() && pos < end) {
+                QByteArray data = this->read(
+                    m_document, pos,
+                    static_cast<int>(qMin(READ_SIZE, end - pos)));
+
+                if(data.isEmpty())
+                    return;
+
+                const uchar* p =
+                    reinterpret_cast<const uchar*>(data.constData());
+                QVector<QHexBlockStat> stats;
+                int first = block;
+
+                // Blocks may span several reads, or a read several blocks
+                for(int i = 0; i < data.size();) {
+                    qint64 blockend = qMin((block + 1) * m_blocksize, end);
+                    int len = static_cast<int>(
+                        qMin<qint64>(data.size() - i, blockend - pos));
+
+                    h.add(p + i, len);
+                    i += len;
+                    pos += len;
+
+                    if(pos == blockend) {
+                        stats.append(block_stat(h));
+                        h.clear();
+                        block++;
+                    }
+                }
+
+                done += data.size();
+                this->notify(first, stats, done, total);
+            }
+        }
+    }
+
+private:
+    qint64 runEnd(const QPair<int, int>& r) const {
+        return qMin(m_length, (r.first + r.second) * m_blocksize);
+    }
+
+    void notify(int first, const QVector<QHexBlockStat>& stats, qint64 done,
+                qint64 total) {
+        QHexBlockStats* blockstats = m_stats;
+        quint64 generation = m_generation;
+
+        QMetaObject::invokeMethod(
+            blockstats,
+            [blockstats, generation, first, stats, done, total]() {
+                blockstats->setResults(generation, first, stats);
+                Q_EMIT blockstats->progress(done, total);
+            },
+            Qt::QueuedConnection);
+    }
+
+private:
+    QHexBlockStats* m_stats;
+    const QHexDocument* m_document;
+    BlockRuns m_runs;
+    qint64 m_blocksize, m_length;
+    quint64 m_generation;
+};
+
+QHexBlockStats::QHexBlockStats(QHexDocument* document, QObject* parent)
+    : QObject{parent}, m_document{document} {
+    m_restarttimer.setSingleShot(true);
+    m_restarttimer.setInterval(RESTART_DELAY_MS);
+    connect(&m_restarttimer, &QTimer::timeout, this, &QHexBlockStats::start);
+
+    connect(document, &QHexDocument::dataChanged, this,
+            [this](const QByteArray& data, quint64 offset,
+                   QHexChangeReason reason) {
+                // Inserts and removals move everything after them
+                this->invalidate(static_cast<qint64>(offset),
+                                 reason == QHexChangeReason::Replace
+                                     ? data.size()
+                                     : -1);
+            });
+
+    connect(document, &QHexDocument::reset, this, [this]() {
+        m_blocksize = 0; // Nothing can be kept
+        this->invalidate(0, -1);
+    });
+
+    connect(document, &QObject::destroyed, this, &QHexBlockStats::cancel);
+
+    this->invalidate(0, -1);
+    this->start();
+}
+
+QHexBlockStats::~QHexBlockStats() { this->cancel(); }
+QHexDocument* QHexBlockStats::document() const { return m_document; }
+qint64 QHexBlockStats::blockSize() const { return m_blocksize; }
+int QHexBlockStats::count() const { return m_stats.size(); }
+
+int QHexBlockStats::blockAt(qint64 offset) const {
+    if(offset < 0 || !m_blocksize || offset / m_blocksize >= m_stats.size())
+        return -1;
+    return static_cast<int>(offset / m_blocksize);
+}
+
+QHexBlockStat QHexBlockStats::at(int idx) const { return m_stats.at(idx); }
+bool QHexBlockStats::isDirty(int idx) const { return m_dirty.testBit(idx); }
+bool QHexBlockStats::isReady() const { return !m_dirty.count(true); }
+
+bool QHexBlockStats::isRunning() const {
+    return m_worker && m_worker->isRunning();
+}
+
+void QHexBlockStats::start() {
+    this->cancel();
+
+    if(!m_document)
+        return;
+
+    BlockRuns runs;
+
+    for(int i = 0; i < m_dirty.size();) {
+        if(!m_dirty.testBit(i)) {
+            i++;
+            continue;
+        }
+
+        int first = i;
+        while(i < m_dirty.size() && m_dirty.testBit(i))
+            i++;
+
+        runs.append(qMakePair(first, i - first));
+    }
+
+    if(runs.isEmpty()) {
+        Q_EMIT finished();
+        return;
+    }
+
+    m_worker = new QHexBlockStatsWorker(this, runs);
+    QHexBlockStatsWorker* worker = m_worker;
+
+    connect(m_worker, &QThread::finished, this, [this, worker]() {
+        if(worker == m_worker && !worker->isCancelled() && this->isReady())
+            Q_EMIT finished();
+    });
+
+    m_worker->start(QThread::LowPriority);
+}
+
+void QHexBlockStats::cancel() {
+    m_restarttimer.stop();
+
+    if(!m_worker)
+        return;
+
+    m_worker->disconnect(this);
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+void QHexBlockStats::invalidate(qint64 offset, qint64 length) {
+    this->cancel();
+    m_generation++;
+
+    qint64 doclength = m_document ? m_document->length() : 0;
+    qint64 blocksize = QHexBlockStats::MIN_BLOCK;
+
+    while(blocksize * QHexBlockStats::MAX_BLOCKS < doclength)
+        blocksize <<= 1;
+
+    int count = static_cast<int>((doclength + blocksize - 1) / blocksize);
+
+    if(blocksize != m_blocksize) { // Blocks don't line up anymore
+        m_blocksize = blocksize;
+        m_stats.fill(QHexBlockStat{}, count);
+        m_dirty = QBitArray(count, true);
+        offset = 0;
+    }
+    else {
+        m_stats.resize(count);
+        m_dirty.resize(count);
+
+        offset = qMax<qint64>(offset, 0);
+        int first = static_cast<int>(offset / blocksize), last = count;
+
+        if(length >= 0) {
+            qint64 end = offset + qMax<qint64>(length, 1);
+            last = static_cast<int>(
+                qMin<qint64>((end + blocksize - 1) / blocksize, count));
+        }
+
+        if(first < last)
+            m_dirty.fill(true, first, last);
+    }
+
+    m_restarttimer.start();
+    Q_EMIT updated(0, count);
+}
+
+void QHexBlockStats::setResults(quint64 generation, int first,
+                                const QVector<QHexBlockStat>& stats) {
+    if(generation != m_generation) // Computed before an edit
+        return;
+
+    int n = qMin(stats.size(), m_stats.size() - first);
+
+    for(int i = 0; i < n; i++) {
+        m_stats[first + i] = stats.at(i);
+        m_dirty.clearBit(first + i);
+    }
+
+    if(n > 0)
+        Q_EMIT updated(first, n);
+}
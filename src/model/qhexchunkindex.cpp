@@ -0,0 +1,304 @@
+#include <QHexView/model/qhexchunkindex.h>
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexworker.h>
+#include <algorithm>
+
+namespace {
+
+const qint64 READ_SIZE = 1 << 20;
+const quint64 BOUNDARY_MASK = QHexChunkIndex::AVG_CHUNK - 1;
+const quint64 FNV_BASIS = Q_UINT64_C(0xcbf29ce484222325);
+const quint64 FNV_PRIME = Q_UINT64_C(0x100000001b3);
+const int RESTART_DELAY_MS = 250;
+
+inline quint64 rotl(quint64 x, int n) {
+    n &= 63;
+    return n ? (x << n) | (x >> (64 - n)) : x;
+}
+
+// Fixed pseudo random table (splitmix64), chunks must be stable across runs
+struct BuzTable {
+    quint64 t[256];
+
+    BuzTable() {
+        quint64 s = Q_UINT64_C(0x9e3779b97f4a7c15);
+
+        for(quint64& v : t) {
+            quint64 z = (s += Q_UINT64_C(0x9e3779b97f4a7c15));
+            z = (z ^ (z >> 30)) * Q_UINT64_C(0xbf58476d1ce4e5b9);
+            z = (z ^ (z >> 27)) * Q_UINT64_C(0x94d049bb133111eb);
+            v = z ^ (z >> 31);
+        }
+    }
+};
+
+const BuzTable BUZTABLE;
+
+} // namespace
+
+class QHexChunkIndexWorker: public QHexWorker {
+public:
+    explicit QHexChunkIndexWorker(QHexChunkIndex* index)
+        : QHexWorker{index}, m_index{index}, m_document{index->document()},
+          m_length{index->document()->length()} {}
+
+    ~QHexChunkIndexWorker() override { this->cancel(); }
+    const QHexChunks& chunks() const { return m_chunks; }
+
+protected:
+    void run() override {
+        const int W = QHexChunkIndex::WINDOW_SIZE;
+        const qint64 MIN_CHUNK = QHexChunkIndex::MIN_CHUNK;
+        const qint64 MAX_CHUNK = QHexChunkIndex::MAX_CHUNK;
+
+        uchar window[W] = {};
+        quint64 h = 0, fnv = FNV_BASIS;
+        qint64 pos = 0, start = 0;
+
+        m_chunks.reserve(static_cast<int>(
+            qMin<qint64>(m_length / QHexChunkIndex::AVG_CHUNK + 1, 1 << 24)));
+
+        while(!this->isCancelled() && pos < m_length) {
+            QByteArray data =
+                this->read(m_document, pos,
+                           static_cast<int>(qMin(READ_SIZE, m_length - pos)));
+
+            if(data.isEmpty())
+                break;
+
+            const uchar* p = reinterpret_cast<const uchar*>(data.constData());
+
+            for(int i = 0; i < data.size(); i++, pos++) {
+                uchar b = p[i];
+                uchar& slot = window[pos % W];
+
+                // The hash only depends on the last W bytes
+                h = rotl(h, 1) ^ BUZTABLE.t[b];
+                if(pos >= W)
+                    h ^= rotl(BUZTABLE.t[slot], W);
+
+                slot = b;
+                fnv = (fnv ^ b) * FNV_PRIME;
+
+                qint64 len = pos - start + 1;
+
+                if((len >= MIN_CHUNK && !(h & BOUNDARY_MASK)) ||
+                   len >= MAX_CHUNK) {
+                    m_chunks.append({start, len, fnv});
+                    start = pos + 1;
+                    fnv = FNV_BASIS;
+                }
+            }
+
+            this->notify(pos);
+        }
+
+        if(!this->isCancelled() && start < pos)
+            m_chunks.append({start, pos - start, fnv});
+    }
+
+private:
+    void notify(qint64 done) {
+        QHexChunkIndex* index = m_index;
+        qint64 total = m_length;
+
+        QMetaObject::invokeMethod(
+            index,
+            [index, done, total]() { Q_EMIT index->progress(done, total); },
+            Qt::QueuedConnection);
+    }
+
+private:
+    QHexChunkIndex* m_index;
+    const QHexDocument* m_document;
+    qint64 m_length;
+    QHexChunks m_chunks;
+};
+
+QHexChunkIndex::QHexChunkIndex(QHexDocument* document, QObject* parent)
+    : QObject{parent}, m_document{document} {
+    m_restarttimer.setSingleShot(true);
+    m_restarttimer.setInterval(RESTART_DELAY_MS);
+    connect(&m_restarttimer, &QTimer::timeout, this, &QHexChunkIndex::start);
+
+    connect(document, &QHexDocument::changed, &m_restarttimer,
+            QOverload<>::of(&QTimer::start));
+    connect(document, &QObject::destroyed, this, &QHexChunkIndex::cancel);
+}
+
+QHexChunkIndex::~QHexChunkIndex() { this->cancel(); }
+QHexDocument* QHexChunkIndex::document() const { return m_document; }
+const QHexChunks& QHexChunkIndex::chunks() const { return m_chunks; }
+bool QHexChunkIndex::isReady() const { return m_ready; }
+
+bool QHexChunkIndex::isRunning() const {
+    return m_worker && m_worker->isRunning();
+}
+
+int QHexChunkIndex::chunkAt(qint64 offset) const {
+    auto it = std::upper_bound(
+        m_chunks.begin(), m_chunks.end(), offset,
+        [](qint64 o, const QHexChunk& c) { return o < c.offset; });
+
+    if(it == m_chunks.begin())
+        return -1;
+
+    --it;
+    return offset < it->offset + it->length
+               ? static_cast<int>(it - m_chunks.begin())
+               : -1;
+}
+
+qint64 QHexChunkIndex::nextDifference(const QHexChunkIndex* other,
+                                      qint64 offset) const {
+    if(!other || !m_ready || !other->m_ready || m_chunks.isEmpty())
+        return -1;
+
+    int idx = this->chunkAt(offset);
+    if(idx == -1)
+        return -1;
+
+    for(int i = idx + 1; i < m_chunks.size(); i++) {
+        if(this->isDifferent(other, i))
+            return m_chunks.at(i).offset;
+    }
+
+    // Trailing data on the other side only
+    const QHexChunk& last = m_chunks.last();
+    if(other->m_chunks.isEmpty() || other->m_chunks.last().hash != last.hash)
+        return last.offset + last.length;
+
+    return -1;
+}
+
+qint64 QHexChunkIndex::previousDifference(const QHexChunkIndex* other,
+                                          qint64 offset) const {
+    if(!other || !m_ready || !other->m_ready)
+        return -1;
+
+    // Last chunk starting before offset
+    int idx = this->chunkAt(offset);
+
+    if(idx == -1) {
+        if(m_chunks.isEmpty() || offset < m_chunks.last().offset)
+            return -1;
+        idx = m_chunks.size() - 1;
+    }
+    else if(m_chunks.at(idx).offset == offset)
+        idx--;
+
+    for(int i = idx; i >= 0; i--) {
+        if(this->isDifferent(other, i))
+            return m_chunks.at(i).offset;
+    }
+
+    return -1;
+}
+
+QList<qint64> QHexChunkIndex::duplicates(qint64 offset, qint64 length) const {
+    QList<qint64> res;
+    if(!m_ready || m_chunks.isEmpty())
+        return res;
+
+    // Chunks fully covered by the range, or the one containing offset
+    int first = this->chunkAt(offset), count = 1;
+    if(first == -1)
+        return res;
+
+    if(m_chunks.at(first).offset < offset && first + 1 < m_chunks.size() &&
+       m_chunks.at(first + 1).offset + m_chunks.at(first + 1).length <=
+           offset + length)
+        first++;
+
+    while(first + count < m_chunks.size() &&
+          m_chunks.at(first + count).offset +
+                  m_chunks.at(first + count).length <=
+              offset + length)
+        count++;
+
+    qint64 delta = offset - m_chunks.at(first).offset;
+    QList<int> candidates = m_byhash.values(m_chunks.at(first).hash);
+
+    for(int c : candidates) {
+        if(c == first || c + count > m_chunks.size())
+            continue;
+
+        bool match = true;
+
+        for(int i = 1; match && i < count; i++)
+            match = m_chunks.at(c + i).hash == m_chunks.at(first + i).hash;
+
+        if(match && m_chunks.at(c).offset + delta >= 0)
+            res.append(m_chunks.at(c).offset + delta);
+    }
+
+    std::sort(res.begin(), res.end());
+    return res;
+}
+
+void QHexChunkIndex::start() {
+    this->cancel();
+
+    if(!m_document)
+        return;
+
+    // Offsets of the old chunks don't match the document anymore
+    m_ready = false;
+    m_worker = new QHexChunkIndexWorker(this);
+    QHexChunkIndexWorker* worker = m_worker;
+
+    connect(m_worker, &QThread::finished, this, [this, worker]() {
+        if(worker != m_worker || worker->isCancelled())
+            return;
+
+        this->setResults(worker->chunks());
+        Q_EMIT finished();
+    });
+
+    m_worker->start(QThread::LowPriority);
+}
+
+void QHexChunkIndex::cancel() {
+    if(!m_worker)
+        return;
+
+    m_worker->disconnect(this);
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+bool QHexChunkIndex::isDifferent(const QHexChunkIndex* other, int idx) const {
+    quint64 h = m_chunks.at(idx).hash;
+
+    // A chunk differs if it doesn't exist on the other side, or if it
+    // doesn't follow the same chunk there (something was removed before it)
+    if(!other->m_byhash.contains(h))
+        return true;
+    if(!idx)
+        return other->m_chunks.first().hash != h;
+    return !other->m_pairs.contains(
+        QHexChunkIndex::pairHash(m_chunks.at(idx - 1).hash, h));
+}
+
+void QHexChunkIndex::setResults(const QHexChunks& chunks) {
+    m_chunks = chunks;
+    m_byhash.clear();
+    m_pairs.clear();
+    m_byhash.reserve(m_chunks.size());
+    m_pairs.reserve(m_chunks.size());
+
+    for(int i = 0; i < m_chunks.size(); i++) {
+        m_byhash.insert(m_chunks.at(i).hash, i);
+
+        if(i) {
+            m_pairs.insert(QHexChunkIndex::pairHash(m_chunks.at(i - 1).hash,
+                                                    m_chunks.at(i).hash));
+        }
+    }
+
+    m_ready = true;
+}
+
+quint64 QHexChunkIndex::pairHash(quint64 a, quint64 b) {
+    return rotl(a, 17) * Q_UINT64_C(0x9e3779b97f4a7c15) ^ b;
+}
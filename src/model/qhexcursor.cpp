@@ -157,6 +157,10 @@ qint64 QHexCursor::replace(const QVariant& oldvalue, const QVariant& newvalue,
     return this->hexView()->replace(oldvalue, newvalue, offset, mode, options,
                                     fd);
 }
+int QHexCursor::replaceAll(const QVariant& oldvalue, const QVariant& newvalue,
+                           QHexFindMode mode, unsigned int options) const {
+    return this->hexView()->replaceAll(oldvalue, newvalue, mode, options);
+}
 qint64 QHexCursor::find(const QVariant& value, qint64 offset, QHexFindMode mode,
                         unsigned int options, QHexFindDirection fd) const {
     return this->hexView()->find(value, offset, mode, options, fd);
@@ -0,0 +1,413 @@
+#include <QHexView/model/qhexdiff.h>
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexworker.h>
+#include <QMutex>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const qint64 CHUNK_SIZE = 1 << 20;
+const qint64 ANCHOR_SIZE = 16;
+const qint64 MIN_LOOKAHEAD = 64;
+const qint64 MAX_LOOKAHEAD = 1 << 20;
+const int FLUSH_RANGES = 1024;
+const int RESTART_DELAY_MS = 250;
+
+quint64 anchor_hash(const uchar* p) {
+    quint64 x, y;
+    std::memcpy(&x, p, sizeof(quint64));
+    std::memcpy(&y, p + sizeof(quint64), sizeof(quint64));
+
+    quint64 h = (x * Q_UINT64_C(0x9e3779b97f4a7c15)) ^
+                (y * Q_UINT64_C(0xc2b2ae3d27d4eb4f));
+    return h ^ (h >> 29);
+}
+
+qint64 common_prefix(const uchar* a, const uchar* b, qint64 n) {
+    qint64 i = 0;
+
+    for(; i + 8 <= n; i += 8) {
+        quint64 x, y;
+        std::memcpy(&x, a + i, sizeof(quint64));
+        std::memcpy(&y, b + i, sizeof(quint64));
+        if(x != y)
+            break;
+    }
+
+    while(i < n && a[i] == b[i])
+        i++;
+
+    return i;
+}
+
+// Sliding window over a document, bytes before the last requested position
+// are dropped so memory stays bounded by the window being looked at
+class DiffStream {
+public:
+    DiffStream(QHexWorker* worker, const QHexDocument* document, qint64 length)
+        : m_worker{worker}, m_document{document}, m_length{length} {}
+
+    const uchar* at(qint64 pos) const {
+        return reinterpret_cast<const uchar*>(m_data.constData()) +
+               (pos - m_base);
+    }
+
+    qint64 load(qint64 pos, qint64 n) {
+        qint64 end = qMin(pos + n, m_length);
+
+        if(pos < m_base || pos > m_base + m_data.size()) {
+            m_data.clear();
+            m_base = pos;
+        }
+        else if(pos - m_base >= CHUNK_SIZE) {
+            m_data.remove(0, static_cast<int>(pos - m_base));
+            m_base = pos;
+        }
+
+        while(m_base + m_data.size() < end) {
+            qint64 from = m_base + m_data.size();
+            QByteArray chunk = m_worker->read(
+                m_document, from,
+                static_cast<int>(qMin(CHUNK_SIZE, m_length - from)));
+
+            if(chunk.isEmpty())
+                break;
+
+            m_data.append(chunk);
+        }
+
+        return qMax<qint64>(0, qMin<qint64>(m_base + m_data.size(), end) - pos);
+    }
+
+private:
+    QHexWorker* m_worker;
+    const QHexDocument* m_document;
+    qint64 m_length, m_base{0};
+    QByteArray m_data;
+};
+
+} // namespace
+
+// Walks both documents skipping equal runs, on a mismatch the closest pair
+// of equal ANCHOR_SIZE blocks (smallest i + j) is looked up in a hash table
+// of the right side, growing the lookahead from MIN_ to MAX_LOOKAHEAD
+class QHexDiffWorker: public QHexWorker {
+public:
+    explicit QHexDiffWorker(QHexDiff* diff)
+        : QHexWorker{diff}, m_diff{diff}, m_left{diff->left()},
+          m_right{diff->right()}, m_leftlength{diff->left()->length()},
+          m_rightlength{diff->right()->length()} {}
+
+    ~QHexDiffWorker() override { this->cancel(); }
+
+    QHexDiffRanges take() {
+        QMutexLocker locker(&m_mutex);
+        QHexDiffRanges ranges = m_pending;
+        m_pending.clear();
+        return ranges;
+    }
+
+protected:
+    void run() override {
+        DiffStream l{this, m_left, m_leftlength};
+        DiffStream r{this, m_right, m_rightlength};
+        qint64 a = 0, b = 0, reported = 0;
+
+        while(!this->isCancelled() && a < m_leftlength && b < m_rightlength) {
+            qint64 n = qMin(l.load(a, CHUNK_SIZE), r.load(b, CHUNK_SIZE));
+            if(!n)
+                break;
+
+            qint64 k = common_prefix(l.at(a), r.at(b), n);
+            a += k;
+            b += k;
+
+            if(k < n) {
+                qint64 i, j;
+                this->resync(l, r, a, b, i, j);
+
+                if(m_count >= QHexDiff::MAX_RANGES - 1)
+                    break; // Report the rest as one range below
+
+                this->addRange(a, i, b, j);
+                a += i;
+                b += j;
+            }
+
+            if(a - reported >= CHUNK_SIZE) {
+                reported = a;
+                this->notify(a);
+            }
+        }
+
+        if(this->isCancelled())
+            return;
+
+        this->addRange(a, m_leftlength - a, b, m_rightlength - b);
+        this->flush();
+        this->notify(m_leftlength);
+    }
+
+private:
+    void resync(DiffStream& l, DiffStream& r, qint64 a, qint64 b, qint64& i,
+                qint64& j) {
+        for(qint64 w = MIN_LOOKAHEAD;; w = qMin(w * 8, MAX_LOOKAHEAD)) {
+            qint64 na = l.load(a, w + ANCHOR_SIZE);
+            qint64 nb = r.load(b, w + ANCHOR_SIZE);
+
+            if(this->findAnchor(l.at(a), na, r.at(b), nb, w, i, j))
+                return;
+
+            // Both sides end inside the window, or nothing matches nearby
+            if((na < w + ANCHOR_SIZE && nb < w + ANCHOR_SIZE) ||
+               w == MAX_LOOKAHEAD || this->isCancelled()) {
+                i = qMin(na, w);
+                j = qMin(nb, w);
+                return;
+            }
+        }
+    }
+
+    bool findAnchor(const uchar* pa, qint64 na, const uchar* pb, qint64 nb,
+                    qint64 w, qint64& i, qint64& j) {
+        qint64 wa = qMin(w, na - ANCHOR_SIZE + 1);
+        qint64 wb = qMin(w, nb - ANCHOR_SIZE + 1);
+        if(wa <= 0 || wb <= 0)
+            return false;
+
+        size_t size = 1;
+        while(size < static_cast<size_t>(wb) * 2)
+            size <<= 1;
+
+        const size_t MASK = size - 1;
+        m_table.assign(size, 0);
+
+        // Slots hold position + 1 of the first occurrence of each block
+        for(qint64 jj = 0; jj < wb; jj++) {
+            size_t h = anchor_hash(pb + jj) & MASK;
+
+            while(quint32 slot = m_table[h]) {
+                if(!std::memcmp(pb + slot - 1, pb + jj, ANCHOR_SIZE))
+                    break;
+                h = (h + 1) & MASK;
+            }
+
+            if(!m_table[h])
+                m_table[h] = static_cast<quint32>(jj + 1);
+        }
+
+        qint64 best = -1;
+
+        for(qint64 ii = 0; ii < wa && (best < 0 || ii < best); ii++) {
+            size_t h = anchor_hash(pa + ii) & MASK;
+
+            while(quint32 slot = m_table[h]) {
+                if(!std::memcmp(pb + slot - 1, pa + ii, ANCHOR_SIZE)) {
+                    qint64 jj = slot - 1;
+
+                    if(best < 0 || ii + jj < best) {
+                        best = ii + jj;
+                        i = ii;
+                        j = jj;
+                    }
+
+                    break;
+                }
+
+                h = (h + 1) & MASK;
+            }
+        }
+
+        return best >= 0;
+    }
+
+    void addRange(qint64 a, qint64 i, qint64 b, qint64 j) {
+        if(!i && !j)
+            return;
+
+        if(!m_ranges.isEmpty()) {
+            QHexDiffRange& last = m_ranges.last();
+
+            if(last.left + last.leftlength == a &&
+               last.right + last.rightlength == b) {
+                last.leftlength += i;
+                last.rightlength += j;
+                last.reason = QHexDiffWorker::reason(last.leftlength,
+                                                     last.rightlength);
+                return;
+            }
+        }
+
+        m_ranges.append({QHexDiffWorker::reason(i, j), a, i, b, j});
+        m_count++;
+
+        // Keep the last range back, the next one may extend it
+        if(m_ranges.size() > FLUSH_RANGES)
+            this->flush(true);
+    }
+
+    void flush(bool keeplast = false) {
+        QHexDiffRange last{};
+        if(keeplast)
+            last = m_ranges.takeLast();
+
+        {
+            QMutexLocker locker(&m_mutex);
+            m_pending.append(m_ranges);
+        }
+
+        m_ranges.clear();
+        if(keeplast)
+            m_ranges.append(last);
+
+        QHexDiff* diff = m_diff;
+        QMetaObject::invokeMethod(
+            diff, [diff]() { diff->takeResults(); }, Qt::QueuedConnection);
+    }
+
+    void notify(qint64 done) {
+        QHexDiff* diff = m_diff;
+        qint64 total = m_leftlength;
+
+        QMetaObject::invokeMethod(
+            diff, [diff, done, total]() { Q_EMIT diff->progress(done, total); },
+            Qt::QueuedConnection);
+    }
+
+    static QHexChangeReason reason(qint64 i, qint64 j) {
+        if(i && j)
+            return QHexChangeReason::Replace;
+        return i ? QHexChangeReason::Remove : QHexChangeReason::Insert;
+    }
+
+private:
+    QHexDiff* m_diff;
+    const QHexDocument *m_left, *m_right;
+    qint64 m_leftlength, m_rightlength;
+    std::vector<quint32> m_table;
+    QHexDiffRanges m_ranges;
+    int m_count{0};
+    QMutex m_mutex;
+    QHexDiffRanges m_pending;
+};
+
+QHexDiff::QHexDiff(QHexDocument* left, QHexDocument* right, QObject* parent)
+    : QObject{parent}, m_left{left}, m_right{right} {
+    m_restarttimer.setSingleShot(true);
+    m_restarttimer.setInterval(RESTART_DELAY_MS);
+    connect(&m_restarttimer, &QTimer::timeout, this, &QHexDiff::start);
+
+    connect(left, &QHexDocument::changed, &m_restarttimer,
+            QOverload<>::of(&QTimer::start));
+    connect(right, &QHexDocument::changed, &m_restarttimer,
+            QOverload<>::of(&QTimer::start));
+    connect(left, &QObject::destroyed, this, &QHexDiff::cancel);
+    connect(right, &QObject::destroyed, this, &QHexDiff::cancel);
+}
+
+QHexDiff::~QHexDiff() { this->cancel(); }
+QHexDocument* QHexDiff::left() const { return m_left; }
+QHexDocument* QHexDiff::right() const { return m_right; }
+const QHexDiffRanges& QHexDiff::ranges() const { return m_ranges; }
+bool QHexDiff::isRunning() const { return m_worker && m_worker->isRunning(); }
+
+QHexChangeReason QHexDiff::reasonAt(const QHexDocument* document,
+                                    qint64 offset) const {
+    if(!document || (document != m_left && document != m_right))
+        return QHexChangeReason::None;
+
+    bool left = document == m_left;
+    int idx = this->findRange(left, offset);
+    if(idx == -1)
+        return QHexChangeReason::None;
+
+    const QHexDiffRange& r = m_ranges.at(idx);
+    qint64 begin = left ? r.left : r.right;
+    qint64 length = left ? r.leftlength : r.rightlength;
+    return offset < begin + length ? r.reason : QHexChangeReason::None;
+}
+
+qint64 QHexDiff::mapOffset(const QHexDocument* document, qint64 offset) const {
+    if(!document || (document != m_left && document != m_right))
+        return offset;
+
+    bool left = document == m_left;
+    int idx = this->findRange(left, offset);
+    if(idx == -1)
+        return offset; // Equal prefix
+
+    const QHexDiffRange& r = m_ranges.at(idx);
+    qint64 begin = left ? r.left : r.right;
+    qint64 length = left ? r.leftlength : r.rightlength;
+    qint64 otherbegin = left ? r.right : r.left;
+    qint64 otherlength = left ? r.rightlength : r.leftlength;
+
+    if(offset < begin + length)
+        return otherbegin + qMin(offset - begin, otherlength);
+    return otherbegin + otherlength + (offset - begin - length);
+}
+
+void QHexDiff::start() {
+    this->cancel();
+
+    if(!m_left || !m_right)
+        return;
+
+    m_ranges.clear();
+    Q_EMIT changed();
+
+    m_worker = new QHexDiffWorker(this);
+    QHexDiffWorker* worker = m_worker;
+
+    connect(m_worker, &QThread::finished, this, [this, worker]() {
+        if(worker != m_worker)
+            return;
+
+        this->takeResults();
+        Q_EMIT finished();
+    });
+
+    m_worker->start(QThread::LowPriority);
+}
+
+void QHexDiff::cancel() {
+    if(!m_worker)
+        return;
+
+    m_worker->disconnect(this);
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+int QHexDiff::findRange(bool left, qint64 offset) const {
+    // Last range starting at or before offset
+    int lo = 0, hi = m_ranges.size() - 1, idx = -1;
+
+    while(lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        const QHexDiffRange& r = m_ranges.at(mid);
+        qint64 begin = left ? r.left : r.right;
+
+        if(begin <= offset) {
+            idx = mid;
+            lo = mid + 1;
+        }
+        else
+            hi = mid - 1;
+    }
+
+    return idx;
+}
+
+void QHexDiff::takeResults() {
+    if(!m_worker)
+        return;
+
+    QHexDiffRanges ranges = m_worker->take();
+    if(ranges.isEmpty())
+        return;
+
+    m_ranges.append(ranges);
+    Q_EMIT changed();
+}
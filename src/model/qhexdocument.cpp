@@ -1,19 +1,34 @@
 #include <QBuffer>
 #include <QFile>
 #include <QHexView/model/buffer/qdevicebuffer.h>
+#if defined(QHEXVIEW_ENABLE_ZLIB)
+#include <QHexView/model/buffer/qcompressedfilebuffer.h>
+#endif
 #include <QHexView/model/buffer/qmappedfilebuffer.h>
 #include <QHexView/model/buffer/qmemorybuffer.h>
+#include <QHexView/model/buffer/qsparsefilebuffer.h>
 #include <QHexView/model/commands/insertcommand.h>
 #include <QHexView/model/commands/removecommand.h>
+#include <QHexView/model/commands/replaceallcommand.h>
 #include <QHexView/model/commands/replacecommand.h>
+#include <QHexView/model/qhexblockstats.h>
 #include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexhistogram.h>
+#include <QHexView/model/qhexsearchindex.h>
 #include <cmath>
+#include <limits>
 
 QHexDocument::QHexDocument(QHexBuffer* buffer, QObject* parent)
     : QObject(parent) {
+    m_profiler = new QHexProfiler();
     m_buffer = buffer;
     m_buffer->setParent(this); // Take Ownership
+    m_buffer->setProfiler(m_profiler);
 
+    connect(m_buffer, &QHexBuffer::dataAvailable, this,
+            &QHexDocument::dataAvailable);
+
+    m_metadata = new QHexMetadata(this);
     m_undostack = new QUndoStack(this);
 
     connect(m_undostack, &QUndoStack::canUndoChanged, this,
@@ -24,14 +39,42 @@ QHexDocument::QHexDocument(QHexBuffer* buffer, QObject* parent)
             [&](bool clean) { Q_EMIT modifiedChanged(!clean); });
 }
 
+QHexDocument::~QHexDocument() {
+    // Stop their workers while the buffer is still alive
+    delete m_blockstats;
+    delete m_histogram;
+    m_buffer->setProfiler(nullptr);
+    delete m_profiler;
+}
+
 qint64 QHexDocument::indexOf(const QByteArray& ba, qint64 from) {
+    if(m_searchindex && m_searchindex->canSearch(ba))
+        return m_searchindex->indexOf(ba, from);
     return m_buffer->indexOf(ba, from);
 }
 
 qint64 QHexDocument::lastIndexOf(const QByteArray& ba, qint64 from) {
+    if(m_searchindex && m_searchindex->canSearch(ba))
+        return m_searchindex->lastIndexOf(ba, from);
     return m_buffer->lastIndexOf(ba, from);
 }
 
+QList<qint64> QHexDocument::findAll(const QByteArray& ba, int limit) {
+    if(m_searchindex && m_searchindex->canSearch(ba))
+        return m_searchindex->findAll(ba, true, limit);
+
+    QList<qint64> res;
+    if(ba.isEmpty())
+        return res;
+
+    for(qint64 idx = m_buffer->indexOf(ba, 0);
+        idx != -1 && (limit < 0 || res.size() < limit);
+        idx = m_buffer->indexOf(ba, idx + 1))
+        res.append(idx);
+
+    return res;
+}
+
 QHexChangeReason QHexDocument::getChangeReason(qint64 offset) const {
     int idx = this->findChange(offset);
     return idx != -1 ? m_changes[idx].reason : QHexChangeReason::None;
@@ -59,7 +102,17 @@ qint64 QHexDocument::findChange(qint64 offset) const {
 }
 
 bool QHexDocument::accept(qint64 idx) const { return m_buffer->accept(idx); }
+
+bool QHexDocument::holeAt(qint64 offset, qint64& begin, qint64& end) const {
+    return m_buffer->holeAt(offset, begin, end);
+}
+
 bool QHexDocument::isEmpty() const { return m_buffer->isEmpty(); }
+
+bool QHexDocument::isAvailable(qint64 offset, qint64 len) const {
+    return m_buffer->isAvailable(offset, len);
+}
+
 bool QHexDocument::isModified() const { return !m_undostack->isClean(); }
 bool QHexDocument::canUndo() const { return m_undostack->canUndo(); }
 bool QHexDocument::canRedo() const { return m_undostack->canRedo(); }
@@ -79,11 +132,19 @@ void QHexDocument::setData(QHexBuffer* buffer) {
     m_changes.clear();
     m_undostack->clear();
     buffer->setParent(this);
+    buffer->setProfiler(m_profiler);
 
     auto* oldbuffer = m_buffer;
     m_buffer = buffer;
-    if(oldbuffer)
+
+    if(oldbuffer) {
+        disconnect(oldbuffer, &QHexBuffer::dataAvailable, this, nullptr);
+        oldbuffer->setProfiler(nullptr);
         oldbuffer->deleteLater();
+    }
+
+    connect(m_buffer, &QHexBuffer::dataAvailable, this,
+            &QHexDocument::dataAvailable);
 
     Q_EMIT canUndoChanged(false);
     Q_EMIT canRedoChanged(false);
@@ -113,27 +174,91 @@ qint64 QHexDocument::length() const {
     return m_buffer ? m_buffer->length() : 0;
 }
 
-uchar QHexDocument::at(qint64 offset) const { return m_buffer->at(offset); }
+uchar QHexDocument::at(qint64 offset) const {
+    QHEXVIEW_PROFILE_COUNT(m_profiler, Reads, 1);
+    QHEXVIEW_PROFILE_COUNT(m_profiler, BytesRead, 1);
+    return m_buffer->at(offset);
+}
+
+QHexMetadata* QHexDocument::metadata() const { return m_metadata; }
+QHexSearchIndex* QHexDocument::searchIndex() const { return m_searchindex; }
+
+void QHexDocument::setSearchIndex(QHexSearchIndex* index) {
+    m_searchindex = index;
+}
+
+QHexBlockStats* QHexDocument::blockStats() {
+    // Created on first use, shared by every view showing the document
+    if(!m_blockstats)
+        m_blockstats = new QHexBlockStats(this, this);
+    return m_blockstats;
+}
+
+QHexHistogramEngine* QHexDocument::histogram() {
+    if(!m_histogram)
+        m_histogram = new QHexHistogramEngine(this, this);
+    return m_histogram;
+}
+
+QList<QHexView*> QHexDocument::views() const { return m_views; }
+QHexProfiler* QHexDocument::profiler() const { return m_profiler; }
+
+void QHexDocument::attachView(QHexView* hexview) {
+    if(!m_views.contains(hexview))
+        m_views.append(hexview);
+
+    // Documents without a parent belong to the first view showing them
+    if(!this->parent())
+        this->setParent(hexview);
+}
+
+void QHexDocument::detachView(QHexView* hexview) {
+    m_views.removeAll(hexview);
+
+    // Passed on while other views show it, otherwise it stays with its
+    // owner (and is deleted with it)
+    if(this->parent() == hexview && !m_views.isEmpty())
+        this->setParent(m_views.first());
+}
+QHexStats QHexDocument::stats() const { return m_profiler->stats(); }
+void QHexDocument::resetStats() { m_profiler->reset(); }
 
 QHexDocument* QHexDocument::fromFile(QString filename, QObject* parent) {
-    QFile f(filename);
+    auto* f = new QFile(filename);
 
-    if(f.open(QFile::ReadOnly))
-        return QHexDocument::fromMemory<QMemoryBuffer>(f.readAll(), parent);
+    if(!f->open(QFile::ReadOnly)) {
+        delete f;
+        return nullptr;
+    }
 
-    return nullptr;
+    // Too large for QMemoryBuffer: page it in lazily, read only
+    if(f->size() > std::numeric_limits<int>::max())
+        return QHexDocument::fromDevice<QDeviceBuffer>(f, parent);
+
+    // Shared by the buffer, not copied again
+    QByteArray data = f->readAll();
+    delete f;
+    return QHexDocument::fromMemory<QMemoryBuffer>(data, parent);
 }
 
 void QHexDocument::undo() {
+    m_deferchanges = true;
     m_undostack->undo();
     this->restoreChanges();
+    m_deferchanges = false;
+
     Q_EMIT changed();
+    this->flushDataChanged();
 }
 
 void QHexDocument::redo() {
+    m_deferchanges = true;
     m_undostack->redo();
     this->restoreChanges();
+    m_deferchanges = false;
+
     Q_EMIT changed();
+    this->flushDataChanged();
 }
 
 void QHexDocument::clear() { this->remove(0, this->length()); }
@@ -166,14 +291,19 @@ void QHexDocument::insert(qint64 offset, const QByteArray& data) {
         this->moveChanges(offset, data.size());
     }
 
+    QHEXVIEW_PROFILE_COUNT(m_profiler, UndoPushes, 1);
+    m_deferchanges = true;
     m_undostack->push(
         new QHexViewInsertCommand(m_buffer, m_changes, this, offset, data));
+    m_deferchanges = false;
 
     Q_EMIT changed();
-    Q_EMIT dataChanged(data, offset, QHexChangeReason::Insert);
+    this->flushDataChanged();
 }
 
 void QHexDocument::replace(qint64 offset, const QByteArray& data) {
+    QHEXVIEW_PROFILE_COUNT(m_profiler, UndoPushes, 1);
+    m_deferchanges = true;
     m_undostack->push(
         new QHexViewReplaceCommand(m_buffer, m_changes, this, offset, data));
 
@@ -188,34 +318,118 @@ void QHexDocument::replace(qint64 offset, const QByteArray& data) {
         std::sort(m_changes.begin(), m_changes.end());
     }
 
+    m_deferchanges = false;
     Q_EMIT changed();
-    Q_EMIT dataChanged(data, offset, QHexChangeReason::Replace);
+    this->flushDataChanged();
 }
 
 void QHexDocument::remove(qint64 offset, int len) {
     if(len <= 0)
         return;
 
-    QByteArray data = m_buffer->read(offset, len);
+    QHEXVIEW_PROFILE_COUNT(m_profiler, UndoPushes, 1);
+    m_deferchanges = true;
     m_undostack->push(
         new QHexViewRemoveCommand(m_buffer, m_changes, this, offset, len));
 
     if(m_trackchanges)
         this->removeChange(offset, len);
 
+    m_deferchanges = false;
+    Q_EMIT changed();
+    this->flushDataChanged();
+}
+
+void QHexDocument::replaceAll(const QList<QPair<qint64, qint64>>& matches,
+                              const QByteArray& data) {
+    // Sorted, non overlapping and not empty
+    QList<QPair<qint64, qint64>> valid;
+
+    for(const auto& m : matches) {
+        qint64 end = valid.isEmpty() ? 0
+                                     : valid.last().first + valid.last().second;
+
+        if(m.second > 0 && m.first >= end &&
+           m.first + m.second <= this->length())
+            valid.append(m);
+    }
+
+    if(valid.isEmpty())
+        return;
+
+    if(m_trackchanges) {
+        for(int i = valid.size() - 1; i >= 0; i--) {
+            const auto& m = valid.at(i);
+
+            if(m.second == data.size()) { // Like replace()
+                if(this->findChange(m.first) != -1)
+                    continue;
+
+                m_changes.push_back(
+                    {QHexChangeReason::Replace, m.first, m.first + m.second});
+                std::sort(m_changes.begin(), m_changes.end());
+            }
+            else { // Like remove() and insert()
+                this->removeChange(m.first, m.second);
+                if(data.isEmpty())
+                    continue;
+
+                m_changes.push_back(
+                    {QHexChangeReason::Insert, m.first, m.first + data.size()});
+                std::sort(m_changes.begin(), m_changes.end());
+                this->moveChanges(m.first, data.size());
+            }
+        }
+    }
+
+    QHEXVIEW_PROFILE_COUNT(m_profiler, UndoPushes, 1);
+    m_deferchanges = true;
+    m_undostack->push(
+        new QHexViewReplaceAllCommand(m_buffer, m_changes, this, valid, data));
+    m_deferchanges = false;
+
     Q_EMIT changed();
-    Q_EMIT dataChanged(data, offset, QHexChangeReason::Remove);
+    this->flushDataChanged();
+}
+
+void QHexDocument::prefetch(qint64 offset, qint64 len) {
+    m_buffer->prefetch(offset, len);
 }
 
 QByteArray QHexDocument::read(qint64 offset, int len) const {
+    QHEXVIEW_PROFILE_SCOPE(m_profiler, "read", ReadTime);
+    QHEXVIEW_PROFILE_COUNT(m_profiler, Reads, 1);
+    QHEXVIEW_PROFILE_COUNT(m_profiler, BytesRead, len);
     return m_buffer->read(offset, len);
 }
 
+QHexBuffer* QHexDocument::createReader() const {
+    return m_buffer->createReader();
+}
+
+QByteArray QHexDocument::peek(qint64 offset, int len) const {
+    // Short while slow backends are still loading, nothing waits
+    QHEXVIEW_PROFILE_COUNT(m_profiler, Reads, 1);
+    QHEXVIEW_PROFILE_COUNT(m_profiler, BytesRead, len);
+    return m_buffer->peek(offset, len);
+}
+
 bool QHexDocument::saveTo(QIODevice* device) {
     if(!device->isWritable())
         return false;
+
+    // Buffers may refuse to write, e.g. a mapping of a truncated file
+    qint64 pos = device->pos();
     m_buffer->write(device);
-    return true;
+    return device->isSequential() || device->pos() - pos == this->length();
+}
+
+bool QHexDocument::saveTo(const QString& filename) {
+    // The buffer may still read from the file being overwritten
+    m_buffer->release(filename);
+
+    QFile f(filename);
+    return f.open(QFile::WriteOnly | QFile::Truncate) && this->saveTo(&f);
 }
 
 void QHexDocument::removeChange(qint64 offset, qint64 n) {
@@ -258,6 +472,23 @@ void QHexDocument::moveChanges(qint64 offset, qint64 n) {
     }
 }
 
+void QHexDocument::emitDataChanged(const QByteArray& data, qint64 offset,
+                                   QHexChangeReason reason) {
+    if(m_deferchanges)
+        m_pendingchanges.append({data, offset, reason});
+    else
+        Q_EMIT dataChanged(data, static_cast<quint64>(offset), reason);
+}
+
+void QHexDocument::flushDataChanged() {
+    // Listeners may edit the document again
+    QList<PendingChange> pending;
+    pending.swap(m_pendingchanges);
+
+    for(const PendingChange& c : pending)
+        Q_EMIT dataChanged(c.data, static_cast<quint64>(c.offset), c.reason);
+}
+
 void QHexDocument::restoreChanges() {
     if(!m_trackchanges)
         return;
@@ -283,6 +514,33 @@ QHexDocument* QHexDocument::fromMappedFile(QString filename, QObject* parent) {
                                                        parent);
 }
 
+QHexDocument* QHexDocument::fromPrivateMappedFile(QString filename,
+                                                 QObject* parent) {
+    auto* f = new QFile(filename);
+    auto* hexbuffer = new QMemoryBuffer(parent);
+    f->setParent(hexbuffer);
+
+    // Save it back with saveTo(filename), not through a truncated QFile
+    if(hexbuffer->map(f))
+        return new QHexDocument(hexbuffer, parent);
+
+    delete hexbuffer;
+    return nullptr;
+}
+
+QHexDocument* QHexDocument::fromSparseFile(QString filename, QObject* parent) {
+    return QHexDocument::fromDevice<QSparseFileBuffer>(new QFile(filename),
+                                                       parent);
+}
+
+#if defined(QHEXVIEW_ENABLE_ZLIB)
+QHexDocument* QHexDocument::fromCompressedFile(QString filename,
+                                               QObject* parent) {
+    return QHexDocument::fromDevice<QCompressedFileBuffer>(new QFile(filename),
+                                                           parent);
+}
+#endif
+
 QHexDocument* QHexDocument::create(QObject* parent) {
     return QHexDocument::fromMemory<QMemoryBuffer>({}, parent);
 }
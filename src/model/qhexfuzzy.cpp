@@ -0,0 +1,278 @@
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexfuzzy.h>
+#include <algorithm>
+#include <cstdlib>
+
+using QHexUtils::QHexPattern;
+using QHexUtils::QHexPatternType;
+
+namespace {
+
+const int CHUNK_SIZE = 1 << 20;
+
+// Bit i of r[j]: the first i + 1 pattern items match the text read so
+// far with at most j errors
+struct Automaton {
+    quint64 r[QHexFuzzy::MAX_DISTANCE + 1];
+    quint64 hit;
+    int k;
+    bool levenshtein;
+
+    Automaton(int length, int maxdistance, bool lev)
+        : hit{quint64{1} << (length - 1)}, k{maxdistance}, levenshtein{lev} {
+        // Levenshtein: the first j items may be deleted
+        for(int j = 0; j <= k; j++)
+            r[j] = levenshtein ? (quint64{1} << j) - 1 : 0;
+    }
+
+    // Distance of the best match ending with this byte, -1 if none
+    inline int step(quint64 mask) {
+        quint64 prev = r[0];
+        r[0] = ((r[0] << 1) | 1) & mask;
+        int d = (r[0] & hit) ? 0 : -1;
+
+        for(int j = 1; j <= k; j++) {
+            quint64 old = r[j];
+            quint64 v = (((old << 1) | 1) & mask) | (prev << 1) | 1;
+
+            if(levenshtein) // Insertion and deletion
+                v |= prev | (r[j - 1] << 1);
+
+            r[j] = v;
+            prev = old;
+
+            if(d == -1 && (v & hit))
+                d = j;
+        }
+
+        return d;
+    }
+};
+
+QHexPattern from_bytes(const QByteArray& ba) {
+    QHexPattern pattern;
+
+    for(char ch : ba)
+        pattern.append({QHexPatternType::BYTE, static_cast<quint8>(ch)});
+
+    return pattern;
+}
+
+inline bool item_matches(const QHexUtils::QHexPatternItem& item, uchar b) {
+    return item.type == QHexPatternType::WILDCARD || item.b == b;
+}
+
+} // namespace
+
+QHexFuzzy::QHexFuzzy(const QHexPattern& pattern, int maxdistance,
+                     Metric metric)
+    : m_pattern{pattern}, m_metric{metric} {
+    int m = m_pattern.size();
+
+    for(const QHexUtils::QHexPatternItem& item : m_pattern) {
+        if(item.type == QHexPatternType::SKIP)
+            return;
+    }
+
+    // Every match keeps at least one pattern item
+    if(!m || m > MAX_LENGTH || maxdistance < 0 ||
+       maxdistance > MAX_DISTANCE || maxdistance >= m)
+        return;
+
+    m_masks = QVector<quint64>(256, 0);
+    m_rmasks = QVector<quint64>(256, 0);
+
+    for(int i = 0; i < m; i++) {
+        const QHexUtils::QHexPatternItem& item = m_pattern.at(i);
+
+        for(int c = 0; c < 256; c++) {
+            if(!item_matches(item, static_cast<uchar>(c)))
+                continue;
+
+            m_masks[c] |= quint64{1} << i;
+            m_rmasks[c] |= quint64{1} << (m - 1 - i);
+        }
+    }
+
+    m_maxdistance = maxdistance;
+}
+
+QHexFuzzy::QHexFuzzy(const QByteArray& pattern, int maxdistance,
+                     Metric metric)
+    : QHexFuzzy{from_bytes(pattern), maxdistance, metric} {}
+
+QHexFuzzy::QHexFuzzy(const QString& pattern, int maxdistance, Metric metric)
+    : QHexFuzzy{QHexUtils::compilePattern(pattern), maxdistance, metric} {}
+
+bool QHexFuzzy::isValid() const { return m_maxdistance != -1; }
+int QHexFuzzy::length() const { return m_pattern.size(); }
+int QHexFuzzy::maxDistance() const { return m_maxdistance; }
+QHexFuzzy::Metric QHexFuzzy::metric() const { return m_metric; }
+
+QPair<qint64, qint64> QHexFuzzy::match(const QHexDocument* document,
+                                       qint64 from, qint64 to,
+                                       int* distance) const {
+    if(!this->isValid() || !document)
+        return {-1, 0};
+
+    qint64 length = document->length();
+    if(to < 0 || to > length)
+        to = length;
+
+    from = qMax<qint64>(from, 0);
+
+    int d = 0;
+    qint64 end = this->scan(document, from, to, to, false, d);
+    if(end == -1)
+        return {-1, 0};
+
+    qint64 n = m_pattern.size();
+
+    if(m_metric == Metric::Levenshtein) {
+        qint64 begin = qMax(from, end - n - m_maxdistance);
+        n = this->align(
+            document->read(begin, static_cast<int>(end - begin)), true);
+    }
+
+    if(distance)
+        *distance = d;
+
+    return {end - n, n};
+}
+
+QPair<qint64, qint64> QHexFuzzy::matchBackward(const QHexDocument* document,
+                                               qint64 from,
+                                               int* distance) const {
+    if(!this->isValid() || !document)
+        return {-1, 0};
+
+    qint64 length = document->length();
+    from = qMin(from, length - 1);
+    if(from < 0)
+        return {-1, 0};
+
+    // Matches starting at or before 'from' end before 'to'
+    qint64 to = qMin(length, from + m_pattern.size() + m_maxdistance);
+
+    int d = 0;
+    qint64 start = this->scan(document, 0, to, from, true, d);
+    if(start == -1)
+        return {-1, 0};
+
+    qint64 n = m_pattern.size();
+
+    if(m_metric == Metric::Levenshtein) {
+        qint64 end = qMin(length, start + n + m_maxdistance);
+        n = this->align(
+            document->read(start, static_cast<int>(end - start)), false);
+    }
+
+    if(distance)
+        *distance = d;
+
+    return {start, n};
+}
+
+QList<QPair<qint64, qint64>> QHexFuzzy::findAll(const QHexDocument* document,
+                                               qint64 from, qint64 length,
+                                               int limit) const {
+    QList<QPair<qint64, qint64>> res;
+    if(!this->isValid() || !document)
+        return res;
+
+    qint64 to = length >= 0 ? from + length : -1;
+
+    while(limit < 0 || res.size() < limit) {
+        QPair<qint64, qint64> m = this->match(document, from, to);
+        if(m.first == -1)
+            break;
+
+        res.append(m);
+        from = m.first + m.second; // Never empty
+    }
+
+    return res;
+}
+
+qint64 QHexFuzzy::scan(const QHexDocument* document, qint64 from, qint64 to,
+                       qint64 last, bool backward, int& distance) const {
+    // Forward: the end of the first match in [from, to). Backward: the
+    // start of the last match in [from, to) starting at or before 'last'.
+    // Levenshtein matches may get better a few bytes later, keep looking
+    // for as many bytes as the allowed errors.
+    const quint64* masks = backward ? m_rmasks.constData()
+                                    : m_masks.constData();
+    Automaton a{m_pattern.size(), m_maxdistance,
+                m_metric == Metric::Levenshtein};
+    qint64 found = -1, stop = -1;
+    distance = m_maxdistance + 1;
+
+    for(qint64 pos = backward ? to : from; backward ? pos > from : pos < to;) {
+        qint64 begin = backward ? qMax(from, pos - CHUNK_SIZE) : pos;
+        qint64 n = backward ? pos - begin : qMin<qint64>(CHUNK_SIZE, to - pos);
+        QByteArray chunk = document->read(begin, static_cast<int>(n));
+        const uchar* p = reinterpret_cast<const uchar*>(chunk.constData());
+
+        if(chunk.size() != n)
+            break;
+
+        for(qint64 i = 0; i < n; i++) {
+            qint64 q = backward ? n - 1 - i : i;
+            qint64 at = backward ? begin + q : begin + q + 1;
+            int d = a.step(masks[p[q]]);
+
+            if(d != -1 && d < distance && (!backward || at <= last)) {
+                distance = d;
+                found = at;
+
+                if(stop == -1) {
+                    stop = a.levenshtein ? m_maxdistance : 0;
+                    stop = backward ? at - stop : at + stop;
+                }
+            }
+
+            if(stop != -1 && (!distance || at == stop))
+                return found;
+        }
+
+        pos = backward ? begin : pos + n;
+    }
+
+    return found;
+}
+
+int QHexFuzzy::align(const QByteArray& data, bool suffix) const {
+    // Edit distance of the pattern and every prefix (suffix) of data,
+    // the closest one wins, ties go to the length nearest to the pattern
+    const uchar* t = reinterpret_cast<const uchar*>(data.constData());
+    int m = m_pattern.size(), n = data.size();
+    QVector<int> prev(n + 1), cur(n + 1);
+
+    for(int j = 0; j <= n; j++)
+        prev[j] = j;
+
+    for(int i = 1; i <= m; i++) {
+        const QHexUtils::QHexPatternItem& item =
+            m_pattern.at(suffix ? m - i : i - 1);
+        cur[0] = i;
+
+        for(int j = 1; j <= n; j++) {
+            int cost = item_matches(item, t[suffix ? n - j : j - 1]) ? 0 : 1;
+            cur[j] = std::min({prev.at(j - 1) + cost, prev.at(j) + 1,
+                               cur.at(j - 1) + 1});
+        }
+
+        std::swap(prev, cur);
+    }
+
+    int best = 0;
+
+    for(int j = 1; j <= n; j++) {
+        if(prev.at(j) < prev.at(best) ||
+           (prev.at(j) == prev.at(best) &&
+            std::abs(j - m) < std::abs(best - m)))
+            best = j;
+    }
+
+    return best;
+}
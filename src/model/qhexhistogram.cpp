@@ -0,0 +1,339 @@
+#include <QAtomicInt>
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexhistogram.h>
+#include <QHexView/model/qhexworker.h>
+#include <QPair>
+#include <QVector>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const qint64 READ_SIZE = 1 << 20; // A multiple of BLOCK_SIZE
+const qint64 MAX_SLICE = 1 << 30; // Sub-histogram counters don't overflow
+const int MAX_THREADS = 8;
+
+} // namespace
+
+struct QHexHistogramJob {
+    struct Task {
+        qint64 offset, length;
+        QVector<QPair<qint64, QHexHistogram>> blocks; // Index, to cache
+    };
+
+    std::vector<Task> tasks;
+    qint64 doclength{0}, total{0}, done{0};
+    qint64 cachefrom{0}; // Older blocks would be evicted right away
+    QAtomicInt next{0}, failed{0};
+};
+
+class QHexHistogramWorker: public QHexWorker {
+public:
+    explicit QHexHistogramWorker(QHexHistogramEngine* engine,
+                                 const std::shared_ptr<QHexHistogramJob>& job,
+                                 quint64 generation)
+        : QHexWorker{engine}, m_engine{engine},
+          m_document{engine->document()}, m_job{job},
+          m_generation{generation} {}
+
+    ~QHexHistogramWorker() override { this->cancel(); }
+    const QHexHistogram& histogram() const { return m_histogram; }
+
+protected:
+    void run() override {
+        const qint64 BLOCK_SIZE = QHexHistogramEngine::BLOCK_SIZE;
+        QHexHistogramJob* job = m_job.get();
+
+        // Tasks are picked in order, each one by a single worker
+        for(;;) {
+            int i = job->next.fetchAndAddRelaxed(1);
+            if(this->isCancelled() || i >= static_cast<int>(job->tasks.size()))
+                return;
+
+            QHexHistogramJob::Task& task = job->tasks[i];
+            QByteArray data = this->read(m_document, task.offset,
+                                         static_cast<int>(task.length));
+
+            if(data.size() != task.length) {
+                job->failed.storeRelease(1);
+                return;
+            }
+
+            const uchar* p = reinterpret_cast<const uchar*>(data.constData());
+            qint64 end = task.offset + task.length;
+
+            // Everything goes in the worker's histogram, whole blocks that
+            // will be cached are also kept on their own
+            for(qint64 pos = task.offset; pos < end;) {
+                qint64 block = pos / BLOCK_SIZE;
+                qint64 blocklast = qMin((block + 1) * BLOCK_SIZE, end);
+                bool whole = pos == block * BLOCK_SIZE &&
+                             blocklast == qMin((block + 1) * BLOCK_SIZE,
+                                               job->doclength);
+
+                if(!whole || block < job->cachefrom) {
+                    m_histogram.add(p + (pos - task.offset), blocklast - pos);
+                    pos = blocklast;
+                    continue;
+                }
+
+                QHexHistogram h;
+                h.add(p + (pos - task.offset), blocklast - pos);
+                m_histogram.add(h);
+                task.blocks.append(qMakePair(block, h));
+                pos = blocklast;
+            }
+
+            this->notify(task.length);
+        }
+    }
+
+private:
+    void notify(qint64 length) {
+        QHexHistogramEngine* engine = m_engine;
+        quint64 generation = m_generation;
+
+        QMetaObject::invokeMethod(
+            engine,
+            [engine, generation, length]() {
+                engine->notify(generation, length);
+            },
+            Qt::QueuedConnection);
+    }
+
+private:
+    QHexHistogramEngine* m_engine;
+    const QHexDocument* m_document;
+    std::shared_ptr<QHexHistogramJob> m_job;
+    QHexHistogram m_histogram;
+    quint64 m_generation;
+};
+
+void QHexHistogram::add(const uchar* data, qint64 len) {
+    quint32 sub[4][256];
+
+    for(qint64 offset = 0; offset < len; offset += MAX_SLICE) {
+        qint64 n = qMin(len - offset, MAX_SLICE), i = 0;
+        const uchar* p = data + offset;
+        std::memset(sub, 0, sizeof(sub));
+
+        // Consecutive bytes go to different tables
+        for(; i + 8 <= n; i += 8) {
+            quint64 w;
+            std::memcpy(&w, p + i, sizeof(w));
+
+            sub[0][w & 0xff]++;
+            sub[1][(w >> 8) & 0xff]++;
+            sub[2][(w >> 16) & 0xff]++;
+            sub[3][(w >> 24) & 0xff]++;
+            sub[0][(w >> 32) & 0xff]++;
+            sub[1][(w >> 40) & 0xff]++;
+            sub[2][(w >> 48) & 0xff]++;
+            sub[3][w >> 56]++;
+        }
+
+        for(; i < n; i++)
+            sub[0][p[i]]++;
+
+        for(int b = 0; b < 256; b++)
+            m_counts[b] += sub[0][b] + sub[1][b] + sub[2][b] + sub[3][b];
+
+        m_total += n;
+    }
+}
+
+void QHexHistogram::add(const QHexHistogram& h) {
+    for(int b = 0; b < 256; b++)
+        m_counts[b] += h.m_counts[b];
+
+    m_total += h.m_total;
+}
+
+void QHexHistogram::clear() { *this = QHexHistogram{}; }
+bool QHexHistogram::isEmpty() const { return !m_total; }
+qint64 QHexHistogram::count(uchar b) const { return m_counts[b]; }
+qint64 QHexHistogram::total() const { return m_total; }
+
+double QHexHistogram::entropy() const {
+    double e = 0;
+
+    for(qint64 c : m_counts) {
+        if(!c)
+            continue;
+
+        double p = static_cast<double>(c) / m_total;
+        e -= p * std::log2(p);
+    }
+
+    return e;
+}
+
+quint64 QHexHistogram::sum() const {
+    quint64 s = 0;
+
+    for(int b = 0; b < 256; b++)
+        s += static_cast<quint64>(b) * static_cast<quint64>(m_counts[b]);
+
+    return s;
+}
+
+QHexHistogramEngine::QHexHistogramEngine(QHexDocument* document,
+                                         QObject* parent)
+    : QObject{parent}, m_document{document}, m_cache{CACHE_BLOCKS} {
+    connect(document, &QHexDocument::dataChanged, this,
+            [this](const QByteArray& data, quint64 offset,
+                   QHexChangeReason reason) {
+                // Inserts and removals move everything after them
+                this->invalidate(static_cast<qint64>(offset),
+                                 reason == QHexChangeReason::Replace
+                                     ? data.size()
+                                     : -1);
+            });
+
+    connect(document, &QHexDocument::reset, this, [this]() {
+        this->cancel();
+        m_cache.clear();
+        m_ready = false;
+    });
+
+    connect(document, &QObject::destroyed, this,
+            &QHexHistogramEngine::cancel);
+}
+
+QHexHistogramEngine::~QHexHistogramEngine() { this->cancel(); }
+QHexDocument* QHexHistogramEngine::document() const { return m_document; }
+QHexHistogram QHexHistogramEngine::result() const { return m_result; }
+bool QHexHistogramEngine::isReady() const { return m_ready; }
+bool QHexHistogramEngine::isRunning() const { return m_running > 0; }
+
+void QHexHistogramEngine::start(qint64 offset, qint64 length) {
+    this->cancel();
+    m_ready = false;
+    m_result.clear();
+
+    if(!m_document)
+        return;
+
+    auto job = std::make_shared<QHexHistogramJob>();
+    job->doclength = m_document->length();
+
+    offset = qBound<qint64>(0, offset, job->doclength);
+    qint64 end = length < 0 ? job->doclength
+                            : qMin(job->doclength, offset + length);
+    job->cachefrom = (end - 1) / BLOCK_SIZE - CACHE_BLOCKS + 1;
+
+    // Cached blocks are counted now, the rest is split in reads that
+    // don't cross a READ_SIZE boundary
+    for(qint64 pos = offset; pos < end;) {
+        qint64 block = pos / BLOCK_SIZE;
+        qint64 blockend = qMin((block + 1) * BLOCK_SIZE, job->doclength);
+
+        if(pos == block * BLOCK_SIZE && blockend <= end) {
+            const QHexHistogram* h = m_cache.object(block);
+
+            if(h) {
+                m_result.add(*h);
+                pos = blockend;
+                continue;
+            }
+        }
+
+        qint64 segend = qMin(blockend, end);
+
+        if(!job->tasks.empty() && pos % READ_SIZE &&
+           job->tasks.back().offset + job->tasks.back().length == pos)
+            job->tasks.back().length += segend - pos;
+        else
+            job->tasks.push_back({pos, segend - pos, {}});
+
+        job->total += segend - pos;
+        pos = segend;
+    }
+
+    if(job->tasks.empty()) {
+        m_ready = true;
+        Q_EMIT finished();
+        return;
+    }
+
+    m_job = job;
+    quint64 generation = m_generation;
+    int nthreads = qMin(qBound(1, QThread::idealThreadCount(), MAX_THREADS),
+                        static_cast<int>(job->tasks.size()));
+
+    for(int i = 0; i < nthreads; i++) {
+        auto* worker = new QHexHistogramWorker(this, job, generation);
+
+        connect(worker, &QThread::finished, this,
+                [this, generation]() { this->complete(generation); });
+
+        m_workers.append(worker);
+    }
+
+    m_running = m_workers.size();
+
+    for(QHexHistogramWorker* worker : m_workers)
+        worker->start(QThread::LowPriority);
+}
+
+void QHexHistogramEngine::cancel() {
+    m_generation++;
+    m_running = 0;
+    m_job.reset();
+
+    // Stop them all before waiting for any
+    for(QHexHistogramWorker* worker : m_workers) {
+        worker->disconnect(this);
+        worker->requestInterruption();
+    }
+
+    qDeleteAll(m_workers);
+    m_workers.clear();
+}
+
+void QHexHistogramEngine::invalidate(qint64 offset, qint64 length) {
+    // The running query counts data that isn't there anymore
+    if(m_running)
+        this->cancel();
+
+    m_ready = false;
+    qint64 first = qMax<qint64>(offset, 0) / BLOCK_SIZE, last = -1;
+
+    if(length >= 0)
+        last = (offset + qMax<qint64>(length, 1) - 1) / BLOCK_SIZE;
+
+    for(qint64 block : m_cache.keys()) {
+        if(block >= first && (last == -1 || block <= last))
+            m_cache.remove(block);
+    }
+}
+
+void QHexHistogramEngine::notify(quint64 generation, qint64 length) {
+    if(generation != m_generation || !m_job)
+        return;
+
+    m_job->done += length;
+    Q_EMIT progress(m_job->done, m_job->total);
+}
+
+void QHexHistogramEngine::complete(quint64 generation) {
+    if(generation != m_generation || --m_running > 0)
+        return;
+
+    std::shared_ptr<QHexHistogramJob> job = m_job;
+    if(!job || job->failed.loadAcquire())
+        return;
+
+    for(const QHexHistogramWorker* worker : m_workers)
+        m_result.add(worker->histogram());
+
+    for(const QHexHistogramJob::Task& task : job->tasks) {
+        for(const auto& b : task.blocks)
+            m_cache.insert(b.first, new QHexHistogram(b.second));
+    }
+
+    m_ready = true;
+    this->cancel(); // Workers are done, just release them
+    Q_EMIT finished();
+}
@@ -0,0 +1,211 @@
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexinspector.h>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// FILETIME counts 100ns intervals from 1601-01-01
+const qint64 FILETIME_EPOCH_MSECS = Q_INT64_C(11644473600000);
+
+} // namespace
+
+QHexInspector::QHexInspector(const QHexDocument* document)
+    : m_document{document} {}
+
+const QHexDocument* QHexInspector::document() const { return m_document; }
+const uchar* QHexInspector::data() const { return m_span; }
+qint64 QHexInspector::offset() const { return m_offset; }
+int QHexInspector::size() const { return m_size; }
+
+void QHexInspector::setDocument(const QHexDocument* document) {
+    if(m_document == document)
+        return;
+
+    m_document = document;
+    this->invalidate();
+}
+
+void QHexInspector::setOffset(qint64 offset) {
+    if(!m_document || offset < 0 || offset >= m_document->length()) {
+        m_offset = offset;
+        m_size = 0;
+        return;
+    }
+
+    int size = static_cast<int>(
+        qMin<qint64>(SPAN_SIZE, m_document->length() - offset));
+
+    if(offset == m_offset && size == m_size)
+        return;
+
+    uchar span[SPAN_SIZE];
+    qint64 oldbegin = m_offset, oldend = m_offset + m_size;
+
+    for(int i = 0; i < size; i++) {
+        qint64 pos = offset + i;
+
+        if(pos >= oldbegin && pos < oldend)
+            span[i] = m_span[pos - oldbegin];
+        else
+            span[i] = m_document->at(pos);
+    }
+
+    std::memcpy(m_span, span, size);
+    m_offset = offset;
+    m_size = size;
+}
+
+void QHexInspector::invalidate() {
+    qint64 offset = m_offset;
+    m_offset = -1;
+    m_size = 0;
+    this->setOffset(offset);
+}
+
+bool QHexInspector::readInt(unsigned int options, qint64& v) const {
+    quint64 u;
+    if(!this->readUInt(options, u))
+        return false;
+
+    int bits = QHexInspector::width(options) * 8;
+
+    if(bits < 64 && (u & (Q_UINT64_C(1) << (bits - 1))))
+        u |= ~Q_UINT64_C(0) << bits;
+
+    v = static_cast<qint64>(u);
+    return true;
+}
+
+bool QHexInspector::readUInt(unsigned int options, quint64& v) const {
+    if(options & (QHexFindOptions::Float | QHexFindOptions::Double))
+        return false;
+
+    int w = QHexInspector::width(options);
+    if(!w || w > m_size)
+        return false;
+
+    v = this->raw(w, 0, options & QHexFindOptions::BigEndian);
+    return true;
+}
+
+bool QHexInspector::readFloat(unsigned int options, double& v) const {
+    int w = QHexInspector::width(options);
+    if(!(options & (QHexFindOptions::Float | QHexFindOptions::Double)) ||
+       w > m_size)
+        return false;
+
+    quint64 u = this->raw(w, 0, options & QHexFindOptions::BigEndian);
+
+    if(options & QHexFindOptions::Float) {
+        auto u32 = static_cast<quint32>(u);
+        float f;
+        std::memcpy(&f, &u32, sizeof(float));
+        v = f;
+    }
+    else
+        std::memcpy(&v, &u, sizeof(double));
+
+    return true;
+}
+
+bool QHexInspector::readULEB128(quint64& v, int* len) const {
+    v = 0;
+
+    for(int i = 0, shift = 0; i < m_size && shift < 64; i++, shift += 7) {
+        v |= static_cast<quint64>(m_span[i] & 0x7f) << shift;
+
+        if(!(m_span[i] & 0x80)) {
+            if(len)
+                *len = i + 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool QHexInspector::readSLEB128(qint64& v, int* len) const {
+    quint64 u = 0;
+
+    for(int i = 0, shift = 0; i < m_size && shift < 64; i++) {
+        u |= static_cast<quint64>(m_span[i] & 0x7f) << shift;
+        shift += 7;
+
+        if(!(m_span[i] & 0x80)) {
+            if(shift < 64 && (m_span[i] & 0x40))
+                u |= ~Q_UINT64_C(0) << shift;
+
+            v = static_cast<qint64>(u);
+            if(len)
+                *len = i + 1;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool QHexInspector::readUnixTime(unsigned int options, QDateTime& v) const {
+    qint64 secs;
+    if(!this->readInt(options, secs))
+        return false;
+
+    // Keep the conversion to milliseconds in range
+    if(qAbs(secs) > std::numeric_limits<qint64>::max() / 1000)
+        return false;
+
+    v = QDateTime::fromMSecsSinceEpoch(secs * 1000, Qt::UTC);
+    return v.isValid();
+}
+
+bool QHexInspector::readFileTime(unsigned int options, QDateTime& v) const {
+    quint64 ft;
+    if(!this->readUInt(QHexFindOptions::Int64 |
+                           (options & QHexFindOptions::BigEndian),
+                       ft))
+        return false;
+
+    v = QDateTime::fromMSecsSinceEpoch(
+        static_cast<qint64>(ft / 10000) - FILETIME_EPOCH_MSECS, Qt::UTC);
+    return v.isValid();
+}
+
+bool QHexInspector::readGuid(unsigned int options, QUuid& v) const {
+    if(m_size < 16)
+        return false;
+
+    // Microsoft GUIDs store the first three fields in little endian,
+    // BigEndian selects the RFC 4122 layout
+    bool be = options & QHexFindOptions::BigEndian;
+    const uchar* b = m_span + 8;
+
+    v = QUuid(static_cast<uint>(this->raw(4, 0, be)),
+              static_cast<ushort>(this->raw(2, 4, be)),
+              static_cast<ushort>(this->raw(2, 6, be)), b[0], b[1], b[2],
+              b[3], b[4], b[5], b[6], b[7]);
+    return true;
+}
+
+int QHexInspector::width(unsigned int options) {
+    if(options & QHexFindOptions::Int8)
+        return 1;
+    if(options & QHexFindOptions::Int16)
+        return 2;
+    if(options & (QHexFindOptions::Int32 | QHexFindOptions::Float))
+        return 4;
+    if(options & (QHexFindOptions::Int64 | QHexFindOptions::Double))
+        return 8;
+    return 0;
+}
+
+quint64 QHexInspector::raw(int w, int pos, bool bigendian) const {
+    quint64 v = 0;
+
+    for(int i = 0; i < w; i++) {
+        int idx = bigendian ? pos + i : pos + w - 1 - i;
+        v = (v << 8) | m_span[idx];
+    }
+
+    return v;
+}
@@ -0,0 +1,86 @@
+#include <QHexView/model/qhexmatches.h>
+#include <algorithm>
+#include <limits>
+
+void QHexMatches::setMatches(QList<QPair<qint64, qint64>> matches) {
+    this->clear();
+
+    if(!std::is_sorted(matches.begin(), matches.end()))
+        std::sort(matches.begin(), matches.end());
+
+    m_offsets.reserve(matches.size());
+    m_lengths.reserve(matches.size());
+
+    for(const auto& m : matches) {
+        if(m.first < 0 || m.second <= 0)
+            continue;
+
+        qint64 begin = m.first, end = m.first + m.second;
+
+        // Overlapping matches are merged
+        if(!m_offsets.isEmpty() && begin < this->end(m_offsets.size() - 1)) {
+            begin = m_offsets.last();
+            end = qMax(end, this->end(m_offsets.size() - 1));
+            m_offsets.removeLast();
+            m_lengths.removeLast();
+        }
+
+        m_offsets.append(begin);
+        m_lengths.append(static_cast<qint32>(
+            qMin<qint64>(end - begin, std::numeric_limits<qint32>::max())));
+    }
+}
+
+void QHexMatches::clear() {
+    m_offsets.clear();
+    m_lengths.clear();
+}
+
+bool QHexMatches::isEmpty() const { return m_offsets.isEmpty(); }
+int QHexMatches::size() const { return m_offsets.size(); }
+qint64 QHexMatches::offset(int idx) const { return m_offsets.at(idx); }
+qint64 QHexMatches::length(int idx) const { return m_lengths.at(idx); }
+
+qint64 QHexMatches::end(int idx) const {
+    return m_offsets.at(idx) + m_lengths.at(idx);
+}
+
+int QHexMatches::lowerBound(qint64 offset) const {
+    // Matches don't overlap: the one before the first starting after
+    // 'offset' is the only candidate
+    int idx = static_cast<int>(
+        std::upper_bound(m_offsets.begin(), m_offsets.end(), offset) -
+        m_offsets.begin());
+
+    if(idx > 0 && this->end(idx - 1) > offset)
+        idx--;
+
+    return idx;
+}
+
+int QHexMatches::indexOf(qint64 offset, int first, int last) const {
+    if(last < 0 || last > m_offsets.size())
+        last = m_offsets.size();
+
+    auto it = std::upper_bound(m_offsets.begin() + first,
+                               m_offsets.begin() + last, offset);
+    if(it == m_offsets.begin() + first)
+        return -1;
+
+    int idx = static_cast<int>(it - m_offsets.begin()) - 1;
+    return offset < this->end(idx) ? idx : -1;
+}
+
+QPair<int, int> QHexMatches::range(qint64 begin, qint64 end) const {
+    int first = this->lowerBound(begin);
+    int last = static_cast<int>(
+        std::lower_bound(m_offsets.begin() + first, m_offsets.end(), end) -
+        m_offsets.begin());
+
+    return {first, last};
+}
+
+bool QHexMatches::intersects(qint64 begin, qint64 end) const {
+    int idx = this->lowerBound(begin);
+    return idx < m_offsets.size() && m_offsets.at(idx) < end;
+}
@@ -1,20 +1,68 @@
-#include <QHexView/model/qhexcursor.h>
+#include <QHexView/model/qhexdocument.h>
 #include <QHexView/model/qhexmetadata.h>
+#include <QHexView/qhexview.h>
+#include <QStringList>
 
-QHexMetadata::QHexMetadata(const QHexOptions* options, QObject* parent)
-    : QObject(parent), m_options(options) {}
+namespace {
+
+// Line indexes kept alive at the same time (one per line length)
+const int MAX_LAYOUTS = 4;
+
+} // namespace
+
+QHexMetadata::QHexMetadata(QObject* parent): QObject(parent) {}
+
+const QList<QHexMetadataItem>& QHexMetadata::items() const { return m_items; }
 
 const QHexMetadataLine* QHexMetadata::find(qint64 line) const {
-    auto it = m_metadata.find(line);
-    return it != m_metadata.end() ? std::addressof(it.value()) : nullptr;
+    return this->find(line, this->lineLength());
+}
+
+const QHexMetadataLine* QHexMetadata::find(qint64 line,
+                                           unsigned int linelength) const {
+    if(!linelength)
+        return nullptr;
+
+    auto iit = m_lines.find(linelength);
+
+    if(iit == m_lines.end()) {
+        if(m_lines.size() >= MAX_LAYOUTS) { // Evict the least recently used
+            auto lru = m_lines.begin();
+
+            for(auto lit = m_lines.begin(); lit != m_lines.end(); lit++) {
+                if(lit->stamp < lru->stamp)
+                    lru = lit;
+            }
+
+            m_lines.erase(lru);
+        }
+
+        iit = m_lines.insert(linelength, Layout{LineIndex{}, 0});
+
+        for(const QHexMetadataItem& mi : m_items)
+            QHexMetadata::indexItem(iit->index, mi, linelength);
+    }
+
+    iit->stamp = ++m_stamp;
+
+    auto it = iit->index.find(line);
+    return it != iit->index.end() ? std::addressof(it.value()) : nullptr;
 }
 
 QString QHexMetadata::getComment(qint64 line, qint64 column) const {
-    auto* metadataline = this->find(line);
+    unsigned int linelength = this->lineLength();
+    return this->getComment(line * linelength + column, linelength);
+}
+
+QString QHexMetadata::getComment(qint64 offset,
+                                 unsigned int linelength) const {
+    if(!linelength)
+        return QString();
+
+    auto* metadataline = this->find(offset / linelength, linelength);
     if(!metadataline)
         return QString();
 
-    auto offset = QHexUtils::positionToOffset(m_options, {line, column});
     QStringList comments;
 
     for(auto& mi : *metadataline) {
@@ -26,17 +74,13 @@ QString QHexMetadata::getComment(qint64 line, qint64 column) const {
     return comments.join("\n");
 }
 
-void QHexMetadata::removeMetadata(qint64 line) {
-    auto it = m_metadata.find(line);
-    if(it == m_metadata.end())
-        return;
-
-    m_metadata.erase(it);
-    Q_EMIT changed();
+void QHexMetadata::removeMetadata(qint64 line, unsigned int linelength) {
+    this->clearMetadata(line, linelength,
+                        [](QHexMetadataItem&) -> bool { return true; });
 }
 
-void QHexMetadata::removeBackground(qint64 line) {
-    this->clearMetadata(line, [](QHexMetadataItem& mi) -> bool {
+void QHexMetadata::removeBackground(qint64 line, unsigned int linelength) {
+    this->clearMetadata(line, linelength, [](QHexMetadataItem& mi) -> bool {
         if(mi.format.background == Qt::NoBrush)
             return false;
 
@@ -49,8 +93,8 @@ void QHexMetadata::removeBackground(qint64 line) {
     });
 }
 
-void QHexMetadata::removeForeground(qint64 line) {
-    this->clearMetadata(line, [](QHexMetadataItem& mi) -> bool {
+void QHexMetadata::removeForeground(qint64 line, unsigned int linelength) {
+    this->clearMetadata(line, linelength, [](QHexMetadataItem& mi) -> bool {
         if(!mi.format.foreground.isValid())
             return false;
 
@@ -63,8 +107,8 @@ void QHexMetadata::removeForeground(qint64 line) {
     });
 }
 
-void QHexMetadata::removeComments(qint64 line) {
-    this->clearMetadata(line, [](QHexMetadataItem& mi) -> bool {
+void QHexMetadata::removeComments(qint64 line, unsigned int linelength) {
+    this->clearMetadata(line, linelength, [](QHexMetadataItem& mi) -> bool {
         if(mi.comment.isEmpty())
             return false;
 
@@ -78,8 +122,8 @@ void QHexMetadata::removeComments(qint64 line) {
     });
 }
 
-void QHexMetadata::unhighlight(qint64 line) {
-    this->clearMetadata(line, [](QHexMetadataItem& mi) -> bool {
+void QHexMetadata::unhighlight(qint64 line, unsigned int linelength) {
+    this->clearMetadata(line, linelength, [](QHexMetadataItem& mi) -> bool {
         if(!mi.format.foreground.isValid() &&
            mi.format.background == Qt::NoBrush)
             return false;
@@ -94,67 +138,118 @@ void QHexMetadata::unhighlight(qint64 line) {
     });
 }
 
+void QHexMetadata::removeMetadata(qint64 line) {
+    this->removeMetadata(line, this->lineLength());
+}
+
+void QHexMetadata::removeBackground(qint64 line) {
+    this->removeBackground(line, this->lineLength());
+}
+
+void QHexMetadata::removeForeground(qint64 line) {
+    this->removeForeground(line, this->lineLength());
+}
+
+void QHexMetadata::removeComments(qint64 line) {
+    this->removeComments(line, this->lineLength());
+}
+
+void QHexMetadata::unhighlight(qint64 line) {
+    this->unhighlight(line, this->lineLength());
+}
+
 void QHexMetadata::clear() {
-    m_metadata.clear();
+    m_items.clear();
+    m_lines.clear();
     Q_EMIT changed();
 }
 
-void QHexMetadata::copy(const QHexMetadata* metadata) {
-    m_metadata = metadata->m_metadata;
+// Overloads without a line length use the one of the first view showing the
+// document, as when the metadata belonged to a single view
+unsigned int QHexMetadata::lineLength() const {
+    auto* document = qobject_cast<const QHexDocument*>(this->parent());
+
+    if(document && !document->views().isEmpty())
+        return document->views().first()->lineLength();
+
+    return QHexOptions{}.line_length;
 }
 
-void QHexMetadata::clearMetadata(qint64 line, ClearMetadataCallback&& cb) {
-    auto iit = m_metadata.find(line);
-    if(iit == m_metadata.end())
+void QHexMetadata::clearMetadata(qint64 line, unsigned int linelength,
+                                 ClearMetadataCallback&& cb) {
+    if(!linelength)
         return;
 
-    auto oldsize = iit->size();
+    // Only the part of an item that falls in 'line' is affected, the rest
+    // is split off and kept as it was
+    const qint64 linebegin = line * linelength;
+    const qint64 lineend = linebegin + linelength;
+    QList<QHexMetadataItem> items;
+    bool notify = false;
+
+    for(const QHexMetadataItem& mi : m_items) {
+        if(!QHexMetadata::isOnLine(mi, line, linelength)) {
+            items.push_back(mi);
+            continue;
+        }
+
+        notify = true;
 
-    for(auto it = iit->begin(); it != iit->end();) {
-        if(cb(*it))
-            it = iit->erase(it);
-        else
-            it++;
+        if(mi.begin < linebegin)
+            items.push_back({mi.begin, linebegin, mi.format, mi.comment});
+
+        QHexMetadataItem lmi = mi;
+        lmi.begin = qMax(mi.begin, linebegin);
+        lmi.end = qMin(mi.end, lineend);
+
+        if(!cb(lmi))
+            items.push_back(lmi);
+
+        if(mi.end > lineend)
+            items.push_back({lineend, mi.end, mi.format, mi.comment});
     }
 
-    if(iit->empty()) {
-        this->removeMetadata(line);
+    if(!notify)
         return;
-    }
 
-    if(oldsize != iit->size())
-        Q_EMIT changed();
+    m_items = items;
+    m_lines.clear();
+    Q_EMIT changed();
 }
 
 void QHexMetadata::setMetadata(const QHexMetadataItem& mi) {
-    if(!m_options->line_length)
+    if(mi.end <= mi.begin)
         return;
 
-    const qint64 firstline = mi.begin / m_options->line_length;
-    const qint64 lastline = mi.end / m_options->line_length;
-    bool notify = false;
+    m_items.push_back(mi);
 
-    for(auto line = firstline; line <= lastline; line++) {
-        auto start = line == firstline ? mi.begin % m_options->line_length : 0;
-        auto length = line == lastline
-                          ? (mi.end % m_options->line_length) - start
-                          : m_options->line_length;
-        if(length <= 0)
-            continue;
+    for(auto it = m_lines.begin(); it != m_lines.end(); it++)
+        QHexMetadata::indexItem(it->index, mi, it.key());
 
-        notify = true;
-        m_metadata[line].push_back(mi);
-    }
+    Q_EMIT changed();
+}
 
-    if(notify)
-        Q_EMIT changed();
+bool QHexMetadata::isOnLine(const QHexMetadataItem& mi, qint64 line,
+                            unsigned int linelength) {
+    const qint64 firstline = mi.begin / linelength;
+    const qint64 lastline = mi.end / linelength;
+
+    if(line < firstline || line > lastline)
+        return false;
+
+    auto start = line == firstline ? mi.begin % linelength : 0;
+    auto length = line == lastline ? (mi.end % linelength) - start
+                                   : static_cast<qint64>(linelength);
+    return length > 0;
 }
 
-void QHexMetadata::invalidate() {
-    auto oldmetadata = m_metadata;
-    m_metadata.clear();
+void QHexMetadata::indexItem(LineIndex& index, const QHexMetadataItem& mi,
+                             unsigned int linelength) {
+    const qint64 firstline = mi.begin / linelength;
+    const qint64 lastline = mi.end / linelength;
 
-    for(const QHexMetadataLine& line : oldmetadata)
-        for(const QHexMetadataItem& mi : line)
-            this->setMetadata(mi);
+    for(auto line = firstline; line <= lastline; line++) {
+        if(QHexMetadata::isOnLine(mi, line, linelength))
+            index[line].push_back(mi);
+    }
 }
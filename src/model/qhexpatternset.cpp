@@ -0,0 +1,299 @@
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexpatternset.h>
+#include <algorithm>
+
+using QHexUtils::QHexPattern;
+using QHexUtils::QHexPatternType;
+
+namespace {
+
+const int VERIFY_READ_SIZE = 4096;
+
+enum class MatchResult { NoMatch, Match, NeedMore };
+
+bool match_less(const QHexPatternMatch& a, const QHexPatternMatch& b) {
+    return a.offset < b.offset || (a.offset == b.offset && a.id < b.id);
+}
+
+// Same semantics of QHexUtils' pattern search, on a buffer that may end
+// before the document does, except that skips are bounded by MAX_SKIP
+MatchResult match_at(const uchar* data, qint64 n, bool atend,
+                     const QHexPattern& pattern, qint64& matchlen) {
+    int ppos = 0, skipidx = -1;
+    qint64 dpos = 0, matchidx = -1, skipbegin = -1;
+
+    while(ppos < pattern.size()) {
+        if(dpos >= n)
+            return atend ? MatchResult::NoMatch : MatchResult::NeedMore;
+
+        const QHexUtils::QHexPatternItem& item = pattern.at(ppos);
+
+        if(item.type == QHexPatternType::WILDCARD ||
+           (item.type == QHexPatternType::BYTE && item.b == data[dpos])) {
+            dpos++;
+            ppos++;
+        }
+        else if(item.type == QHexPatternType::SKIP) {
+            skipidx = ppos++;
+            matchidx = skipbegin = dpos;
+        }
+        else if(skipidx != -1) {
+            if(++matchidx - skipbegin > QHexPatternSet::MAX_SKIP)
+                return MatchResult::NoMatch;
+
+            ppos = skipidx + 1;
+            dpos = matchidx;
+        }
+        else
+            return MatchResult::NoMatch;
+    }
+
+    matchlen = dpos;
+    return MatchResult::Match;
+}
+
+} // namespace
+
+int QHexPatternSet::addBytes(const QByteArray& ba) {
+    QHexPattern pattern;
+
+    for(char ch : ba)
+        pattern.append({QHexPatternType::BYTE, static_cast<quint8>(ch)});
+
+    return this->addPattern(pattern);
+}
+
+int QHexPatternSet::addPattern(const QString& pattern) {
+    return this->addPattern(QHexUtils::compilePattern(pattern));
+}
+
+int QHexPatternSet::addPattern(const QHexPattern& pattern) {
+    Entry e{pattern, -1, 0, false, 0};
+
+    // Leading skips don't constrain the match, trailing ones match nothing
+    while(!e.pattern.isEmpty() &&
+          e.pattern.first().type == QHexPatternType::SKIP)
+        e.pattern.removeFirst();
+    while(!e.pattern.isEmpty() &&
+          e.pattern.last().type == QHexPatternType::SKIP)
+        e.pattern.removeLast();
+
+    if(e.pattern.isEmpty())
+        return -1;
+
+    // Longest run of bytes at a fixed distance from the start
+    for(int i = 0, run = 0; i < e.pattern.size(); i++) {
+        QHexPatternType type = e.pattern.at(i).type;
+        if(type == QHexPatternType::SKIP)
+            break;
+
+        run = type == QHexPatternType::BYTE ? run + 1 : 0;
+
+        if(run > e.anchorlength) {
+            e.anchorlength = run;
+            e.anchor = i - run + 1;
+        }
+    }
+
+    for(const QHexUtils::QHexPatternItem& item : e.pattern)
+        e.maxlength += item.type == QHexPatternType::SKIP ? MAX_SKIP : 1;
+
+    e.exact = e.anchorlength == e.pattern.size();
+    m_entries.append(e);
+    m_compiled = false;
+    return m_entries.size() - 1;
+}
+
+int QHexPatternSet::size() const { return m_entries.size(); }
+bool QHexPatternSet::isEmpty() const { return m_entries.isEmpty(); }
+
+void QHexPatternSet::clear() {
+    m_entries.clear();
+    m_compiled = false;
+}
+
+QHexPatternMatches QHexPatternSet::findAll(const QHexDocument* document,
+                                           qint64 from, qint64 length,
+                                           int limit) const {
+    QHexPatternMatches res;
+    if(!document || m_entries.isEmpty())
+        return res;
+
+    this->compile();
+
+    from = qMax<qint64>(from, 0);
+    qint64 end = document->length();
+    if(length >= 0)
+        end = qMin(end, from + length);
+
+    // The window keeps the bytes before the anchors of the previous chunk
+    QByteArray window;
+    qint64 windowbase = from;
+    qint32 state = 0;
+
+    for(qint64 pos = from; pos < end;) {
+        // Hits are found out of order: stop only when the next ones can't
+        // come before the last one kept
+        if(limit >= 0 && res.size() >= limit) {
+            std::sort(res.begin(), res.end(), match_less);
+            res.erase(res.begin() + limit, res.end());
+
+            if(!limit || pos - res.last().offset >= m_maxanchorend)
+                break;
+        }
+
+        QByteArray chunk = document->read(
+            pos, static_cast<int>(qMin<qint64>(CHUNK_SIZE, end - pos)));
+        if(chunk.isEmpty())
+            break;
+
+        int keep = qMin(m_maxprefix, window.size());
+        windowbase = pos - keep;
+        window = window.right(keep) + chunk;
+
+        const uchar* p = reinterpret_cast<const uchar*>(chunk.constData());
+
+        for(int i = 0; i < chunk.size(); i++) {
+            state = m_delta.at(state * 256 + p[i]);
+
+            for(int id : m_outputs.at(state)) {
+                const Entry& e = m_entries.at(id);
+                qint64 offset = pos + i - e.anchorlength + 1 - e.anchor;
+                qint64 matchlen = e.pattern.size();
+
+                if(offset < from)
+                    continue;
+
+                if(e.exact || this->verify(document, e, offset, end, window,
+                                           windowbase, matchlen))
+                    res.append({id, offset, matchlen});
+            }
+
+            for(int id : m_unanchored) {
+                qint64 matchlen = 0;
+
+                if(this->verify(document, m_entries.at(id), pos + i, end,
+                                window, windowbase, matchlen))
+                    res.append({id, pos + i, matchlen});
+            }
+        }
+
+        pos += chunk.size();
+    }
+
+    // Hits are found at the end of their anchors
+    std::sort(res.begin(), res.end(), match_less);
+
+    if(limit >= 0 && res.size() > limit)
+        res.erase(res.begin() + limit, res.end());
+
+    return res;
+}
+
+void QHexPatternSet::compile() const {
+    if(m_compiled)
+        return;
+
+    m_delta = QVector<qint32>(256, -1);
+    m_outputs = QVector<QVector<int>>(1);
+    m_unanchored.clear();
+    m_maxprefix = 0;
+    m_maxanchorend = 0;
+
+    // Trie of the anchors, missing transitions are -1
+    for(int id = 0; id < m_entries.size(); id++) {
+        const Entry& e = m_entries.at(id);
+
+        if(e.anchor == -1) {
+            m_unanchored.append(id);
+            m_maxanchorend = qMax(m_maxanchorend, 1);
+            continue;
+        }
+
+        qint32 s = 0;
+
+        for(int i = e.anchor; i < e.anchor + e.anchorlength; i++) {
+            int idx = s * 256 + e.pattern.at(i).b;
+
+            if(m_delta.at(idx) == -1) {
+                m_delta[idx] = m_outputs.size();
+                m_delta.resize(m_delta.size() + 256);
+                std::fill(m_delta.end() - 256, m_delta.end(), -1);
+                m_outputs.append(QVector<int>{});
+            }
+
+            s = m_delta.at(idx);
+        }
+
+        m_outputs[s].append(id);
+        m_maxprefix = qMax(m_maxprefix, e.anchor);
+        m_maxanchorend = qMax(m_maxanchorend, e.anchor + e.anchorlength);
+    }
+
+    // Breadth first: fill missing transitions through the failure links
+    QVector<qint32> fail(m_outputs.size(), 0);
+    QVector<qint32> queue;
+
+    for(int c = 0; c < 256; c++) {
+        qint32& t = m_delta[c];
+
+        if(t == -1)
+            t = 0;
+        else
+            queue.append(t);
+    }
+
+    for(int qi = 0; qi < queue.size(); qi++) {
+        qint32 u = queue.at(qi);
+
+        for(int c = 0; c < 256; c++) {
+            qint32 v = m_delta.at(u * 256 + c);
+            qint32 f = m_delta.at(fail.at(u) * 256 + c);
+
+            if(v == -1) {
+                m_delta[u * 256 + c] = f;
+                continue;
+            }
+
+            fail[v] = f;
+            m_outputs[v] += m_outputs.at(f);
+            queue.append(v);
+        }
+    }
+
+    m_compiled = true;
+}
+
+bool QHexPatternSet::verify(const QHexDocument* document, const Entry& entry,
+                            qint64 offset, qint64 end,
+                            const QByteArray& window, qint64 windowbase,
+                            qint64& matchlen) const {
+    MatchResult r = MatchResult::NeedMore;
+    qint64 windowend = windowbase + window.size();
+
+    // Nothing past maxlength can be part of the match
+    qint64 maxlen = qMin(end - offset, entry.maxlength);
+
+    if(offset >= windowbase) {
+        const uchar* p = reinterpret_cast<const uchar*>(window.constData());
+        qint64 n = qMin(windowend - offset, maxlen);
+
+        r = match_at(p + (offset - windowbase), n, n >= maxlen,
+                     entry.pattern, matchlen);
+    }
+
+    // Crosses the chunk: read from the document until it's decided
+    for(qint64 n = VERIFY_READ_SIZE; r == MatchResult::NeedMore; n *= 2) {
+        n = qMin(n, maxlen);
+        QByteArray data = document->read(offset, static_cast<int>(n));
+
+        r = match_at(reinterpret_cast<const uchar*>(data.constData()),
+                     data.size(), data.size() >= maxlen, entry.pattern,
+                     matchlen);
+
+        if(data.size() < n)
+            break;
+    }
+
+    return r == MatchResult::Match;
+}
@@ -0,0 +1,117 @@
+#include <QFile>
+#include <QHexView/model/qhexprofiler.h>
+#include <QThread>
+
+namespace {
+
+const int MAX_TRACE_EVENTS = 1000000;
+
+} // namespace
+
+QHexProfiler::QHexProfiler() {
+    this->reset();
+    m_clock.start();
+
+#if defined(QHEXVIEW_PROFILE)
+    // Set QHEXVIEW_TRACE=<file.json> to trace without changing the code
+    m_tracefile = qEnvironmentVariable("QHEXVIEW_TRACE");
+    if(!m_tracefile.isEmpty())
+        this->startTrace();
+#endif
+}
+
+QHexProfiler::~QHexProfiler() {
+    if(!m_tracefile.isEmpty())
+        this->saveTrace(m_tracefile);
+}
+
+QHexStats QHexProfiler::stats() const {
+    auto v = [this](Counter c) {
+        return m_counters[c].load(std::memory_order_relaxed);
+    };
+
+    QHexStats s;
+    s.reads = v(Reads);
+    s.bytes_read = v(BytesRead);
+    s.cache_hits = v(CacheHits);
+    s.cache_misses = v(CacheMisses);
+    s.draw_formats = v(DrawFormats);
+    s.metadata_lookups = v(MetadataLookups);
+    s.undo_pushes = v(UndoPushes);
+    s.searches = v(Searches);
+    s.bytes_searched = v(BytesSearched);
+    s.frames = v(Frames);
+    s.read_time = v(ReadTime);
+    s.paint_time = v(PaintTime);
+    s.search_time = v(SearchTime);
+    return s;
+}
+
+bool QHexProfiler::isTracing() const {
+    return m_tracing.load(std::memory_order_relaxed);
+}
+
+qint64 QHexProfiler::elapsed() const { return m_clock.nsecsElapsed(); }
+
+void QHexProfiler::reset() {
+    for(auto& c : m_counters)
+        c.store(0, std::memory_order_relaxed);
+
+    QMutexLocker locker(&m_mutex);
+    m_events.clear();
+}
+
+void QHexProfiler::add(Counter c, qint64 v) {
+    m_counters[c].fetch_add(v, std::memory_order_relaxed);
+}
+
+void QHexProfiler::startTrace() {
+    m_tracing.store(true, std::memory_order_relaxed);
+}
+
+void QHexProfiler::stopTrace() {
+    m_tracing.store(false, std::memory_order_relaxed);
+}
+
+void QHexProfiler::traceEvent(const char* name, qint64 begin,
+                              qint64 duration) {
+    QMutexLocker locker(&m_mutex);
+
+    if(m_events.size() < MAX_TRACE_EVENTS) {
+        m_events.append({name, begin, duration,
+                         reinterpret_cast<quintptr>(
+                             QThread::currentThreadId())});
+    }
+}
+
+bool QHexProfiler::saveTrace(QIODevice* device) const {
+    if(!device->isWritable())
+        return false;
+
+    QMutexLocker locker(&m_mutex);
+
+    // Chrome trace event format, timestamps are in microseconds
+    device->write("{\"traceEvents\":[\n");
+
+    for(int i = 0; i < m_events.size(); i++) {
+        const TraceEvent& e = m_events[i];
+
+        device->write(QStringLiteral("%1{\"name\":\"%2\",\"ph\":\"X\","
+                                     "\"pid\":1,\"tid\":%3,\"ts\":%4,"
+                                     "\"dur\":%5}\n")
+                          .arg(QLatin1String(i ? "," : ""))
+                          .arg(QString::fromLatin1(e.name))
+                          .arg(e.thread)
+                          .arg(e.begin / 1000.0, 0, 'f', 3)
+                          .arg(e.duration / 1000.0, 0, 'f', 3)
+                          .toUtf8());
+    }
+
+    device->write("]}\n");
+    return true;
+}
+
+bool QHexProfiler::saveTrace(const QString& filename) const {
+    QFile f(filename);
+    return f.open(QFile::WriteOnly | QFile::Truncate) && this->saveTrace(&f);
+}
@@ -0,0 +1,948 @@
+#include <QHash>
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexregex.h>
+#include <QVector>
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+
+namespace {
+
+const int CHUNK_SIZE = 1 << 20;
+const int MAX_DEPTH = 256;
+const int MAX_NFA_STATES = 1 << 16;
+const int MAX_DFA_STATES = 4096; // The cache is dropped when full
+
+using ByteSet = std::bitset<256>;
+
+struct Node {
+    enum Type { Set, Concat, Alt, Repeat } type;
+    ByteSet set;
+    QVector<int> children;
+    int min, max; // max is -1 if unbounded
+};
+
+int hex_value(QChar c) {
+    ushort u = c.unicode();
+    if(u >= '0' && u <= '9')
+        return u - '0';
+    if(u >= 'a' && u <= 'f')
+        return u - 'a' + 10;
+    if(u >= 'A' && u <= 'F')
+        return u - 'A' + 10;
+    return -1;
+}
+
+void fold_case(ByteSet& set) {
+    for(int c = 'a'; c <= 'z'; c++) {
+        if(set.test(c) || set.test(c - 32)) {
+            set.set(c);
+            set.set(c - 32);
+        }
+    }
+}
+
+class Parser {
+public:
+    Parser(const QString& pattern, bool casesensitive)
+        : m_pattern{pattern}, m_casesensitive{casesensitive} {}
+
+    const QVector<Node>& nodes() const { return m_nodes; }
+    const QString& error() const { return m_error; }
+
+    int parse() {
+        int root = this->parseAlt();
+        if(root != -1 && !this->atEnd())
+            return this->fail(QStringLiteral("Unmatched ')'"));
+        return root;
+    }
+
+private:
+    bool atEnd() const { return m_pos >= m_pattern.size(); }
+    QChar peek(int n = 0) const { return m_pattern.at(m_pos + n); }
+    bool canPeek(int n) const { return m_pos + n < m_pattern.size(); }
+    QChar next() { return m_pattern.at(m_pos++); }
+
+    bool accept(QChar c) {
+        if(this->atEnd() || this->peek() != c)
+            return false;
+        m_pos++;
+        return true;
+    }
+
+    int fail(const QString& msg, int res = -1) {
+        if(m_error.isEmpty())
+            m_error = QStringLiteral("%1 at position %2").arg(msg).arg(m_pos);
+        return res;
+    }
+
+    int add(const Node& n) {
+        m_nodes.append(n);
+        return m_nodes.size() - 1;
+    }
+
+    int addSet(const ByteSet& set) {
+        return this->add({Node::Set, set, {}, 0, 0});
+    }
+
+    int parseAlt() {
+        if(++m_depth > MAX_DEPTH)
+            return this->fail(QStringLiteral("Too many nested groups"));
+
+        int first = this->parseConcat();
+        if(first == -1 || this->atEnd() || this->peek() != '|') {
+            m_depth--;
+            return first;
+        }
+
+        Node alt{Node::Alt, {}, {first}, 0, 0};
+
+        while(this->accept('|')) {
+            int n = this->parseConcat();
+            if(n == -1)
+                return -1;
+            alt.children.append(n);
+        }
+
+        m_depth--;
+        return this->add(alt);
+    }
+
+    int parseConcat() {
+        Node cat{Node::Concat, {}, {}, 0, 0};
+
+        while(!this->atEnd() && this->peek() != '|' && this->peek() != ')') {
+            int n = this->parseRepeat();
+            if(n == -1)
+                return -1;
+            cat.children.append(n);
+        }
+
+        return this->add(cat);
+    }
+
+    int parseRepeat() {
+        int atom = this->parseAtom();
+
+        while(atom != -1 && !this->atEnd()) {
+            int min = 0, max = -1;
+            QChar c = this->peek();
+
+            if(c == '*')
+                m_pos++;
+            else if(c == '+') {
+                min = 1;
+                m_pos++;
+            }
+            else if(c == '?') {
+                max = 1;
+                m_pos++;
+            }
+            else if(c == '{') {
+                if(!this->parseBraces(min, max))
+                    return -1;
+            }
+            else
+                break;
+
+            this->accept('?'); // Lazy, same as greedy with longest matches
+            atom = this->add({Node::Repeat, {}, {atom}, min, max});
+        }
+
+        return atom;
+    }
+
+    bool parseBraces(int& min, int& max) {
+        m_pos++; // '{'
+
+        if(!this->parseNumber(min))
+            return this->fail(QStringLiteral("Invalid repetition"), false);
+
+        max = min;
+
+        if(this->accept(',')) {
+            max = -1;
+            if(!this->atEnd() && this->peek() != '}' && !this->parseNumber(max))
+                return this->fail(QStringLiteral("Invalid repetition"), false);
+        }
+
+        if(!this->accept('}') || (max != -1 && max < min))
+            return this->fail(QStringLiteral("Invalid repetition"), false);
+
+        return true;
+    }
+
+    bool parseNumber(int& n) {
+        int start = m_pos;
+        n = 0;
+
+        while(!this->atEnd() && this->peek().isDigit()) {
+            n = n * 10 + this->next().digitValue();
+            if(n > QHexRegex::MAX_REPEAT)
+                return false;
+        }
+
+        return m_pos > start;
+    }
+
+    int parseAtom() {
+        QChar c = this->next();
+        ByteSet set;
+
+        switch(c.unicode()) {
+            case '(': {
+                if(this->accept('?') && !this->accept(':'))
+                    return this->fail(QStringLiteral("Unsupported group"));
+
+                int n = this->parseAlt();
+                if(n != -1 && !this->accept(')'))
+                    return this->fail(QStringLiteral("Missing ')'"));
+                return n;
+            }
+
+            case '[':
+                return this->parseClass(set) ? this->addSet(set) : -1;
+
+            case '.': return this->addSet(set.set());
+
+            case '\\': {
+                int b = this->parseEscape(set);
+                if(b == -2)
+                    return -1;
+                if(b >= 0)
+                    set = this->literal(static_cast<uchar>(b));
+                return this->addSet(set);
+            }
+
+            case '*':
+            case '+':
+            case '?':
+            case '{': return this->fail(QStringLiteral("Nothing to repeat"));
+
+            case '^':
+            case '$': return this->fail(QStringLiteral("Unsupported anchor"));
+
+            default: break;
+        }
+
+        if(c.unicode() < 0x80)
+            return this->addSet(this->literal(static_cast<uchar>(c.unicode())));
+
+        // Non ASCII characters are matched as UTF-8, like in text mode
+        QByteArray utf8 = QString{c}.toUtf8();
+        if(c.isHighSurrogate() && !this->atEnd())
+            utf8 = (QString{c} + this->next()).toUtf8();
+
+        Node cat{Node::Concat, {}, {}, 0, 0};
+        for(char b : utf8)
+            cat.children.append(this->addSet(this->literal(uchar(b))));
+        return this->add(cat);
+    }
+
+    ByteSet literal(uchar b) const {
+        ByteSet set;
+        set.set(b);
+        if(!m_casesensitive)
+            fold_case(set);
+        return set;
+    }
+
+    // Byte value for single byte escapes, -1 for classes, -2 on error
+    int parseEscape(ByteSet& set) {
+        if(this->atEnd())
+            return this->fail(QStringLiteral("Trailing backslash"), -2);
+
+        QChar c = this->next();
+
+        switch(c.unicode()) {
+            case 'x': {
+                int hi = this->canPeek(1) ? hex_value(this->peek()) : -1;
+                int lo = this->canPeek(1) ? hex_value(this->peek(1)) : -1;
+
+                if(hi == -1 || lo == -1)
+                    return this->fail(QStringLiteral("Invalid \\x escape"), -2);
+
+                m_pos += 2;
+                return (hi << 4) | lo;
+            }
+
+            case 'n': return '\n';
+            case 'r': return '\r';
+            case 't': return '\t';
+            case 'f': return '\f';
+            case 'v': return '\v';
+            case 'a': return '\a';
+            case 'e': return 0x1b;
+            case '0': return 0;
+
+            case 'd':
+            case 'D':
+                for(int b = '0'; b <= '9'; b++)
+                    set.set(b);
+                break;
+
+            case 'w':
+            case 'W':
+                for(int b = '0'; b <= 'z'; b++)
+                    set.set(b, std::isalnum(b) || b == '_');
+                break;
+
+            case 's':
+            case 'S':
+                for(char b : {' ', '\t', '\n', '\r', '\f', '\v'})
+                    set.set(uchar(b));
+                break;
+
+            default:
+                if(c.unicode() >= 0x80 || c.isLetterOrNumber()) {
+                    return this->fail(
+                        QStringLiteral("Unknown escape \\%1").arg(c), -2);
+                }
+
+                return c.unicode();
+        }
+
+        if(c.isUpper())
+            set.flip();
+        return -1;
+    }
+
+    bool parseClass(ByteSet& set) {
+        bool negate = this->accept('^');
+        bool first = true;
+
+        for(;;) {
+            if(this->atEnd())
+                return this->fail(QStringLiteral("Missing ']'"), false);
+
+            if(!first && this->accept(']'))
+                break;
+
+            first = false;
+            int lo = this->parseClassByte(set);
+            if(lo == -2)
+                return false;
+
+            // A range, unless '-' is the last character of the class
+            if(lo >= 0 && this->canPeek(1) && this->peek() == '-' &&
+               this->peek(1) != ']') {
+                m_pos++;
+                ByteSet dummy;
+                int hi = this->parseClassByte(dummy);
+
+                if(hi < lo)
+                    return this->fail(QStringLiteral("Invalid range"), false);
+
+                for(int b = lo; b <= hi; b++)
+                    set.set(b);
+            }
+            else if(lo >= 0)
+                set.set(lo);
+        }
+
+        if(!m_casesensitive)
+            fold_case(set);
+        if(negate)
+            set.flip();
+        return true;
+    }
+
+    int parseClassByte(ByteSet& set) {
+        QChar c = this->next();
+
+        // \D, \W and \S complement their own bytes, not the whole class
+        if(c == '\\') {
+            ByteSet escaped;
+            int b = this->parseEscape(escaped);
+            set |= escaped;
+            return b;
+        }
+
+        if(c.unicode() >= 0x80)
+            return this->fail(
+                QStringLiteral("Use \\xHH for non ASCII bytes in a class"), -2);
+        return c.unicode();
+    }
+
+private:
+    QString m_pattern, m_error;
+    QVector<Node> m_nodes;
+    bool m_casesensitive;
+    int m_pos{0}, m_depth{0};
+};
+
+bool is_nullable(const QVector<Node>& nodes, int idx) {
+    const Node& n = nodes.at(idx);
+
+    switch(n.type) {
+        case Node::Set: return false;
+        case Node::Repeat:
+            return !n.min || is_nullable(nodes, n.children.first());
+
+        case Node::Concat:
+            for(int c : n.children) {
+                if(!is_nullable(nodes, c))
+                    return false;
+            }
+            return true;
+
+        case Node::Alt:
+            for(int c : n.children) {
+                if(is_nullable(nodes, c))
+                    return true;
+            }
+            return false;
+    }
+
+    return false;
+}
+
+qint64 max_length(const QVector<Node>& nodes, int idx) {
+    const Node& n = nodes.at(idx);
+    qint64 len = 0;
+
+    switch(n.type) {
+        case Node::Set: return 1;
+
+        case Node::Repeat: {
+            qint64 c = max_length(nodes, n.children.first());
+            if(!c || !n.max)
+                return 0;
+            return (c == -1 || n.max == -1) ? -1 : c * n.max;
+        }
+
+        case Node::Concat:
+            for(int c : n.children) {
+                qint64 l = max_length(nodes, c);
+                if(l == -1)
+                    return -1;
+                len += l;
+            }
+            break;
+
+        case Node::Alt:
+            for(int c : n.children) {
+                qint64 l = max_length(nodes, c);
+                if(l == -1)
+                    return -1;
+                len = qMax(len, l);
+            }
+            break;
+    }
+
+    return len;
+}
+
+struct NfaState {
+    enum Type { Set, Split, Match } type;
+    int set, out, out1;
+};
+
+// Thompson NFA, built from the end so every fragment knows what follows.
+// The reversed NFA matches the reversed pattern.
+class Nfa {
+public:
+    bool build(const QVector<Node>& nodes, int root, bool reverse) {
+        m_states.clear();
+        m_states.append({NfaState::Match, -1, -1, -1});
+        m_start = this->build(nodes, root, 0, reverse);
+        return m_start != -1;
+    }
+
+    int start() const { return m_start; }
+    const NfaState& at(int idx) const { return m_states.at(idx); }
+    int size() const { return m_states.size(); }
+
+private:
+    int add(const NfaState& s) {
+        if(m_states.size() >= MAX_NFA_STATES)
+            return -1;
+
+        m_states.append(s);
+        return m_states.size() - 1;
+    }
+
+    int build(const QVector<Node>& nodes, int idx, int next, bool reverse) {
+        const Node& n = nodes.at(idx);
+
+        switch(n.type) {
+            case Node::Set: return this->add({NfaState::Set, idx, next, -1});
+
+            case Node::Concat:
+                for(int i = 0; i < n.children.size() && next != -1; i++) {
+                    int c = reverse ? n.children.at(i)
+                                    : n.children.at(n.children.size() - 1 - i);
+                    next = this->build(nodes, c, next, reverse);
+                }
+                return next;
+
+            case Node::Alt: {
+                const QVector<int>& alts = n.children;
+                int entry = this->build(nodes, alts.last(), next, reverse);
+
+                for(int i = alts.size() - 2; i >= 0 && entry != -1; i--) {
+                    int c = this->build(nodes, alts.at(i), next, reverse);
+                    entry = c != -1 ? this->add({NfaState::Split, -1, c, entry})
+                                    : -1;
+                }
+
+                return entry;
+            }
+
+            case Node::Repeat: {
+                int child = n.children.first();
+                int cur = next;
+
+                if(n.max == -1) {
+                    cur = this->add({NfaState::Split, -1, -1, next});
+                    if(cur == -1)
+                        return -1;
+
+                    int body = this->build(nodes, child, cur, reverse);
+                    if(body == -1)
+                        return -1;
+
+                    m_states[cur].out = body;
+                }
+                else {
+                    for(int i = n.min; i < n.max && cur != -1; i++) {
+                        int body = this->build(nodes, child, cur, reverse);
+                        cur = body != -1
+                                  ? this->add({NfaState::Split, -1, body, next})
+                                  : -1;
+                    }
+                }
+
+                for(int i = 0; i < n.min && cur != -1; i++)
+                    cur = this->build(nodes, child, cur, reverse);
+
+                return cur;
+            }
+        }
+
+        return -1;
+    }
+
+private:
+    QVector<NfaState> m_states;
+    int m_start{-1};
+};
+
+// Subset construction done on demand, one transition per byte class.
+// Leftmost states keep the threads grouped by start offset (oldest first,
+// an NFA state belongs to the oldest group reaching it): once a group
+// matches the younger ones are dropped and no more threads are started,
+// so the last match seen before the state dies is the leftmost-longest.
+class LazyDfa {
+public:
+    enum Mode { Leftmost, Anchored, Unanchored };
+
+    enum Flags : int {
+        MATCHED = 1, // Leftmost: a match was found, no new threads
+        MATCH = 2,
+        DEAD = 4,
+    };
+
+public:
+    LazyDfa(const Nfa* nfa, const QVector<ByteSet>* sets,
+            const uchar* classes, int nclasses, Mode mode)
+        : m_nfa{nfa}, m_sets{sets}, m_classes{classes}, m_nclasses{nclasses},
+          m_mode{mode}, m_marks(nfa->size(), 0) {}
+
+    int start() {
+        QVector<int> key{0};
+        this->newGeneration();
+        this->closure(m_nfa->start(), key);
+        std::sort(key.begin() + 1, key.end());
+
+        if(m_mode == Leftmost)
+            key.append(-1);
+
+        return this->intern(key);
+    }
+
+    inline int next(int s, uchar b) {
+        int t = m_trans.at(s * m_nclasses + m_classes[b]);
+        return t >= 0 ? t : this->compute(s, b);
+    }
+
+    inline bool isMatch(int s) const { return m_flags.at(s) & MATCH; }
+    inline bool isDead(int s) const { return m_flags.at(s) & DEAD; }
+
+private:
+    void newGeneration() {
+        if(++m_generation)
+            return;
+
+        std::fill(m_marks.begin(), m_marks.end(), 0);
+        m_generation = 1;
+    }
+
+    // Appends the Set and Match states reachable from idx
+    void closure(int idx, QVector<int>& out) {
+        m_stack.clear();
+        m_stack.append(idx);
+
+        while(!m_stack.isEmpty()) {
+            int i = m_stack.takeLast();
+            if(m_marks.at(i) == m_generation)
+                continue;
+
+            m_marks[i] = m_generation;
+            const NfaState& s = m_nfa->at(i);
+
+            if(s.type == NfaState::Split) {
+                m_stack.append(s.out1);
+                m_stack.append(s.out);
+            }
+            else
+                out.append(i);
+        }
+    }
+
+    bool step(const QVector<int>& key, int begin, int end, uchar b,
+              QVector<int>& out) {
+        int from = out.size();
+
+        for(int i = begin; i < end; i++) {
+            const NfaState& s = m_nfa->at(key.at(i));
+            if(s.type == NfaState::Set && m_sets->at(s.set).test(b))
+                this->closure(s.out, out);
+        }
+
+        std::sort(out.begin() + from, out.end());
+        return out.size() > from;
+    }
+
+    bool hasMatch(const QVector<int>& key, int begin) const {
+        for(int i = begin; i < key.size(); i++) {
+            if(key.at(i) == 0) // The Match state
+                return true;
+        }
+
+        return false;
+    }
+
+    int compute(int s, uchar b) {
+        const QVector<int> key = m_keys.at(s);
+        QVector<int> nk{0};
+        int flags = 0;
+
+        this->newGeneration();
+
+        if(m_mode == Leftmost) {
+            int begin = 1;
+            flags = key.first() & MATCHED;
+
+            for(int i = 1; i < key.size(); i++) {
+                if(key.at(i) != -1)
+                    continue;
+
+                int from = nk.size();
+                bool stepped = this->step(key, begin, i, b, nk);
+                begin = i + 1;
+
+                if(!stepped)
+                    continue;
+
+                nk.append(-1);
+
+                if(this->hasMatch(nk, from)) {
+                    flags |= MATCHED | MATCH;
+                    break;
+                }
+            }
+
+            if(!(flags & MATCHED)) {
+                int from = nk.size();
+                this->closure(m_nfa->start(), nk);
+                std::sort(nk.begin() + from, nk.end());
+                if(nk.size() > from)
+                    nk.append(-1);
+            }
+
+            if(nk.size() == 1)
+                flags |= DEAD;
+        }
+        else {
+            this->step(key, 1, key.size(), b, nk);
+
+            if(m_mode == Unanchored) {
+                this->closure(m_nfa->start(), nk);
+                std::sort(nk.begin() + 1, nk.end());
+            }
+
+            if(this->hasMatch(nk, 1))
+                flags |= MATCH;
+            if(nk.size() == 1 && m_mode == Anchored)
+                flags |= DEAD;
+        }
+
+        nk[0] = flags;
+
+        int flushes = m_flushes;
+        int t = this->intern(nk);
+
+        if(flushes == m_flushes) // s is still valid
+            m_trans[s * m_nclasses + m_classes[b]] = t;
+
+        return t;
+    }
+
+    int intern(const QVector<int>& key) {
+        auto it = m_ids.constFind(key);
+        if(it != m_ids.constEnd())
+            return it.value();
+
+        if(m_keys.size() >= MAX_DFA_STATES) {
+            m_ids.clear();
+            m_keys.clear();
+            m_flags.clear();
+            m_trans.clear();
+            m_flushes++;
+        }
+
+        int id = m_keys.size();
+        m_ids.insert(key, id);
+        m_keys.append(key);
+        m_flags.append(static_cast<uchar>(key.first()));
+        m_trans.resize(m_trans.size() + m_nclasses);
+        std::fill(m_trans.end() - m_nclasses, m_trans.end(), -1);
+        return id;
+    }
+
+private:
+    const Nfa* m_nfa;
+    const QVector<ByteSet>* m_sets;
+    const uchar* m_classes;
+    int m_nclasses;
+    Mode m_mode;
+    QHash<QVector<int>, int> m_ids;
+    QVector<QVector<int>> m_keys; // First item holds the flags
+    QVector<uchar> m_flags;
+    QVector<int> m_trans;
+    QVector<quint32> m_marks;
+    QVector<int> m_stack;
+    quint32 m_generation{0};
+    int m_flushes{0};
+};
+
+} // namespace
+
+struct QHexRegexPrivate {
+    QString pattern, error;
+    QVector<ByteSet> sets; // Indexed by AST node
+    Nfa forward, reverse;
+    uchar classes[256];
+    int nclasses{1};
+    qint64 maxlength{-1};
+    std::unique_ptr<LazyDfa> leftmost, anchoredrev, unanchoredrev;
+};
+
+QHexRegex::QHexRegex(const QString& pattern, bool casesensitive)
+    : d{std::make_shared<QHexRegexPrivate>()} {
+    d->pattern = pattern;
+
+    Parser parser{pattern, casesensitive};
+    int root = parser.parse();
+
+    if(root == -1) {
+        d->error = parser.error();
+        return;
+    }
+
+    const QVector<Node>& nodes = parser.nodes();
+
+    if(is_nullable(nodes, root)) {
+        d->error = QStringLiteral("The pattern matches empty data");
+        return;
+    }
+
+    if(!d->forward.build(nodes, root, false) ||
+       !d->reverse.build(nodes, root, true)) {
+        d->error = QStringLiteral("The pattern is too large");
+        return;
+    }
+
+    // Bytes that no set tells apart share the same DFA transitions
+    std::fill(std::begin(d->classes), std::end(d->classes), 0);
+    d->sets.resize(nodes.size());
+
+    for(int i = 0; i < nodes.size(); i++) {
+        if(nodes.at(i).type != Node::Set)
+            continue;
+
+        const ByteSet& set = nodes.at(i).set;
+        int remap[512];
+        int n = 0;
+
+        d->sets[i] = set;
+        std::fill(std::begin(remap), std::end(remap), -1);
+
+        for(int b = 0; b < 256; b++) {
+            int& c = remap[d->classes[b] * 2 + set.test(b)];
+            if(c == -1)
+                c = n++;
+            d->classes[b] = static_cast<uchar>(c);
+        }
+
+        d->nclasses = n;
+    }
+
+    d->maxlength = max_length(nodes, root);
+    d->leftmost.reset(new LazyDfa(&d->forward, &d->sets, d->classes,
+                                  d->nclasses, LazyDfa::Leftmost));
+    d->anchoredrev.reset(new LazyDfa(&d->reverse, &d->sets, d->classes,
+                                     d->nclasses, LazyDfa::Anchored));
+    d->unanchoredrev.reset(new LazyDfa(&d->reverse, &d->sets, d->classes,
+                                       d->nclasses, LazyDfa::Unanchored));
+}
+
+bool QHexRegex::isValid() const { return d && d->leftmost; }
+QString QHexRegex::pattern() const { return d ? d->pattern : QString{}; }
+QString QHexRegex::errorString() const { return d ? d->error : QString{}; }
+qint64 QHexRegex::maxLength() const { return d ? d->maxlength : -1; }
+
+QPair<qint64, qint64> QHexRegex::match(const QHexDocument* document,
+                                       qint64 from, qint64 to) const {
+    if(!this->isValid() || !document)
+        return {-1, 0};
+
+    qint64 length = document->length();
+    if(to < 0 || to > length)
+        to = length;
+
+    from = qMax<qint64>(from, 0);
+
+    qint64 end = this->matchEnd(document, from, to);
+    if(end == -1)
+        return {-1, 0};
+
+    qint64 start = this->matchStart(document, from, end);
+    return start != -1 ? qMakePair(start, end - start)
+                       : qMakePair(qint64{-1}, qint64{0});
+}
+
+QPair<qint64, qint64> QHexRegex::matchBackward(const QHexDocument* document,
+                                               qint64 from) const {
+    if(!this->isValid() || !document)
+        return {-1, 0};
+
+    qint64 length = document->length();
+    from = qMin(from, length - 1);
+    if(from < 0)
+        return {-1, 0};
+
+    // Matches starting at or before 'from' end before 'to'
+    qint64 to = length;
+    if(d->maxlength != -1)
+        to = qMin(length, from + d->maxlength);
+
+    LazyDfa& dfa = *d->unanchoredrev;
+    int s = dfa.start();
+
+    for(qint64 pos = to; pos > 0;) {
+        qint64 begin = qMax<qint64>(0, pos - CHUNK_SIZE);
+        QByteArray chunk =
+            document->read(begin, static_cast<int>(pos - begin));
+        const uchar* p = reinterpret_cast<const uchar*>(chunk.constData());
+
+        if(chunk.size() != pos - begin)
+            break;
+
+        for(int i = chunk.size() - 1; i >= 0; i--) {
+            s = dfa.next(s, p[i]);
+
+            if(begin + i <= from && dfa.isMatch(s)) {
+                qint64 start = begin + i;
+                qint64 end = this->matchEnd(document, start, length);
+                return {start, end - start};
+            }
+        }
+
+        pos = begin;
+    }
+
+    return {-1, 0};
+}
+
+QList<QPair<qint64, qint64>> QHexRegex::findAll(const QHexDocument* document,
+                                               qint64 from, qint64 length,
+                                               int limit) const {
+    QList<QPair<qint64, qint64>> res;
+    if(!this->isValid() || !document)
+        return res;
+
+    qint64 to = length >= 0 ? from + length : -1;
+
+    while(limit < 0 || res.size() < limit) {
+        QPair<qint64, qint64> m = this->match(document, from, to);
+        if(m.first == -1)
+            break;
+
+        res.append(m);
+        from = m.first + m.second; // Never empty
+    }
+
+    return res;
+}
+
+qint64 QHexRegex::matchEnd(const QHexDocument* document, qint64 from,
+                           qint64 to) const {
+    LazyDfa& dfa = *d->leftmost;
+    int s = dfa.start();
+    qint64 last = -1;
+
+    for(qint64 pos = from; pos < to;) {
+        QByteArray chunk = document->read(
+            pos, static_cast<int>(qMin<qint64>(CHUNK_SIZE, to - pos)));
+        const uchar* p = reinterpret_cast<const uchar*>(chunk.constData());
+
+        if(chunk.isEmpty())
+            break;
+
+        for(int i = 0; i < chunk.size(); i++) {
+            s = dfa.next(s, p[i]);
+
+            if(dfa.isMatch(s))
+                last = pos + i + 1;
+            else if(dfa.isDead(s))
+                return last;
+        }
+
+        pos += chunk.size();
+    }
+
+    return last;
+}
+
+qint64 QHexRegex::matchStart(const QHexDocument* document, qint64 from,
+                             qint64 end) const {
+    // The smallest start of a match ending at 'end' is the leftmost one
+    LazyDfa& dfa = *d->anchoredrev;
+    int s = dfa.start();
+    qint64 first = -1;
+
+    for(qint64 pos = end; pos > from;) {
+        qint64 begin = qMax(from, pos - CHUNK_SIZE);
+        QByteArray chunk =
+            document->read(begin, static_cast<int>(pos - begin));
+        const uchar* p = reinterpret_cast<const uchar*>(chunk.constData());
+
+        if(chunk.size() != pos - begin)
+            break;
+
+        for(int i = chunk.size() - 1; i >= 0; i--) {
+            s = dfa.next(s, p[i]);
+
+            if(dfa.isMatch(s))
+                first = begin + i;
+            else if(dfa.isDead(s))
+                return first;
+        }
+
+        pos = begin;
+    }
+
+    return first;
+}
@@ -0,0 +1,582 @@
+#include <QDataStream>
+#include <QFile>
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexsearchindex.h>
+#include <QHexView/model/qhexworker.h>
+#include <QTemporaryFile>
+#include <QtAlgorithms>
+#include <algorithm>
+#include <cstring>
+
+// Index file layout:
+//   header (INDEX_HEADER_SIZE bytes)
+//   FILTER_BITS words for each batch of 64 blocks, bit N of a word
+//   belongs to block N of the batch (native endianness)
+
+namespace {
+
+const char INDEX_MAGIC[] = "QHXSIX01";
+const quint32 INDEX_VERSION = 1;
+const qint64 INDEX_HEADER_SIZE = 64;
+const qint64 BATCH_BLOCKS = 64;
+const qint64 BATCH_SIZE = BATCH_BLOCKS * QHexSearchIndex::BLOCK_SIZE;
+const qint64 BATCH_BYTES = QHexSearchIndex::FILTER_BITS * sizeof(quint64);
+const qint64 FINGERPRINT_SIZE = 64 * 1024;
+const int MAX_QUERY_GRAMS = 32;
+const int MAX_PATCH_BLOCKS = 256;
+const int RESTART_DELAY_MS = 250;
+
+static_assert(QHexSearchIndex::FILTER_BITS == 1 << 16,
+              "gram_bit() returns 16 bits");
+
+struct LowerTable {
+    uchar t[256];
+
+    LowerTable() {
+        for(int i = 0; i < 256; i++)
+            t[i] = static_cast<uchar>(i >= 'A' && i <= 'Z' ? i + 32 : i);
+    }
+};
+
+const LowerTable LOWERTABLE;
+
+inline int gram_bit(quint32 gram) {
+    return static_cast<int>((gram * 0x9E3779B1u) >> 16);
+}
+
+qint64 block_count(qint64 length) {
+    return (length + QHexSearchIndex::BLOCK_SIZE - 1) /
+           QHexSearchIndex::BLOCK_SIZE;
+}
+
+qint64 batch_count(qint64 length) {
+    return (block_count(length) + BATCH_BLOCKS - 1) / BATCH_BLOCKS;
+}
+
+// Same folding of QHexUtils' case insensitive search (ASCII only)
+QByteArray to_lower(const QByteArray& ba) {
+    QByteArray res(ba.size(), Qt::Uninitialized);
+    const uchar* src = reinterpret_cast<const uchar*>(ba.constData());
+    uchar* dst = reinterpret_cast<uchar*>(res.data());
+
+    for(int i = 0; i < ba.size(); i++)
+        dst[i] = LOWERTABLE.t[src[i]];
+
+    return res;
+}
+
+// Sets the bit of block firstblock + i / BLOCK_SIZE for every gram
+// starting at i < count
+void add_grams(const uchar* p, int n, qint64 count, quint64* words,
+               int firstblock) {
+    const int G = QHexSearchIndex::GRAM_SIZE;
+    quint32 g = 0;
+
+    for(int i = 0; i < n; i++) {
+        g = (g << 8) | LOWERTABLE.t[p[i]];
+
+        int s = i - (G - 1);
+        if(s < 0)
+            continue;
+        if(s >= count)
+            break;
+
+        int block = firstblock + s / QHexSearchIndex::BLOCK_SIZE;
+        words[gram_bit(g)] |= quint64{1} << block;
+    }
+}
+
+// Grams of a match starting in block B start in B or B + 1
+QVector<int> query_bits(const QByteArray& ba) {
+    QByteArray prefix = to_lower(ba.left(QHexSearchIndex::BLOCK_SIZE / 2));
+    const uchar* p = reinterpret_cast<const uchar*>(prefix.constData());
+    QVector<int> bits;
+
+    for(int i = 0; i + QHexSearchIndex::GRAM_SIZE <= prefix.size(); i++) {
+        quint32 g = (quint32{p[i]} << 24) | (quint32{p[i + 1]} << 16) |
+                    (quint32{p[i + 2]} << 8) | p[i + 3];
+        bits.append(gram_bit(g));
+    }
+
+    std::sort(bits.begin(), bits.end());
+    bits.erase(std::unique(bits.begin(), bits.end()), bits.end());
+
+    if(bits.size() > MAX_QUERY_GRAMS)
+        bits.resize(MAX_QUERY_GRAMS);
+
+    return bits;
+}
+
+} // namespace
+
+class QHexSearchIndexWorker: public QHexWorker {
+public:
+    explicit QHexSearchIndexWorker(QHexSearchIndex* index)
+        : QHexWorker{index}, m_index{index}, m_document{index->document()},
+          m_file{index->m_file}, m_length{index->m_length} {}
+
+    ~QHexSearchIndexWorker() override { this->cancel(); }
+    bool isComplete() const { return m_complete; }
+
+protected:
+    void run() override {
+        QVector<quint64> words(QHexSearchIndex::FILTER_BITS);
+
+        for(qint64 pos = 0; pos < m_length; pos += BATCH_SIZE) {
+            if(this->isCancelled())
+                return;
+
+            int n = static_cast<int>(qMin<qint64>(
+                BATCH_SIZE + QHexSearchIndex::GRAM_SIZE - 1, m_length - pos));
+
+            QByteArray data = this->read(m_document, pos, n);
+            if(data.size() != n)
+                return;
+
+            std::fill(words.begin(), words.end(), 0);
+            add_grams(reinterpret_cast<const uchar*>(data.constData()), n,
+                      BATCH_SIZE, words.data(), 0);
+
+            if(m_file->write(reinterpret_cast<const char*>(words.constData()),
+                             BATCH_BYTES) != BATCH_BYTES)
+                return;
+
+            this->notify(qMin(pos + BATCH_SIZE, m_length));
+        }
+
+        m_complete = m_file->flush() && !this->isCancelled();
+    }
+
+private:
+    void notify(qint64 done) {
+        QHexSearchIndex* index = m_index;
+        qint64 total = m_length;
+
+        QMetaObject::invokeMethod(
+            index,
+            [index, done, total]() { Q_EMIT index->progress(done, total); },
+            Qt::QueuedConnection);
+    }
+
+private:
+    QHexSearchIndex* m_index;
+    const QHexDocument* m_document;
+    QFile* m_file;
+    qint64 m_length;
+    bool m_complete{false};
+};
+
+QHexSearchIndex::QHexSearchIndex(QHexDocument* document,
+                                 const QString& filename, QObject* parent)
+    : QObject{parent}, m_document{document}, m_filename{filename} {
+    m_restarttimer.setSingleShot(true);
+    m_restarttimer.setInterval(RESTART_DELAY_MS);
+    connect(&m_restarttimer, &QTimer::timeout, this, &QHexSearchIndex::start);
+
+    connect(document, &QHexDocument::dataChanged, this,
+            [this](const QByteArray& data, quint64 offset,
+                   QHexChangeReason reason) {
+                if(!m_file) // Not started
+                    return;
+
+                if(m_ready && reason == QHexChangeReason::Replace) {
+                    this->patch(static_cast<qint64>(offset), data.size());
+                    return;
+                }
+
+                this->invalidate();
+                m_restarttimer.start();
+            });
+
+    connect(document, &QHexDocument::reset, this, [this]() {
+        if(!m_file)
+            return;
+
+        this->invalidate();
+        m_restarttimer.start();
+    });
+
+    connect(document, &QHexDocument::modifiedChanged, this,
+            [this](bool modified) {
+                if(!modified && m_ready)
+                    this->stamp(true);
+            });
+
+    connect(document, &QObject::destroyed, this, &QHexSearchIndex::cancel);
+    document->setSearchIndex(this);
+}
+
+QHexSearchIndex::~QHexSearchIndex() {
+    this->cancel();
+    this->unmap();
+}
+
+QHexDocument* QHexSearchIndex::document() const { return m_document; }
+QString QHexSearchIndex::fileName() const { return m_filename; }
+bool QHexSearchIndex::isReady() const { return m_ready; }
+
+bool QHexSearchIndex::isRunning() const {
+    return m_worker && m_worker->isRunning();
+}
+
+bool QHexSearchIndex::canSearch(const QByteArray& ba) const {
+    return m_ready && m_document && ba.size() >= GRAM_SIZE &&
+           m_length == m_document->length();
+}
+
+qint64 QHexSearchIndex::indexOf(const QByteArray& ba, qint64 from,
+                                bool casesensitive) const {
+    if(!this->canSearch(ba))
+        return -1;
+
+    from = qMax<qint64>(from, 0);
+    QByteArray needle = casesensitive ? ba : to_lower(ba);
+    QVector<int> bits = query_bits(ba);
+    qint64 fromblock = from / BLOCK_SIZE;
+
+    for(qint64 b = fromblock / BATCH_BLOCKS; b < batch_count(m_length); b++) {
+        qint64 first = b * BATCH_BLOCKS;
+        quint64 m = this->candidates(bits, b);
+
+        if(fromblock > first)
+            m &= ~quint64{0} << (fromblock - first);
+
+        while(m) {
+            int i = qCountTrailingZeroBits(m);
+            m &= m - 1;
+
+            qint64 offset = this->scanBlock(needle, first + i, from, m_length,
+                                            casesensitive, false);
+            if(offset != -1)
+                return offset;
+        }
+    }
+
+    return -1;
+}
+
+qint64 QHexSearchIndex::lastIndexOf(const QByteArray& ba, qint64 from,
+                                    bool casesensitive) const {
+    if(!this->canSearch(ba))
+        return -1;
+
+    from = qMin(from, m_length - ba.size());
+    if(from < 0)
+        return -1;
+
+    QByteArray needle = casesensitive ? ba : to_lower(ba);
+    QVector<int> bits = query_bits(ba);
+    qint64 fromblock = from / BLOCK_SIZE;
+
+    for(qint64 b = fromblock / BATCH_BLOCKS; b >= 0; b--) {
+        qint64 first = b * BATCH_BLOCKS;
+        quint64 m = this->candidates(bits, b);
+
+        if(fromblock - first < BATCH_BLOCKS - 1)
+            m &= (quint64{2} << (fromblock - first)) - 1;
+
+        while(m) {
+            int i = 63 - qCountLeadingZeroBits(m);
+            m &= ~(quint64{1} << i);
+
+            qint64 offset = this->scanBlock(needle, first + i, 0, from + 1,
+                                            casesensitive, true);
+            if(offset != -1)
+                return offset;
+        }
+    }
+
+    return -1;
+}
+
+QList<qint64> QHexSearchIndex::findAll(const QByteArray& ba,
+                                       bool casesensitive, int limit) const {
+    QList<qint64> res;
+    if(!this->canSearch(ba))
+        return res;
+
+    QByteArray needle = casesensitive ? ba : to_lower(ba);
+    QVector<int> bits = query_bits(ba);
+
+    for(qint64 b = 0; b < batch_count(m_length) &&
+                      (limit < 0 || res.size() < limit);
+        b++) {
+        quint64 m = this->candidates(bits, b);
+
+        while(m && (limit < 0 || res.size() < limit)) {
+            int i = qCountTrailingZeroBits(m);
+            m &= m - 1;
+
+            this->scanBlock(needle, b * BATCH_BLOCKS + i, 0, m_length,
+                            casesensitive, false, &res, limit);
+        }
+    }
+
+    return res;
+}
+
+void QHexSearchIndex::start() {
+    this->cancel();
+    this->unmap();
+
+    if(!m_document)
+        return;
+
+    if(this->load()) {
+        Q_EMIT finished();
+        return;
+    }
+
+    QFile* f = nullptr;
+
+    if(!m_filename.isEmpty()) {
+        f = new QFile(m_filename, this);
+
+        if(!f->open(QFile::ReadWrite | QFile::Truncate)) {
+            delete f;
+            f = nullptr;
+        }
+    }
+
+    if(!f) { // Not persistable, keep it for this session only
+        auto* tf = new QTemporaryFile(this);
+
+        if(!tf->open()) {
+            delete tf;
+            return;
+        }
+
+        f = tf;
+    }
+
+    delete m_file;
+    m_file = f;
+    m_length = m_document->length();
+    m_stamped = false;
+
+    // Leave the header zeroed until the index is complete
+    QByteArray header(INDEX_HEADER_SIZE, 0);
+    if(m_file->write(header) != INDEX_HEADER_SIZE)
+        return;
+
+    m_worker = new QHexSearchIndexWorker(this);
+    QHexSearchIndexWorker* worker = m_worker;
+
+    connect(m_worker, &QThread::finished, this, [this, worker]() {
+        if(worker != m_worker || !worker->isComplete() || !this->map())
+            return;
+
+        m_ready = true;
+        this->stamp(!m_document->isModified());
+        Q_EMIT finished();
+    });
+
+    m_worker->start(QThread::LowPriority);
+}
+
+void QHexSearchIndex::cancel() {
+    m_restarttimer.stop();
+
+    if(!m_worker)
+        return;
+
+    m_worker->disconnect(this);
+    delete m_worker;
+    m_worker = nullptr;
+}
+
+void QHexSearchIndex::invalidate() {
+    this->cancel();
+
+    if(m_file && m_stamped)
+        this->stamp(false);
+
+    this->unmap();
+}
+
+bool QHexSearchIndex::load() {
+    if(m_filename.isEmpty() || m_document->isModified())
+        return false;
+
+    auto* f = new QFile(m_filename, this);
+
+    if(!f->open(QFile::ReadWrite)) {
+        delete f;
+        return false;
+    }
+
+    QDataStream ds(f);
+    char magic[sizeof(INDEX_MAGIC) - 1];
+    quint32 version = 0, blocksize = 0, filterbits = 0;
+    qint64 length = 0;
+    quint64 fingerprint = 0;
+
+    ds.readRawData(magic, sizeof(magic));
+    ds >> version >> blocksize >> filterbits >> length >> fingerprint;
+
+    // Stale or incomplete indexes are simply rebuilt
+    if(ds.status() != QDataStream::Ok ||
+       std::memcmp(magic, INDEX_MAGIC, sizeof(magic)) ||
+       version != INDEX_VERSION || blocksize != BLOCK_SIZE ||
+       filterbits != FILTER_BITS || length != m_document->length() ||
+       f->size() != INDEX_HEADER_SIZE + batch_count(length) * BATCH_BYTES) {
+        delete f;
+        return false;
+    }
+
+    delete m_file;
+    m_file = f;
+    m_length = length;
+
+    if(fingerprint != this->fingerprint() || !this->map())
+        return false;
+
+    m_ready = m_stamped = true;
+    return true;
+}
+
+bool QHexSearchIndex::map() {
+    qint64 size = batch_count(m_length) * BATCH_BYTES;
+    if(!size)
+        return true; // Empty document, nothing can match
+
+    uchar* p = m_file->map(INDEX_HEADER_SIZE, size);
+    m_words = reinterpret_cast<quint64*>(p);
+    return p != nullptr;
+}
+
+void QHexSearchIndex::unmap() {
+    if(m_file && m_words)
+        m_file->unmap(reinterpret_cast<uchar*>(m_words));
+
+    m_words = nullptr;
+    m_ready = false;
+}
+
+void QHexSearchIndex::stamp(bool valid) {
+    QByteArray header(INDEX_HEADER_SIZE, 0);
+
+    // The file describes the unmodified document only, edits patched in
+    // memory must not be picked up by the next session
+    if(valid) {
+        QByteArray fields;
+        QDataStream ds(&fields, QIODevice::WriteOnly);
+        ds.writeRawData(INDEX_MAGIC, sizeof(INDEX_MAGIC) - 1);
+        ds << INDEX_VERSION << quint32{BLOCK_SIZE} << quint32{FILTER_BITS}
+           << m_length << this->fingerprint();
+        header.replace(0, fields.size(), fields);
+    }
+
+    if(m_file->seek(0) && m_file->write(header) == INDEX_HEADER_SIZE &&
+       m_file->flush())
+        m_stamped = valid;
+}
+
+void QHexSearchIndex::patch(qint64 offset, qint64 length) {
+    // Grams ending in the replaced range may start in the previous block
+    qint64 first = qMax<qint64>(offset - (GRAM_SIZE - 1), 0) / BLOCK_SIZE;
+    qint64 last = qMin(offset + length - 1, m_length - 1) / BLOCK_SIZE;
+
+    if(last - first >= MAX_PATCH_BLOCKS) {
+        this->invalidate();
+        m_restarttimer.start();
+        return;
+    }
+
+    if(m_stamped)
+        this->stamp(false);
+
+    for(qint64 b = first; b <= last; b++)
+        this->indexBlock(b);
+}
+
+void QHexSearchIndex::indexBlock(qint64 block) {
+    // Bloom filters can't remove items: clear the block and add it again
+    quint64* words = m_words + (block / BATCH_BLOCKS) * FILTER_BITS;
+    int bit = static_cast<int>(block % BATCH_BLOCKS);
+    quint64 mask = ~(quint64{1} << bit);
+
+    for(int i = 0; i < FILTER_BITS; i++)
+        words[i] &= mask;
+
+    qint64 begin = block * BLOCK_SIZE;
+    QByteArray data = m_document->read(
+        begin, static_cast<int>(qMin<qint64>(BLOCK_SIZE + GRAM_SIZE - 1,
+                                             m_length - begin)));
+
+    add_grams(reinterpret_cast<const uchar*>(data.constData()), data.size(),
+              BLOCK_SIZE, words, bit);
+}
+
+quint64 QHexSearchIndex::fingerprint() const {
+    // Length and a few sampled windows, enough to tell images apart
+    const quint64 FNV_PRIME = Q_UINT64_C(0x100000001b3);
+    quint64 h = Q_UINT64_C(0xcbf29ce484222325) ^ static_cast<quint64>(m_length);
+    const qint64 SAMPLES[] = {0, (m_length - FINGERPRINT_SIZE) / 2,
+                              m_length - FINGERPRINT_SIZE};
+
+    for(qint64 offset : SAMPLES) {
+        offset = qMax<qint64>(offset, 0);
+        QByteArray data = m_document->read(
+            offset,
+            static_cast<int>(qMin(FINGERPRINT_SIZE, m_length - offset)));
+
+        for(char ch : data)
+            h = (h ^ static_cast<uchar>(ch)) * FNV_PRIME;
+    }
+
+    return h;
+}
+
+quint64 QHexSearchIndex::candidates(const QVector<int>& bits,
+                                    qint64 batch) const {
+    const quint64* words = m_words + batch * FILTER_BITS;
+    const quint64* next =
+        batch + 1 < batch_count(m_length) ? words + FILTER_BITS : nullptr;
+    quint64 m = ~quint64{0};
+
+    // Each gram must be in the block itself or in the following one
+    for(int bit : bits) {
+        quint64 w = words[bit];
+        quint64 n = next ? next[bit] : 0;
+        m &= w | (w >> 1) | (n << 63);
+
+        if(!m)
+            break;
+    }
+
+    return m;
+}
+
+qint64 QHexSearchIndex::scanBlock(const QByteArray& needle, qint64 block,
+                                  qint64 from, qint64 to, bool casesensitive,
+                                  bool backward, QList<qint64>* all,
+                                  int limit) const {
+    // Matches starting in [from, to) inside the block
+    qint64 begin = qMax(from, block * BLOCK_SIZE);
+    qint64 end = qMin(to, qMin((block + 1) * BLOCK_SIZE, m_length));
+    if(begin >= end)
+        return -1;
+
+    QByteArray data = m_document->read(
+        begin, static_cast<int>(qMin(end - begin + needle.size() - 1,
+                                     m_length - begin)));
+
+    if(!casesensitive)
+        data = to_lower(data);
+
+    if(!all) {
+        int idx = backward ? data.lastIndexOf(needle) : data.indexOf(needle);
+        return idx != -1 ? begin + idx : -1;
+    }
+
+    for(int idx = data.indexOf(needle); idx != -1;
+        idx = data.indexOf(needle, idx + 1)) {
+        if(limit >= 0 && all->size() >= limit)
+            break;
+
+        all->append(begin + idx);
+    }
+
+    return all->isEmpty() ? -1 : all->last();
+}
@@ -2,22 +2,36 @@
 #include <QDataStream>
 #include <QGlobalStatic>
 #include <QHash>
+#include <QHexView/model/qhexfuzzy.h>
 #include <QHexView/model/qhexoptions.h>
+#include <QHexView/model/qhexpatternset.h>
+#include <QHexView/model/qhexregex.h>
+#include <QHexView/model/qhexsearchindex.h>
 #include <QHexView/model/qhexutils.h>
+#include <QHexView/model/qhexvaluerange.h>
 #include <QHexView/qhexview.h>
 #include <QList>
+#include <QVector>
 #include <QtEndian>
+#include <cstring>
 #include <limits>
 
 #if defined(_WIN32) && _MSC_VER <= 1916 // v141_xp
 #include <ctype.h>
 namespace std {
 using ::tolower;
+using ::toupper;
 }
 #else
 #include <cctype>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QHEXVIEW_HEX_SSE2
+#endif
+
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #define QHEXVIEW_VARIANT_EQ(x, t) ((x).metaType().id() == QMetaType::Q##t)
 #else
@@ -26,9 +40,38 @@ using ::tolower;
 
 namespace QHexUtils {
 
-Q_GLOBAL_STATIC_WITH_ARGS(QList<char>, HEXMAP,
-                          ({'0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
-                            'a', 'b', 'c', 'd', 'e', 'f'}));
+namespace {
+
+struct HexTable {
+    char lower[512];
+    char upper[512];
+    signed char digit[256]; // -1 for non hex characters
+
+    HexTable() {
+        static const char* const LOWER = "0123456789abcdef";
+        static const char* const UPPER = "0123456789ABCDEF";
+
+        for(int b = 0; b < 256; b++) {
+            lower[b * 2] = LOWER[b >> 4];
+            lower[b * 2 + 1] = LOWER[b & 0x0f];
+            upper[b * 2] = UPPER[b >> 4];
+            upper[b * 2 + 1] = UPPER[b & 0x0f];
+
+            if(b >= '0' && b <= '9')
+                digit[b] = static_cast<signed char>(b - '0');
+            else if(b >= 'a' && b <= 'f')
+                digit[b] = static_cast<signed char>(b - 'a' + 10);
+            else if(b >= 'A' && b <= 'F')
+                digit[b] = static_cast<signed char>(b - 'A' + 10);
+            else
+                digit[b] = -1;
+        }
+    }
+};
+
+const HexTable HEXTABLE;
+
+} // namespace
 
 bool isHex(char ch) {
     return (ch >= '0' && ch <= '9') || (ch >= 'A' && ch <= 'F') ||
@@ -43,7 +86,7 @@ bool match(const QHexDocument* doc, const QHexPattern& pattern, qint64 idx,
         return false;
 
     int ppos = 0, dpos = idx;
-    int skipidx = -1, matchidx = -1;
+    int skipidx = -1, matchidx = -1, skipbegin = -1;
     qint64 len = doc->length();
 
     while(ppos < pattern.size()) {
@@ -58,11 +101,15 @@ bool match(const QHexDocument* doc, const QHexPattern& pattern, qint64 idx,
         }
         else if(pattern[ppos].type == QHexPatternType::SKIP) {
             skipidx = ppos++;
-            matchidx = dpos;
+            matchidx = skipbegin = dpos;
         }
         else if(skipidx != -1) {
+            // Same bound as QHexPatternSet, Find and Find All agree
+            if(++matchidx - skipbegin > QHexPatternSet::MAX_SKIP)
+                return false;
+
             ppos = skipidx + 1;
-            dpos = ++matchidx;
+            dpos = matchidx;
         }
         else
             return false;
@@ -179,46 +226,276 @@ qint64 findIter(qint64 startoffset, QHexFindDirection fd,
     return offset;
 }
 
-qint64 findDefault(const QByteArray& value, qint64 startoffset,
-                   const QHexView* hexview, unsigned int options,
-                   QHexFindDirection fd) {
+const int SEARCH_CHUNK = 1 << 20;
+const int PATTERN_BATCH = 64 * 1024; // Pattern hits kept at once
+
+// Both spellings of a text, compared one character at a time so that
+// mixing the bytes of different spellings never matches
+struct FoldedText {
+    QByteArray lower, upper;
+    QVector<int> ends; // Where every character ends
+};
+
+bool encodeChar(uint cp, unsigned int options, QByteArray& out) {
+    auto put = [&out](uint v, int n, bool be) {
+        for(int i = 0; i < n; i++)
+            out.append(static_cast<char>(v >> ((be ? n - 1 - i : i) * 8)));
+    };
+
+    if(options & (QHexFindOptions::Utf16LE | QHexFindOptions::Utf16BE)) {
+        bool be = options & QHexFindOptions::Utf16BE;
+
+        if(QChar::requiresSurrogates(cp)) {
+            put(QChar::highSurrogate(cp), 2, be);
+            put(QChar::lowSurrogate(cp), 2, be);
+        }
+        else
+            put(cp, 2, be);
+    }
+    else if(options & (QHexFindOptions::Utf32LE | QHexFindOptions::Utf32BE))
+        put(cp, 4, options & QHexFindOptions::Utf32BE);
+    else if(options & QHexFindOptions::Latin1) {
+        if(cp > 0xff)
+            return false;
+        out.append(static_cast<char>(cp));
+    }
+    else if(cp < 0x80)
+        out.append(static_cast<char>(cp));
+    else if(cp < 0x800) {
+        out.append(static_cast<char>(0xc0 | (cp >> 6)));
+        out.append(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+    else if(cp < 0x10000) {
+        out.append(static_cast<char>(0xe0 | (cp >> 12)));
+        out.append(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.append(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+    else {
+        out.append(static_cast<char>(0xf0 | (cp >> 18)));
+        out.append(static_cast<char>(0x80 | ((cp >> 12) & 0x3f)));
+        out.append(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.append(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+
+    return true;
+}
+
+bool encodeText(const QString& s, unsigned int options, bool fold,
+                FoldedText& text) {
+    for(uint cp : s.toUcs4()) {
+        QByteArray lower, upper;
+
+        // Characters whose cases don't encode to the same length
+        // (or can't be encoded) are matched as they are
+        if(!fold || !encodeChar(QChar::toLower(cp), options, lower) ||
+           !encodeChar(QChar::toUpper(cp), options, upper) ||
+           lower.size() != upper.size()) {
+            lower.clear();
+            if(!encodeChar(cp, options, lower))
+                return false;
+            upper = lower;
+        }
+
+        text.lower.append(lower);
+        text.upper.append(upper);
+        text.ends.append(text.lower.size());
+    }
+
+    return !text.lower.isEmpty();
+}
+
+FoldedText exactText(const QByteArray& ba) { return {ba, ba, {ba.size()}}; }
+
+// Raw bytes have no encoding, only ASCII letters are folded
+FoldedText asciiFoldedText(const QByteArray& ba) {
+    FoldedText text;
+
+    for(int i = 0; i < ba.size(); i++) {
+        uchar ch = ba.at(i);
+        text.lower.append(static_cast<char>(std::tolower(ch)));
+        text.upper.append(static_cast<char>(std::toupper(ch)));
+        text.ends.append(i + 1);
+    }
+
+    return text;
+}
+
+bool matchText(const char* p, const FoldedText& text) {
+    int begin = 0;
+
+    for(int end : text.ends) {
+        int n = end - begin;
+
+        if(std::memcmp(p + begin, text.lower.constData() + begin, n) &&
+           std::memcmp(p + begin, text.upper.constData() + begin, n))
+            return false;
+
+        begin = end;
+    }
+
+    return true;
+}
+
+// First (last) match starting in data[0, count)
+int indexOfText(const QByteArray& data, int count, const FoldedText& text,
+                bool backward) {
+    if(text.lower == text.upper) {
+        int idx = backward ? data.lastIndexOf(text.lower, count - 1)
+                           : data.indexOf(text.lower);
+        return idx < count ? idx : -1;
+    }
+
+    const char* p = data.constData();
+    char a = text.lower.at(0), b = text.upper.at(0);
+
+    if(backward) {
+        for(int i = count - 1; i >= 0; i--) {
+            if((p[i] == a || p[i] == b) && matchText(p + i, text))
+                return i;
+        }
+
+        return -1;
+    }
+
+    // Candidates come from memchr() of the first byte of both spellings
+    auto next = [p, count](char c, int from) -> const char* {
+        if(from >= count)
+            return nullptr;
+        return static_cast<const char*>(
+            std::memchr(p + from, c, static_cast<size_t>(count - from)));
+    };
+
+    const char* pa = next(a, 0);
+    const char* pb = a != b ? next(b, 0) : nullptr;
+
+    while(pa || pb) {
+        const char* c = (pa && (!pb || pa < pb)) ? pa : pb;
+        if(matchText(c, text))
+            return static_cast<int>(c - p);
+
+        if(c == pa)
+            pa = next(a, static_cast<int>(c - p) + 1);
+        if(c == pb)
+            pb = next(b, static_cast<int>(c - p) + 1);
+    }
+
+    return -1;
+}
+
+// The search index folds ASCII letters only
+bool isAsciiFolded(const FoldedText& text) {
+    for(int i = 0; i < text.lower.size(); i++) {
+        uchar lo = text.lower.at(i), up = text.upper.at(i);
+        bool letter = lo >= 'a' && lo <= 'z';
+
+        if(letter ? up != lo - 32 : (lo != up || (lo >= 'A' && lo <= 'Z')))
+            return false;
+    }
+
+    return true;
+}
+
+qint64 findText(const FoldedText& text, qint64 from, qint64 to,
+                const QHexDocument* hexdocument, bool backward) {
+    // Matches starting in [from, to]
+    qint64 m = text.lower.size();
+    to = qMin(to, hexdocument->length() - m);
+
+    // Patterns with non-zero bytes cannot match inside holes
+    bool skipholes = text.lower.count('\0') != text.lower.size() ||
+                     text.upper.count('\0') != text.upper.size();
+
+    while(from <= to) {
+        qint64 pos = backward ? to : from, holebegin, holeend;
+
+        if(skipholes && hexdocument->holeAt(pos, holebegin, holeend) &&
+           pos + m <= holeend) {
+            if(backward)
+                to = holebegin - 1;
+            else
+                from = holeend - m + 1;
+            continue;
+        }
+
+        qint64 count = qMin<qint64>(SEARCH_CHUNK, to - from + 1);
+        qint64 begin = backward ? to - count + 1 : from;
+        QByteArray data = hexdocument->read(
+            begin, static_cast<int>(count + m - 1));
+
+        if(data.size() < count + m - 1)
+            break;
+
+        int idx = indexOfText(data, static_cast<int>(count), text, backward);
+        if(idx != -1)
+            return begin + idx;
+
+        if(backward)
+            to = begin - 1;
+        else
+            from = begin + count;
+    }
+
+    return -1;
+}
+
+qint64 findDefault(const FoldedText& text, qint64 startoffset,
+                   const QHexView* hexview, QHexFindDirection fd) {
     QHexDocument* hexdocument = hexview->hexDocument();
-    if(value.size() > hexdocument->length())
+    if(text.lower.size() > hexdocument->length())
         return -1;
 
-    return QHexUtils::findIter(
-        startoffset, fd, hexview,
-        [options, value, hexdocument](qint64 idx, qint64& offset) -> bool {
-            for(auto i = 0; i < value.size(); i++) {
-                qint64 curroffset = idx + i;
+    // Jump straight to candidate blocks when an index is available
+    QHexSearchIndex* index = hexdocument->searchIndex();
+    bool cs = text.lower == text.upper;
 
-                if(curroffset >= hexdocument->length()) {
-                    offset = -1;
-                    return false;
-                }
+    if(index && index->canSearch(text.lower) &&
+       (cs || QHexUtils::isAsciiFolded(text))) {
+        if(fd == QHexFindDirection::Backward)
+            return index->lastIndexOf(text.lower, startoffset, cs);
 
-                uchar ch1 = hexdocument->at(curroffset);
-                uchar ch2 = value.at(i);
+        qint64 offset = index->indexOf(text.lower, startoffset, cs);
+        if(offset == -1 && fd == QHexFindDirection::All)
+            offset = index->indexOf(text.lower, 0, cs);
+        return offset;
+    }
 
-                if(!(options & QHexFindOptions::CaseSensitive)) {
-                    ch1 = std::tolower(ch1);
-                    ch2 = std::tolower(ch2);
-                }
+    qint64 length = hexdocument->length();
 
-                if(ch1 != ch2)
-                    break;
-                if(i == value.size() - 1)
-                    offset = idx;
-            }
+    if(fd == QHexFindDirection::Backward)
+        return QHexUtils::findText(text, 0, startoffset, hexdocument, true);
+
+    qint64 offset =
+        QHexUtils::findText(text, startoffset, length, hexdocument, false);
 
-            return true;
-        });
+    if(offset == -1 && fd == QHexFindDirection::All) {
+        offset = QHexUtils::findText(text, 0, startoffset - 1, hexdocument,
+                                     false);
+    }
+
+    return offset;
 }
 
 qint64 findWildcard(QString pattern, qint64 startoffset,
                     const QHexView* hexview, QHexFindDirection fd,
                     qint64& matchlen) {
     QHexDocument* hexdocument = hexview->hexDocument();
+
+    // Forward goes through the same scanner as findAll()
+    if(fd != QHexFindDirection::Backward) {
+        QHexPatternSet patterns;
+        patterns.addPattern(pattern);
+
+        QHexPatternMatches m =
+            patterns.findAll(hexdocument, startoffset, -1, 1);
+        if(m.isEmpty() && fd == QHexFindDirection::All)
+            m = patterns.findAll(hexdocument, 0, -1, 1);
+        if(m.isEmpty())
+            return -1;
+
+        matchlen = m.first().length;
+        return m.first().offset;
+    }
+
     QHexPattern p = PatternUtils::compile(pattern);
 
     return findIter(startoffset, fd, hexview,
@@ -229,19 +506,51 @@ qint64 findWildcard(QString pattern, qint64 startoffset,
                     });
 }
 
+// QHexRegex, QHexFuzzy and QHexValueRange
+template<typename Matcher>
+QPair<qint64, qint64> findMatch(const Matcher& matcher, qint64 startoffset,
+                                const QHexView* hexview,
+                                QHexFindDirection fd) {
+    const QHexDocument* hexdocument = hexview->hexDocument();
+
+    if(fd == QHexFindDirection::Backward)
+        return matcher.matchBackward(hexdocument, startoffset);
+
+    auto res = matcher.match(hexdocument, startoffset);
+    if(res.first == -1 && fd == QHexFindDirection::All)
+        res = matcher.match(hexdocument, 0);
+    return res;
+}
+
+QHexFuzzy variantToFuzzy(QVariant value, unsigned int options) {
+    int distance = QHexFindOptions::distanceOf(options);
+    QHexFuzzy::Metric metric = (options & QHexFindOptions::Levenshtein)
+                                   ? QHexFuzzy::Metric::Levenshtein
+                                   : QHexFuzzy::Metric::Hamming;
+
+    if(QHEXVIEW_VARIANT_EQ(value, String))
+        return QHexFuzzy{value.toString(), distance, metric};
+    return QHexFuzzy{value.toByteArray(), distance, metric};
+}
+
 QByteArray variantToByteArray(QVariant value, QHexFindMode mode,
                               unsigned int options) {
     QByteArray v;
 
     switch(mode) {
         case QHexFindMode::Text:
-            if(QHEXVIEW_VARIANT_EQ(value, String))
-                v = value.toString().toUtf8();
+        case QHexFindMode::Regex: // Replacements are plain text
+            if(QHEXVIEW_VARIANT_EQ(value, String)) {
+                FoldedText text;
+                if(encodeText(value.toString(), options, false, text))
+                    v = text.lower;
+            }
             else if(QHEXVIEW_VARIANT_EQ(value, ByteArray))
                 v = value.toByteArray();
             break;
 
-        case QHexFindMode::Hex: {
+        case QHexFindMode::Hex:
+        case QHexFindMode::Fuzzy: { // Replacements are hex bytes
             if(QHEXVIEW_VARIANT_EQ(value, String)) {
                 qint64 len = 0;
                 auto s = value.toString();
@@ -323,16 +632,76 @@ QByteArray variantToByteArray(QVariant value, QHexFindMode mode,
     return v;
 }
 
+bool variantToText(QVariant value, QHexFindMode mode, unsigned int options,
+                   FoldedText& text) {
+    if(mode == QHexFindMode::Text && QHEXVIEW_VARIANT_EQ(value, String) &&
+       !(options & QHexFindOptions::CaseSensitive))
+        return encodeText(value.toString(), options, true, text);
+
+    if(mode == QHexFindMode::Text && QHEXVIEW_VARIANT_EQ(value, ByteArray) &&
+       !(options & QHexFindOptions::CaseSensitive))
+        text = asciiFoldedText(value.toByteArray());
+    else
+        text = exactText(variantToByteArray(value, mode, options));
+    return !text.lower.isEmpty();
+}
+
 } // namespace
 
-QByteArray toHex(quint8 b) {
-    QByteArray hex(2, Qt::Uninitialized);
-    hex[0] = HEXMAP->at((b & 0xf0) >> 4);
-    hex[1] = HEXMAP->at(b & 0x0f);
-    return hex;
+const char* hexDigits(quint8 b, bool upper) {
+    return (upper ? HEXTABLE.upper : HEXTABLE.lower) + (b * 2);
 }
 
-QByteArray toHex(const QByteArray& ba, char sep) {
+QByteArray toHex(quint8 b) { return QByteArray(QHexUtils::hexDigits(b), 2); }
+
+qint64 toHex(const char* data, qint64 len, char* out, char sep, bool upper) {
+    const char* table = upper ? HEXTABLE.upper : HEXTABLE.lower;
+    char* p = out;
+    qint64 i = 0;
+
+#if defined(QHEXVIEW_HEX_SSE2)
+    if(!sep) {
+        // Map each nibble to '0' + n, plus the distance to 'a'/'A' above 9
+        const __m128i MASK = _mm_set1_epi8(0x0f);
+        const __m128i NINE = _mm_set1_epi8(9);
+        const __m128i ZERO = _mm_set1_epi8('0');
+        const __m128i ALPHA = _mm_set1_epi8(upper ? 'A' - '0' - 10
+                                                  : 'a' - '0' - 10);
+
+        for(; i + 16 <= len; i += 16, p += 32) {
+            __m128i v = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(data + i));
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), MASK);
+            __m128i lo = _mm_and_si128(v, MASK);
+
+            hi = _mm_add_epi8(
+                _mm_add_epi8(hi, ZERO),
+                _mm_and_si128(_mm_cmpgt_epi8(hi, NINE), ALPHA));
+            lo = _mm_add_epi8(
+                _mm_add_epi8(lo, ZERO),
+                _mm_and_si128(_mm_cmpgt_epi8(lo, NINE), ALPHA));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                             _mm_unpacklo_epi8(hi, lo));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(p + 16),
+                             _mm_unpackhi_epi8(hi, lo));
+        }
+    }
+#endif
+
+    for(; i < len; i++) {
+        if(sep && i)
+            *p++ = sep;
+
+        const char* d = table + (static_cast<quint8>(data[i]) * 2);
+        *p++ = d[0];
+        *p++ = d[1];
+    }
+
+    return p - out;
+}
+
+QByteArray toHex(const QByteArray& ba, char sep, bool upper) {
     if(ba.isEmpty()) {
         return QByteArray();
     }
@@ -340,14 +709,82 @@ QByteArray toHex(const QByteArray& ba, char sep) {
     QByteArray hex(sep ? (ba.size() * 3 - 1) : (ba.size() * 2),
                    Qt::Uninitialized);
 
-    for(auto i = 0, o = 0; i < ba.size(); i++) {
-        if(sep && i)
-            hex[o++] = static_cast<uchar>(sep);
-        hex[o++] = HEXMAP->at((ba.at(i) & 0xf0) >> 4);
-        hex[o++] = HEXMAP->at(ba.at(i) & 0x0f);
+    QHexUtils::toHex(ba.constData(), ba.size(), hex.data(), sep, upper);
+    return hex;
+}
+
+QByteArray fromHex(const QByteArray& hex) {
+    // Same rules as QByteArray::fromHex(): invalid characters are skipped and
+    // digits pair up from the end, so the input is decoded backwards
+    QByteArray res((hex.size() + 1) / 2, Qt::Uninitialized);
+    const char* in = hex.constData();
+    char* begin = res.data();
+    char* out = begin + res.size();
+    qint64 i = hex.size();
+    bool odd = false;
+
+    while(i > 0) {
+#if defined(QHEXVIEW_HEX_SSE2)
+        if(!odd && i >= 32) {
+            const __m128i CASE = _mm_set1_epi8(0x20);
+            const __m128i D0 = _mm_set1_epi8('0' - 1);
+            const __m128i D9 = _mm_set1_epi8('9' + 1);
+            const __m128i AA = _mm_set1_epi8('a' - 1);
+            const __m128i AF = _mm_set1_epi8('f' + 1);
+            const __m128i ZERO = _mm_set1_epi8('0');
+            const __m128i ALPHA = _mm_set1_epi8('a' - 10);
+            const __m128i LOW = _mm_set1_epi16(0x00ff);
+
+            __m128i v[2], valid = _mm_set1_epi8(-1);
+
+            for(int k = 0; k < 2; k++) {
+                __m128i c = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(in + i - 32 + k * 16));
+                __m128i l = _mm_or_si128(c, CASE);
+                __m128i isdigit = _mm_and_si128(_mm_cmpgt_epi8(c, D0),
+                                                _mm_cmplt_epi8(c, D9));
+                __m128i isalpha = _mm_and_si128(_mm_cmpgt_epi8(l, AA),
+                                                _mm_cmplt_epi8(l, AF));
+
+                valid = _mm_and_si128(valid, _mm_or_si128(isdigit, isalpha));
+                v[k] = _mm_or_si128(
+                    _mm_and_si128(isdigit, _mm_sub_epi8(c, ZERO)),
+                    _mm_andnot_si128(isdigit, _mm_sub_epi8(l, ALPHA)));
+            }
+
+            if(_mm_movemask_epi8(valid) == 0xffff) {
+                // Even chars are high nibbles, odd chars are low nibbles
+                for(int k = 0; k < 2; k++) {
+                    v[k] = _mm_or_si128(
+                        _mm_slli_epi16(_mm_and_si128(v[k], LOW), 4),
+                        _mm_srli_epi16(v[k], 8));
+                }
+
+                out -= 16;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out),
+                                 _mm_packus_epi16(v[0], v[1]));
+                i -= 32;
+                continue;
+            }
+        }
+#endif
+
+        int d = HEXTABLE.digit[static_cast<quint8>(in[--i])];
+        if(d < 0)
+            continue;
+
+        if(odd) {
+            *out = static_cast<char>(*out | (d << 4));
+            odd = false;
+        }
+        else {
+            *--out = static_cast<char>(d);
+            odd = true;
+        }
     }
 
-    return hex;
+    res.remove(0, static_cast<int>(out - begin));
+    return res;
 }
 
 QByteArray toHex(const QByteArray& ba) { return QHexUtils::toHex(ba, '\0'); }
@@ -376,6 +813,10 @@ bool checkPattern(const QString& s) {
     return !PatternUtils::compile(s).isEmpty();
 }
 
+QHexPattern compilePattern(const QString& s) {
+    return PatternUtils::compile(s);
+}
+
 QPair<qint64, qint64> find(const QHexView* hexview, QVariant value,
                            qint64 startoffset, QHexFindMode mode,
                            unsigned int options, QHexFindDirection fd) {
@@ -383,25 +824,134 @@ QPair<qint64, qint64> find(const QHexView* hexview, QVariant value,
     if(startoffset == -1)
         startoffset = static_cast<qint64>(hexview->offset());
 
+#if defined(QHEXVIEW_PROFILE)
+    QHexProfiler* profiler = hexview->hexDocument()->profiler();
+    QHEXVIEW_PROFILE_SCOPE(profiler, "find", SearchTime);
+#endif
+
     if(mode == QHexFindMode::Hex && QHEXVIEW_VARIANT_EQ(value, String)) {
         offset = QHexUtils::findWildcard(value.toString(), startoffset, hexview,
                                          fd, size);
     }
+    else if(mode == QHexFindMode::Regex || mode == QHexFindMode::Fuzzy ||
+            mode == QHexFindMode::Range) {
+        QPair<qint64, qint64> res;
+
+        if(mode == QHexFindMode::Regex) {
+            bool cs = options & QHexFindOptions::CaseSensitive;
+            res = QHexUtils::findMatch(QHexRegex{value.toString(), cs},
+                                       startoffset, hexview, fd);
+        }
+        else if(mode == QHexFindMode::Fuzzy) {
+            res = QHexUtils::findMatch(
+                QHexUtils::variantToFuzzy(value, options), startoffset,
+                hexview, fd);
+        }
+        else {
+            res = QHexUtils::findMatch(
+                QHexValueRange{value.toString(), options}, startoffset,
+                hexview, fd);
+        }
+
+        offset = res.first;
+        size = res.second;
+    }
     else {
-        auto ba = variantToByteArray(value, mode, options);
+        FoldedText text;
 
-        if(!ba.isEmpty()) {
-            offset =
-                QHexUtils::findDefault(ba, startoffset, hexview, options, fd);
-            size = ba.size();
+        if(QHexUtils::variantToText(value, mode, options, text)) {
+            offset = QHexUtils::findDefault(text, startoffset, hexview, fd);
+            size = text.lower.size();
         }
         else
             offset = -1;
     }
 
+#if defined(QHEXVIEW_PROFILE)
+    // Approximated by the distance walked by the search
+    qint64 length = hexview->hexDocument()->length();
+    qint64 searched = length;
+
+    if(fd == QHexFindDirection::Forward)
+        searched = (offset != -1 ? offset : length) - startoffset;
+    else if(fd == QHexFindDirection::Backward)
+        searched = startoffset - qMax<qint64>(offset, 0);
+
+    QHEXVIEW_PROFILE_COUNT(profiler, Searches, 1);
+    QHEXVIEW_PROFILE_COUNT(profiler, BytesSearched, qMax<qint64>(searched, 0));
+#endif
+
     return {offset, offset > -1 ? size : 0};
 }
 
+QList<QPair<qint64, qint64>> findAll(const QHexView* hexview, QVariant value,
+                                     QHexFindMode mode, unsigned int options,
+                                     int limit) {
+    QList<QPair<qint64, qint64>> res;
+    QHexDocument* hexdocument = hexview->hexDocument();
+    bool cs = options & QHexFindOptions::CaseSensitive;
+
+    if(mode == QHexFindMode::Regex)
+        return QHexRegex{value.toString(), cs}.findAll(hexdocument, 0, -1,
+                                                       limit);
+
+    if(mode == QHexFindMode::Fuzzy) {
+        return QHexUtils::variantToFuzzy(value, options)
+            .findAll(hexdocument, 0, -1, limit);
+    }
+
+    if(mode == QHexFindMode::Range) {
+        return QHexValueRange{value.toString(), options}.findAll(
+            hexdocument, 0, -1, limit);
+    }
+
+    if(mode == QHexFindMode::Hex && QHEXVIEW_VARIANT_EQ(value, String)) {
+        QHexPatternSet patterns;
+        patterns.addPattern(value.toString());
+
+        // Hits overlap, take them in batches and drop the overlapping ones
+        for(qint64 from = 0, end = 0; limit < 0 || res.size() < limit;) {
+            int n = limit < 0 ? PATTERN_BATCH : limit - res.size();
+            QHexPatternMatches hits =
+                patterns.findAll(hexdocument, from, -1, n);
+
+            for(const QHexPatternMatch& m : hits) {
+                if(m.offset < end)
+                    continue;
+
+                res.append({m.offset, m.length});
+                end = m.offset + m.length;
+
+                if(limit >= 0 && res.size() >= limit)
+                    break;
+            }
+
+            if(hits.size() < n)
+                break;
+
+            from = hits.last().offset + 1;
+        }
+
+        return res;
+    }
+
+    FoldedText text;
+    if(!QHexUtils::variantToText(value, mode, options, text))
+        return res;
+
+    for(qint64 offset = 0; limit < 0 || res.size() < limit;) {
+        offset = QHexUtils::findDefault(text, offset, hexview,
+                                        QHexFindDirection::Forward);
+        if(offset == -1)
+            break;
+
+        res.append({offset, text.lower.size()});
+        offset += text.lower.size();
+    }
+
+    return res;
+}
+
 QPair<qint64, qint64> replace(const QHexView* hexview, QVariant oldvalue,
                               QVariant newvalue, qint64 startoffset,
                               QHexFindMode mode, unsigned int options,
@@ -413,9 +963,8 @@ QPair<qint64, qint64> replace(const QHexView* hexview, QVariant oldvalue,
         QHexDocument* hexdocument = hexview->hexDocument();
         auto ba = variantToByteArray(newvalue, mode, options);
 
-        if(!ba.isEmpty()) {
-            hexdocument->remove(res.first, res.second);
-            hexdocument->insert(res.first, ba);
+        if(!ba.isEmpty()) { // One undo step
+            hexdocument->replaceAll({res}, ba);
             res.second = ba.size();
         }
         else {
@@ -427,4 +976,15 @@ QPair<qint64, qint64> replace(const QHexView* hexview, QVariant oldvalue,
     return res;
 }
 
+int replaceAll(const QHexView* hexview, QVariant oldvalue, QVariant newvalue,
+               QHexFindMode mode, unsigned int options) {
+    auto ba = variantToByteArray(newvalue, mode, options);
+    if(ba.isEmpty())
+        return 0;
+
+    auto matches = QHexUtils::findAll(hexview, oldvalue, mode, options);
+    hexview->hexDocument()->replaceAll(matches, ba);
+    return matches.size();
+}
+
 } // namespace QHexUtils
@@ -0,0 +1,493 @@
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexutils.h>
+#include <QHexView/model/qhexvaluerange.h>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const int CHUNK_SIZE = 1 << 20;
+const qint64 BLOCK_SIZE = 64;
+
+// Sign and magnitude, wide enough for both qint64 and quint64 bounds
+struct Integer {
+    bool negative;
+    quint64 magnitude;
+};
+
+struct Bound {
+    bool integer; // Integer literal, 'i' is exact
+    Integer i;
+    double d;
+};
+
+int compare(const Integer& a, const Integer& b) {
+    if(a.negative != b.negative)
+        return a.negative ? -1 : 1;
+    if(a.magnitude == b.magnitude)
+        return 0;
+    return (a.magnitude < b.magnitude) != a.negative ? -1 : 1;
+}
+
+Integer make_integer(bool negative, quint64 magnitude) {
+    return {negative && magnitude, magnitude};
+}
+
+// Saturated at +/-(2^64 - 1)
+Integer add(const Integer& a, const Integer& b) {
+    if(a.negative == b.negative) {
+        quint64 m = a.magnitude + b.magnitude;
+        if(m < a.magnitude)
+            m = std::numeric_limits<quint64>::max();
+        return make_integer(a.negative, m);
+    }
+
+    if(a.magnitude >= b.magnitude)
+        return make_integer(a.negative, a.magnitude - b.magnitude);
+    return make_integer(b.negative, b.magnitude - a.magnitude);
+}
+
+quint64 to_bits(const Integer& i) {
+    return i.negative ? quint64{0} - i.magnitude : i.magnitude;
+}
+
+double to_double(const Integer& i) {
+    double d = static_cast<double>(i.magnitude);
+    return i.negative ? -d : d;
+}
+
+bool parse_bound(const QString& s, Bound& b) {
+    QString t = s.trimmed();
+    bool negative = t.startsWith(QLatin1Char('-'));
+    QString digits =
+        (negative || t.startsWith(QLatin1Char('+'))) ? t.mid(1) : t;
+    bool hex = digits.startsWith(QLatin1String("0x"), Qt::CaseInsensitive);
+    bool ok = false;
+
+    if(hex)
+        digits = digits.mid(2);
+
+    if(!digits.isEmpty() && digits.at(0).isLetterOrNumber()) {
+        quint64 m = digits.toULongLong(&ok, hex ? 16 : 10);
+
+        if(ok) {
+            b.integer = true;
+            b.i = make_integer(negative, m);
+            b.d = to_double(b.i);
+            return true;
+        }
+    }
+
+    b.integer = false;
+    b.d = t.toDouble(&ok);
+    return ok && !hex && !std::isnan(b.d);
+}
+
+// Closest integer inside the range, false if every 64 bit value is out
+bool integer_bound(const Bound& b, bool lower, Integer& i) {
+    static const double LIMIT = 18446744073709551616.0; // 2^64
+
+    if(b.integer) {
+        i = b.i;
+        return true;
+    }
+
+    double v = lower ? std::ceil(b.d) : std::floor(b.d);
+    if(lower ? v >= LIMIT : v <= -LIMIT)
+        return false;
+
+    double m = std::fabs(v);
+    i = make_integer(v < 0, m >= LIMIT ? std::numeric_limits<quint64>::max()
+                                       : static_cast<quint64>(m));
+    return true;
+}
+
+// Nearest float, values out of its range keep their side of the bound
+double float_bound(double d, bool lower) {
+    const double MAX = std::numeric_limits<float>::max();
+    const double INF = std::numeric_limits<float>::infinity();
+
+    if(d > MAX)
+        return lower ? INF : MAX;
+    if(d < -MAX)
+        return lower ? -MAX : -INF;
+    return static_cast<float>(d);
+}
+
+template<typename U>
+struct IntTest {
+    const uchar* data;
+    bool swap;
+    quint64 sign, lo, span;
+
+    inline bool operator()(qint64 i) const {
+        U v;
+        std::memcpy(&v, data + i, sizeof(U));
+        quint64 u = swap ? qbswap(v) : v;
+        return ((u ^ sign) - sign - lo) <= span;
+    }
+};
+
+template<typename U, typename F>
+struct FloatTest {
+    const uchar* data;
+    bool swap;
+    F lo, hi;
+
+    inline bool operator()(qint64 i) const {
+        U v;
+        F f;
+        std::memcpy(&v, data + i, sizeof(U));
+        if(swap)
+            v = qbswap(v);
+        std::memcpy(&f, &v, sizeof(F));
+        return f >= lo && f <= hi; // NaN never matches
+    }
+};
+
+// Blocks are tested without early exit, so the compiler can vectorize the
+// loop, and scanned again only when something matched
+template<typename Test>
+qint64 find_hit(const Test& test, qint64 i, qint64 end, qint64 step,
+                bool backward) {
+    const qint64 BLOCK = BLOCK_SIZE * step;
+
+    if(backward) { // From i down to end
+        for(; i >= end; i -= BLOCK) {
+            qint64 stop = qMax(end, i - BLOCK + 1);
+            bool any = false;
+
+            for(qint64 j = i; j >= stop; j -= step)
+                any |= test(j);
+
+            for(qint64 j = i; any; j -= step) {
+                if(test(j))
+                    return j;
+            }
+        }
+    }
+    else { // From i up to end (excluded)
+        for(; i < end; i += BLOCK) {
+            qint64 stop = qMin(end, i + BLOCK);
+            bool any = false;
+
+            for(qint64 j = i; j < stop; j += step)
+                any |= test(j);
+
+            for(qint64 j = i; any; j += step) {
+                if(test(j))
+                    return j;
+            }
+        }
+    }
+
+    return -1;
+}
+
+} // namespace
+
+QHexValueRange::QHexValueRange(const QString& range, unsigned int options)
+    : m_aligned{static_cast<bool>(options & QHexFindOptions::Aligned)} {
+    Bound lo, hi;
+    int sep = range.indexOf(QLatin1String(".."));
+
+    if(sep != -1) {
+        if(!parse_bound(range.left(sep), lo) ||
+           !parse_bound(range.mid(sep + 2), hi)) {
+            m_error = QStringLiteral("Invalid bounds");
+            return;
+        }
+    }
+    else if((sep = range.indexOf(QLatin1Char('~'))) != -1) {
+        Bound value, tolerance;
+
+        if(!parse_bound(range.left(sep), value) ||
+           !parse_bound(range.mid(sep + 1), tolerance) || tolerance.d < 0) {
+            m_error = QStringLiteral("Invalid value or tolerance");
+            return;
+        }
+
+        lo.integer = hi.integer = value.integer && tolerance.integer;
+
+        if(lo.integer) {
+            lo.i = add(value.i, make_integer(true, tolerance.i.magnitude));
+            hi.i = add(value.i, tolerance.i);
+            lo.d = to_double(lo.i);
+            hi.d = to_double(hi.i);
+        }
+        else {
+            lo.d = value.d - tolerance.d;
+            hi.d = value.d + tolerance.d;
+        }
+    }
+    else if(!parse_bound(range, lo)) {
+        m_error = QStringLiteral("Invalid value");
+        return;
+    }
+    else
+        hi = lo;
+
+    if(lo.integer && hi.integer ? compare(lo.i, hi.i) > 0 : lo.d > hi.d) {
+        m_error = QStringLiteral("The lower bound is greater than the upper");
+        return;
+    }
+
+    static const unsigned int INT_TYPES =
+        QHexFindOptions::Int8 | QHexFindOptions::Int16 |
+        QHexFindOptions::Int32 | QHexFindOptions::Int64;
+    static const unsigned int FLOAT_TYPES =
+        QHexFindOptions::Float | QHexFindOptions::Double;
+
+    unsigned int types = options & (INT_TYPES | FLOAT_TYPES);
+    if(!types)
+        types = lo.integer && hi.integer ? INT_TYPES : FLOAT_TYPES;
+
+    bool big = options & QHexFindOptions::BigEndian;
+    bool little = !big || (options & QHexFindOptions::LittleEndian);
+    bool issigned = (options & QHexFindOptions::Signed) ||
+                    (lo.integer ? lo.i.negative : lo.d < 0);
+
+    Integer ilo, ihi;
+    bool integers = integer_bound(lo, true, ilo) &&
+                    integer_bound(hi, false, ihi) && compare(ilo, ihi) <= 0;
+
+    static const struct {
+        unsigned int type;
+        int width;
+    } TYPES[] = {
+        {QHexFindOptions::Int64, 8}, {QHexFindOptions::Double, 8},
+        {QHexFindOptions::Int32, 4}, {QHexFindOptions::Float, 4},
+        {QHexFindOptions::Int16, 2}, {QHexFindOptions::Int8, 1},
+    };
+
+    for(const auto& t : TYPES) {
+        if(!(types & t.type))
+            continue;
+
+        Probe p{};
+        p.width = t.width;
+        p.floating = t.type & FLOAT_TYPES;
+
+        if(p.floating) {
+            bool f = t.type == QHexFindOptions::Float;
+            p.dlo = f ? float_bound(lo.d, true) : lo.d;
+            p.dhi = f ? float_bound(hi.d, false) : hi.d;
+        }
+        else {
+            if(!integers)
+                continue;
+
+            int bits = t.width * 8;
+            quint64 top = quint64{1} << (bits - 1); // Sign bit
+            Integer min = make_integer(issigned, issigned ? top : 0);
+            Integer max = make_integer(false, issigned ? top - 1
+                                                       : top + (top - 1));
+            Integer a = compare(ilo, min) < 0 ? min : ilo;
+            Integer b = compare(ihi, max) > 0 ? max : ihi;
+
+            if(compare(a, b) > 0)
+                continue;
+
+            p.sign = issigned && bits < 64 ? top : 0;
+            p.lo = to_bits(a);
+            p.span = to_bits(b) - p.lo;
+        }
+
+        for(int e = 0; e < 2; e++) {
+            bool bigendian = e == 1;
+            if(!(bigendian ? big : little) || (bigendian && t.width == 1 &&
+                                                little))
+                continue;
+
+            p.type = t.type | (bigendian ? QHexFindOptions::BigEndian : 0) |
+                     (!p.floating && issigned ? QHexFindOptions::Signed : 0);
+            p.swap = t.width > 1 &&
+                     bigendian != (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+            m_probes.append(p);
+        }
+
+        m_maxwidth = qMax(m_maxwidth, t.width);
+    }
+
+    if(m_probes.isEmpty())
+        m_error = QStringLiteral("No value of the selected types is in range");
+}
+
+bool QHexValueRange::isValid() const { return !m_probes.isEmpty(); }
+QString QHexValueRange::errorString() const { return m_error; }
+
+QPair<qint64, qint64> QHexValueRange::match(const QHexDocument* document,
+                                            qint64 from, qint64 to,
+                                            unsigned int* type) const {
+    if(!this->isValid() || !document)
+        return {-1, 0};
+
+    qint64 length = document->length();
+    if(to < 0 || to > length)
+        to = length;
+
+    int index = -1;
+    qint64 offset =
+        this->scanForward(document, qMax<qint64>(from, 0), to, index);
+    if(offset == -1)
+        return {-1, 0};
+
+    if(type)
+        *type = m_probes.at(index).type;
+
+    return {offset, m_probes.at(index).width};
+}
+
+QPair<qint64, qint64>
+QHexValueRange::matchBackward(const QHexDocument* document, qint64 from,
+                              unsigned int* type) const {
+    if(!this->isValid() || !document)
+        return {-1, 0};
+
+    int index = -1;
+    qint64 offset = this->scanBackward(document, from, index);
+    if(offset == -1)
+        return {-1, 0};
+
+    if(type)
+        *type = m_probes.at(index).type;
+
+    return {offset, m_probes.at(index).width};
+}
+
+QList<QPair<qint64, qint64>>
+QHexValueRange::findAll(const QHexDocument* document, qint64 from,
+                        qint64 length, int limit) const {
+    QList<QPair<qint64, qint64>> res;
+    if(!this->isValid() || !document)
+        return res;
+
+    qint64 to = length >= 0 ? from + length : -1;
+
+    while(limit < 0 || res.size() < limit) {
+        QPair<qint64, qint64> m = this->match(document, from, to);
+        if(m.first == -1)
+            break;
+
+        res.append(m);
+        from = m.first + m.second;
+    }
+
+    return res;
+}
+
+qint64 QHexValueRange::scanForward(const QHexDocument* document, qint64 from,
+                                   qint64 to, int& index) const {
+    for(qint64 pos = from; pos < to; pos += CHUNK_SIZE) {
+        // Values starting in this chunk may end in the next one
+        qint64 n = qMin<qint64>(CHUNK_SIZE, to - pos);
+        qint64 avail = qMin<qint64>(n + m_maxwidth - 1, to - pos);
+        QByteArray chunk = document->read(pos, static_cast<int>(avail));
+        const uchar* data = reinterpret_cast<const uchar*>(chunk.constData());
+        qint64 best = -1;
+
+        if(chunk.size() != avail)
+            break;
+
+        for(int k = 0; k < m_probes.size(); k++) {
+            const Probe& p = m_probes.at(k);
+            qint64 end = qMin(n, avail - p.width + 1);
+            qint64 i = m_aligned ? (p.width - pos % p.width) % p.width : 0;
+
+            if(best != -1) // Ties go to the wider type
+                end = qMin(end, best);
+
+            i = this->probe(p, data, i, end, false);
+
+            if(i != -1) {
+                best = i;
+                index = k;
+            }
+        }
+
+        if(best != -1)
+            return pos + best;
+    }
+
+    return -1;
+}
+
+qint64 QHexValueRange::scanBackward(const QHexDocument* document,
+                                    qint64 from, int& index) const {
+    qint64 length = document->length();
+
+    for(qint64 end = qMin(from + 1, length); end > 0;) {
+        qint64 begin = qMax<qint64>(0, end - CHUNK_SIZE);
+        qint64 avail = qMin<qint64>(length, end + m_maxwidth - 1) - begin;
+        QByteArray chunk = document->read(begin, static_cast<int>(avail));
+        const uchar* data = reinterpret_cast<const uchar*>(chunk.constData());
+        qint64 best = -1;
+
+        if(chunk.size() != avail)
+            break;
+
+        for(int k = 0; k < m_probes.size(); k++) {
+            const Probe& p = m_probes.at(k);
+            qint64 i = qMin(end - begin, avail - p.width + 1) - 1;
+
+            if(m_aligned && i >= 0)
+                i -= (begin + i) % p.width;
+
+            i = this->probe(p, data, i, best + 1, true);
+
+            if(i != -1) {
+                best = i;
+                index = k;
+            }
+        }
+
+        if(best != -1)
+            return begin + best;
+
+        end = begin;
+    }
+
+    return -1;
+}
+
+qint64 QHexValueRange::probe(const Probe& p, const uchar* data, qint64 i,
+                             qint64 end, bool backward) const {
+    qint64 step = m_aligned ? p.width : 1;
+
+    switch(p.width) {
+        case 1:
+            return find_hit(IntTest<quint8>{data, false, p.sign, p.lo, p.span},
+                            i, end, step, backward);
+
+        case 2:
+            return find_hit(
+                IntTest<quint16>{data, p.swap, p.sign, p.lo, p.span}, i, end,
+                step, backward);
+
+        case 4:
+            if(p.floating) {
+                return find_hit(
+                    FloatTest<quint32, float>{data, p.swap,
+                                              static_cast<float>(p.dlo),
+                                              static_cast<float>(p.dhi)},
+                    i, end, step, backward);
+            }
+
+            return find_hit(
+                IntTest<quint32>{data, p.swap, p.sign, p.lo, p.span}, i, end,
+                step, backward);
+
+        default: break;
+    }
+
+    if(p.floating) {
+        return find_hit(
+            FloatTest<quint64, double>{data, p.swap, p.dlo, p.dhi}, i, end,
+            step, backward);
+    }
+
+    return find_hit(IntTest<quint64>{data, p.swap, p.sign, p.lo, p.span}, i,
+                    end, step, backward);
+}
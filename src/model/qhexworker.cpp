@@ -0,0 +1,136 @@
+#include <QHexView/model/buffer/qhexbuffer.h>
+#include <QHexView/model/qhexdocument.h>
+#include <QHexView/model/qhexworker.h>
+#include <QWaitCondition>
+
+// Filled on the thread owning the document, whatever comes back after the
+// worker gave up is released with the request
+struct QHexWorkerRequest {
+    QMutex mutex;
+    QWaitCondition cond;
+    QByteArray data;
+    QHexBuffer* reader{nullptr};
+    bool done{false};
+
+    ~QHexWorkerRequest() { delete reader; }
+};
+
+QHexWorker::QHexWorker(QObject* parent): QThread{parent} {
+    // Readers are used and released on the worker thread
+    connect(
+        this, &QThread::finished, this, [this]() { this->releaseReaders(); },
+        Qt::DirectConnection);
+}
+
+QHexWorker::~QHexWorker() { this->cancel(); }
+
+void QHexWorker::cancel() {
+    this->requestInterruption();
+
+    {
+        // Don't leave it waiting for the owner thread, which may be us
+        QMutexLocker locker(&m_requestmutex);
+
+        if(m_request) {
+            QMutexLocker reqlocker(&m_request->mutex);
+            m_request->cond.wakeAll();
+        }
+    }
+
+    this->wait();
+    this->releaseReaders();
+}
+
+bool QHexWorker::isCancelled() const {
+    return this->isInterruptionRequested();
+}
+
+QByteArray QHexWorker::read(const QHexDocument* document, qint64 offset,
+                            int len) {
+    if(QThread::currentThread() == document->thread())
+        return document->read(offset, len);
+
+    // Disk reads and decompression stay on this thread when possible
+    QHexBuffer* r = this->reader(document);
+    if(r)
+        return r->read(offset, len);
+
+    auto req = std::make_shared<QHexWorkerRequest>();
+
+    QMetaObject::invokeMethod(
+        const_cast<QHexDocument*>(document),
+        [req, document, offset, len]() {
+            // Deep copy: the result may point into a mapping owned by the
+            // buffer, which can go away while the worker is using it
+            QByteArray data = document->read(offset, len);
+            data.detach();
+
+            QMutexLocker locker(&req->mutex);
+            req->data = data;
+            req->done = true;
+            req->cond.wakeAll();
+        },
+        Qt::QueuedConnection);
+
+    return this->waitFor(req) ? req->data : QByteArray{};
+}
+
+QHexBuffer* QHexWorker::reader(const QHexDocument* document) {
+    auto it = m_readers.constFind(document);
+    if(it != m_readers.constEnd())
+        return it.value();
+
+    // Created by the owner thread, the buffer's state isn't ours to read
+    auto req = std::make_shared<QHexWorkerRequest>();
+
+    QMetaObject::invokeMethod(
+        const_cast<QHexDocument*>(document),
+        [req, document]() {
+            QHexBuffer* reader = document->createReader();
+
+            QMutexLocker locker(&req->mutex);
+            req->reader = reader;
+            req->done = true;
+            req->cond.wakeAll();
+        },
+        Qt::QueuedConnection);
+
+    QHexBuffer* reader = nullptr;
+
+    if(this->waitFor(req)) {
+        QMutexLocker locker(&req->mutex);
+        std::swap(reader, req->reader);
+    }
+
+    // Asked once, reads fall back to the owner thread from now on
+    m_readers.insert(document, reader);
+    return reader;
+}
+
+void QHexWorker::releaseReaders() {
+    qDeleteAll(m_readers);
+    m_readers.clear();
+}
+
+bool QHexWorker::waitFor(const std::shared_ptr<QHexWorkerRequest>& req) {
+    {
+        QMutexLocker locker(&m_requestmutex);
+        m_request = req;
+    }
+
+    bool done = false;
+
+    {
+        // cancel() wakes it up under the same mutex, no wakeup is lost
+        QMutexLocker locker(&req->mutex);
+
+        while(!req->done && !this->isCancelled())
+            req->cond.wait(&req->mutex);
+
+        done = req->done;
+    }
+
+    QMutexLocker locker(&m_requestmutex);
+    m_request.reset();
+    return done;
+}
@@ -0,0 +1,89 @@
+#include <QBuffer>
+#include <QHexView/qhexmimedata.h>
+
+QHexMimeData::QHexMimeData(const QHexView* hexview, qint64 offset,
+                           qint64 length, QHexExportFormat format,
+                           const QHexCopyFormat& cf)
+    : QMimeData{}, m_hexview{const_cast<QHexView*>(hexview)},
+      m_hexdocument{hexview->hexDocument()}, m_copyformat{cf},
+      m_offset{offset}, m_length{length}, m_format{format} {
+    if(!m_hexdocument) {
+        m_valid = false;
+        return;
+    }
+
+    connect(m_hexdocument, &QHexDocument::dataChanged, this,
+            [this](const QByteArray& data, quint64 offset,
+                   QHexChangeReason reason) {
+                this->checkChange(static_cast<qint64>(offset), data.size(),
+                                  reason);
+            });
+
+    connect(m_hexdocument, &QHexDocument::reset, this,
+            [this]() { m_valid = false; });
+}
+
+bool QHexMimeData::isValid() const {
+    // The view does the formatting, its document must be the same
+    return m_valid && m_hexview && m_hexdocument &&
+           m_hexview->hexDocument() == m_hexdocument;
+}
+
+QStringList QHexMimeData::formats() const {
+    if(!this->isValid() && m_data.isNull())
+        return {};
+
+    QStringList f = {QStringLiteral("text/plain")};
+    if(m_format == QHexExportFormat::Raw)
+        f.append(QStringLiteral("application/octet-stream"));
+    return f;
+}
+
+bool QHexMimeData::hasFormat(const QString& mimetype) const {
+    return this->formats().contains(mimetype);
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+QVariant QHexMimeData::retrieveData(const QString& mimetype,
+                                    QMetaType type) const {
+#else
+QVariant QHexMimeData::retrieveData(const QString& mimetype,
+                                    QVariant::Type type) const {
+#endif
+    Q_UNUSED(type);
+
+    if(!this->hasFormat(mimetype) || !this->exportData())
+        return QVariant{};
+
+    return m_data;
+}
+
+bool QHexMimeData::exportData() const {
+    if(!m_data.isNull())
+        return true;
+    if(!this->isValid())
+        return false;
+
+    QBuffer buffer;
+    buffer.open(QBuffer::WriteOnly);
+
+    if(!m_hexview->exportRange(&buffer, m_offset, m_length, m_format,
+                               m_copyformat))
+        return false;
+
+    m_data = buffer.data();
+    return true;
+}
+
+void QHexMimeData::checkChange(qint64 offset, qint64 length,
+                               QHexChangeReason reason) {
+    if(!m_data.isNull())
+        return; // Already exported
+
+    // Inserts and removals move everything after them
+    if(offset >= m_offset + m_length ||
+       (reason == QHexChangeReason::Replace && offset + length <= m_offset))
+        return;
+
+    m_valid = false;
+}
@@ -0,0 +1,197 @@
+#include <QHexView/model/qhexblockstats.h>
+#include <QHexView/qhexminimap.h>
+#include <QHexView/qhexview.h>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+
+namespace {
+
+// Repaints are coalesced while the statistics are being computed
+const int UPDATE_DELAY_MS = 100;
+const int MINIMAP_WIDTH = 48;
+
+// Byte classes: zeros, control, printable ASCII and high bit set
+const QColor ZERO_COLOR{0x00, 0x00, 0x00};
+const QColor CONTROL_COLOR{0x4d, 0xaf, 0x4a};
+const QColor PRINTABLE_COLOR{0x37, 0x7e, 0xb8};
+const QColor HIGH_COLOR{0xe4, 0x1a, 0x1c};
+
+} // namespace
+
+QHexMinimap::QHexMinimap(QHexView* hexview)
+    : QWidget{hexview}, m_hexview{hexview} {
+    this->setCursor(Qt::PointingHandCursor);
+
+    m_updatetimer.setSingleShot(true);
+    m_updatetimer.setInterval(UPDATE_DELAY_MS);
+    connect(&m_updatetimer, &QTimer::timeout, this,
+            [this]() { this->update(); });
+
+    connect(hexview->verticalScrollBar(), &QScrollBar::valueChanged, this,
+            [this](int) { this->update(); });
+}
+
+QHexView* QHexMinimap::hexView() const { return m_hexview; }
+QHexBlockStats* QHexMinimap::blockStats() const { return m_blockstats; }
+QHexMinimap::Mode QHexMinimap::mode() const { return m_mode; }
+
+void QHexMinimap::setMode(Mode mode) {
+    m_mode = mode;
+    this->update();
+}
+
+void QHexMinimap::setBlockStats(QHexBlockStats* stats) {
+    if(m_blockstats == stats)
+        return;
+
+    if(m_blockstats)
+        disconnect(m_blockstats, &QHexBlockStats::updated, this, nullptr);
+
+    m_blockstats = stats;
+
+    if(m_blockstats) {
+        connect(m_blockstats, &QHexBlockStats::updated, this, [this]() {
+            if(!m_updatetimer.isActive())
+                m_updatetimer.start();
+        });
+    }
+
+    this->update();
+}
+
+QSize QHexMinimap::sizeHint() const { return QSize{MINIMAP_WIDTH, 0}; }
+
+QColor QHexMinimap::blockColor(const QHexBlockStat& s) const {
+    switch(m_mode) {
+        case Mode::Entropy:
+            return QColor::fromHsv(240 - s.entropy * 240 / 255, 255, 255);
+
+        case Mode::Zeros:
+        case Mode::Printable: {
+            QColor c = this->palette().color(QPalette::Highlight);
+            c.setAlpha(m_mode == Mode::Zeros ? s.zeros : s.printable);
+            return c;
+        }
+
+        default: break;
+    }
+
+    // Mix of the class colors, weighted by their ratio
+    int control = qMax(255 - s.zeros - s.printable - s.high, 0);
+    int r = 0, g = 0, b = 0;
+
+    const QPair<int, QColor> CLASSES[] = {
+        {s.zeros, ZERO_COLOR},
+        {control, CONTROL_COLOR},
+        {s.printable, PRINTABLE_COLOR},
+        {s.high, HIGH_COLOR},
+    };
+
+    for(const auto& cls : CLASSES) {
+        r += cls.first * cls.second.red();
+        g += cls.first * cls.second.green();
+        b += cls.first * cls.second.blue();
+    }
+
+    return QColor{qMin(r / 255, 255), qMin(g / 255, 255), qMin(b / 255, 255)};
+}
+
+int QHexMinimap::yFromOffset(qint64 offset) const {
+    qint64 length = m_hexview->hexDocument()->length();
+    if(length <= 0)
+        return 0;
+
+    return static_cast<int>(offset * this->height() / length);
+}
+
+void QHexMinimap::scrollTo(int y) {
+    qint64 length = m_hexview->hexDocument()->length();
+    unsigned int linelength = m_hexview->lineLength();
+    if(length <= 0 || !linelength || this->height() <= 0)
+        return;
+
+    // Center the clicked line in the view
+    QScrollBar* vscroll = m_hexview->verticalScrollBar();
+    qint64 offset = length * qBound(0, y, this->height() - 1) / this->height();
+    qint64 line = offset / linelength - vscroll->pageStep() / 2;
+
+    vscroll->setValue(static_cast<int>(
+        qBound<qint64>(vscroll->minimum(), line, vscroll->maximum())));
+}
+
+void QHexMinimap::paintEvent(QPaintEvent*) {
+    QPainter painter(this);
+    painter.fillRect(this->rect(), this->palette().color(QPalette::Base));
+
+    qint64 length = m_hexview->hexDocument()->length();
+    int h = this->height();
+
+    if(!m_blockstats || !m_blockstats->count() || length <= 0 || h <= 0)
+        return;
+
+    qint64 blocksize = m_blockstats->blockSize();
+    int count = m_blockstats->count();
+
+    // Each row averages the blocks it covers, large blocks span many rows
+    for(int y = 0; y < h; y++) {
+        qint64 begin = length * y / h;
+        qint64 end = qMax(length * (y + 1) / h, begin + 1);
+        int first = static_cast<int>(begin / blocksize);
+        int last = static_cast<int>(qMin<qint64>((end - 1) / blocksize,
+                                                 count - 1));
+
+        int sum[4] = {}, n = 0;
+        bool dirty = false;
+
+        for(int i = first; i <= last; i++, n++) {
+            QHexBlockStat s = m_blockstats->at(i);
+            sum[0] += s.entropy;
+            sum[1] += s.zeros;
+            sum[2] += s.printable;
+            sum[3] += s.high;
+            dirty = dirty || m_blockstats->isDirty(i);
+        }
+
+        if(!n || (dirty && !sum[0] && !sum[1] && !sum[2] && !sum[3]))
+            continue; // Not computed yet
+
+        QHexBlockStat avg{static_cast<quint8>(sum[0] / n),
+                          static_cast<quint8>(sum[1] / n),
+                          static_cast<quint8>(sum[2] / n),
+                          static_cast<quint8>(sum[3] / n)};
+
+        QColor c = this->blockColor(avg);
+        if(dirty) // Stale, waiting for the rescan
+            c.setAlpha(c.alpha() / 2);
+
+        painter.fillRect(0, y, this->width(), 1, c);
+    }
+
+    // Visible part of the document
+    const QScrollBar* vscroll = m_hexview->verticalScrollBar();
+    qint64 linelength = m_hexview->lineLength();
+    qint64 voffset = vscroll->value() * linelength;
+    qint64 vlength = (vscroll->pageStep() + 1) * linelength;
+
+    int y1 = this->yFromOffset(voffset);
+    int y2 = qMax(this->yFromOffset(voffset + vlength), y1 + 2);
+    QColor hl = this->palette().color(QPalette::Highlight);
+
+    painter.setPen(hl);
+    hl.setAlpha(64);
+    painter.fillRect(0, y1, this->width(), y2 - y1, hl);
+    painter.drawRect(0, y1, this->width() - 1, y2 - y1 - 1);
+}
+
+void QHexMinimap::mousePressEvent(QMouseEvent* e) {
+    QWidget::mousePressEvent(e);
+    if(e->button() == Qt::LeftButton)
+        this->scrollTo(e->pos().y());
+}
+
+void QHexMinimap::mouseMoveEvent(QMouseEvent* e) {
+    QWidget::mouseMoveEvent(e);
+    if(e->buttons() & Qt::LeftButton)
+        this->scrollTo(e->pos().y());
+}
@@ -4,11 +4,15 @@
 #include <QHexView/model/buffer/qmemorybuffer.h>
 #include <QHexView/model/qhexcursor.h>
 #include <QHexView/model/qhexutils.h>
+#include <QHexView/qhexmimedata.h>
+#include <QHexView/qhexminimap.h>
 #include <QHexView/qhexview.h>
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPalette>
 #include <QScrollBar>
+#include <QStyle>
+#include <QStyleOptionSlider>
 #include <QToolTip>
 #include <QWheelEvent>
 #include <QtGlobal>
@@ -28,6 +32,16 @@
 
 namespace {
 
+// Bytes read from the document per export step
+const qint64 EXPORT_CHUNK = 1 << 20;
+
+// Selections above this size go to the clipboard through QHexMimeData
+const qint64 LAZY_COPY_SIZE = 16 << 20;
+
+bool write_all(QIODevice* device, const QByteArray& data) {
+    return device->write(data) == static_cast<qint64>(data.size());
+}
+
 void merge_formats(QHexCharFormat& dst, const QHexCharFormat& src) {
     if(dst.background == Qt::NoBrush)
         dst.background = src.background;
@@ -138,12 +152,15 @@ QHexView::QHexView(QWidget* parent)
     this->setFocusPolicy(Qt::StrongFocus);
     this->viewport()->setCursor(Qt::IBeamCursor);
 
-    connect(this->verticalScrollBar(), &QScrollBar::valueChanged, this,
-            [this](int) { this->viewport()->update(); });
+    m_scrolltimer.start();
+    this->verticalScrollBar()->installEventFilter(this); // Match markers
 
-    m_hexmetadata = new QHexMetadata(&m_options, this);
-    connect(m_hexmetadata, &QHexMetadata::changed, this,
-            [this]() { this->viewport()->update(); });
+    connect(this->verticalScrollBar(), &QScrollBar::valueChanged, this,
+            [this](int) {
+                this->prefetch();
+                this->syncScroll();
+                this->viewport()->update();
+            });
 
     m_hexcursor = new QHexCursor(&m_options, this);
     this->setDocument(
@@ -163,6 +180,11 @@ QHexView::QHexView(QWidget* parent)
     });
 }
 
+QHexView::~QHexView() {
+    if(m_hexdocument)
+        m_hexdocument->detachView(this);
+}
+
 QRectF QHexView::headerRect() const {
     if(m_options.hasFlag(QHexFlags::NoHeader))
         return QRectF{0, 0, 0, 0};
@@ -203,16 +225,24 @@ QHexCursor* QHexView::hexCursor() const {
     return m_hexdocument ? m_hexcursor : nullptr;
 }
 
-const QHexMetadata* QHexView::hexMetadata() const { return m_hexmetadata; }
+QHexDiff* QHexView::hexDiff() const { return m_hexdiff; }
+QHexView* QHexView::syncView() const { return m_syncview; }
+
+const QHexMetadata* QHexView::hexMetadata() const {
+    return m_hexdocument ? m_hexdocument->metadata() : nullptr;
+}
+
+const QHexMatches* QHexView::hexMatches() const { return &m_matches; }
+QHexMinimap* QHexView::minimap() const { return m_minimap; }
+
+QHexStats QHexView::stats() const {
+    return m_hexdocument ? m_hexdocument->stats() : QHexStats{};
+}
+
 QHexOptions QHexView::options() const { return m_options; }
 
 void QHexView::setOptions(const QHexOptions& options) {
-    auto oldlinelength = m_options.line_length;
     m_options = options;
-
-    if(oldlinelength != m_options.line_length)
-        m_hexmetadata->invalidate();
-
     this->checkAndUpdate();
 }
 
@@ -231,19 +261,39 @@ void QHexView::setDelegate(QHexDelegate* rd) {
     this->checkAndUpdate();
 }
 
+void QHexView::setDiff(QHexDiff* diff) {
+    if(m_hexdiff == diff)
+        return;
+
+    if(m_hexdiff)
+        disconnect(m_hexdiff, &QHexDiff::changed, this, nullptr);
+
+    m_hexdiff = diff;
+
+    if(m_hexdiff) {
+        connect(m_hexdiff, &QHexDiff::changed, this,
+                [this]() { this->viewport()->update(); });
+    }
+
+    this->viewport()->update();
+}
+
+void QHexView::setSyncView(QHexView* hexview) { m_syncview = hexview; }
+
 void QHexView::setDocument(QHexDocument* doc) {
     if(!doc)
         doc = QHexDocument::fromMemory<QMemoryBuffer>(QByteArray(), this);
-    if(!doc->parent())
-        doc->setParent(this);
 
     m_writing = false;
-    m_hexmetadata->clear();
     m_hexcursor->move(0);
 
     if(m_hexdocument) {
+        disconnect(m_hexdocument->metadata(), &QHexMetadata::changed, this,
+                   nullptr);
         disconnect(m_hexdocument, &QHexDocument::changed, this, nullptr);
         disconnect(m_hexdocument, &QHexDocument::dataChanged, this, nullptr);
+        disconnect(m_hexdocument, &QHexDocument::dataAvailable, this,
+                   nullptr);
         disconnect(m_hexdocument, &QHexDocument::reset, this, nullptr);
         disconnect(m_hexdocument, &QHexDocument::trackChangesChanged, this,
                    nullptr);
@@ -251,17 +301,42 @@ void QHexView::setDocument(QHexDocument* doc) {
                    nullptr);
     }
 
+    if(m_hexdocument != doc) {
+        doc->attachView(this);
+        if(m_hexdocument)
+            m_hexdocument->detachView(this);
+    }
+
     m_hexdocument = doc;
+    this->clearMatches();
+
+    if(m_minimap && !m_minimap->isHidden())
+        m_minimap->setBlockStats(m_hexdocument->blockStats());
+
+    connect(m_hexdocument->metadata(), &QHexMetadata::changed, this,
+            [this]() { this->viewport()->update(); });
 
     connect(m_hexdocument, &QHexDocument::reset, this, [this]() {
         m_writing = false;
+        this->clearMatches();
         m_hexcursor->move(0);
         this->checkAndUpdate(true);
+        this->prefetch();
     });
 
     connect(m_hexdocument, &QHexDocument::dataChanged, this,
             &QHexView::dataChanged);
 
+    // Inserts and removals move the data, matches aren't valid anymore
+    connect(m_hexdocument, &QHexDocument::dataChanged, this,
+            [this](const QByteArray&, quint64, QHexChangeReason reason) {
+                if(reason != QHexChangeReason::Replace)
+                    this->clearMatches();
+            });
+
+    connect(m_hexdocument, &QHexDocument::dataAvailable, this,
+            [this](qint64, qint64) { this->viewport()->update(); });
+
     connect(m_hexdocument, &QHexDocument::trackChangesChanged, this,
             &QHexView::trackChangesChanged);
 
@@ -272,6 +347,7 @@ void QHexView::setDocument(QHexDocument* doc) {
             [this]() { this->checkAndUpdate(true); });
 
     this->checkAndUpdate(true);
+    this->prefetch();
 }
 
 void QHexView::setData(const QByteArray& ba) { m_hexdocument->setData(ba); }
@@ -299,47 +375,86 @@ void QHexView::setByteBackground(quint8 b, const QBrush& c) {
 
 void QHexView::setMetadata(qint64 begin, qint64 end, const QColor& fg,
                            const QBrush& bg, const QString& comment) {
-    m_hexmetadata->setMetadata(begin, end, fg, bg, comment);
+    m_hexdocument->metadata()->setMetadata(begin, end, fg, bg, comment);
 }
 void QHexView::setForeground(qint64 begin, qint64 end, const QColor& fg) {
-    m_hexmetadata->setForeground(begin, end, fg);
+    m_hexdocument->metadata()->setForeground(begin, end, fg);
 }
 void QHexView::setBackground(qint64 begin, qint64 end, const QBrush& bg) {
-    m_hexmetadata->setBackground(begin, end, bg);
+    m_hexdocument->metadata()->setBackground(begin, end, bg);
 }
 void QHexView::setComment(qint64 begin, qint64 end, const QString& comment) {
-    m_hexmetadata->setComment(begin, end, comment);
+    m_hexdocument->metadata()->setComment(begin, end, comment);
 }
 void QHexView::setMetadataSize(qint64 begin, qint64 length, const QColor& fg,
                                const QBrush& bg, const QString& comment) {
-    m_hexmetadata->setMetadataSize(begin, length, fg, bg, comment);
+    m_hexdocument->metadata()->setMetadataSize(begin, length, fg, bg, comment);
 }
 void QHexView::setForegroundSize(qint64 begin, qint64 length,
                                  const QColor& fg) {
-    m_hexmetadata->setForegroundSize(begin, length, fg);
+    m_hexdocument->metadata()->setForegroundSize(begin, length, fg);
 }
 void QHexView::setBackgroundSize(qint64 begin, qint64 length,
                                  const QBrush& bg) {
-    m_hexmetadata->setBackgroundSize(begin, length, bg);
+    m_hexdocument->metadata()->setBackgroundSize(begin, length, bg);
 }
 void QHexView::setCommentSize(qint64 begin, qint64 length,
                               const QString& comment) {
-    m_hexmetadata->setCommentSize(begin, length, comment);
+    m_hexdocument->metadata()->setCommentSize(begin, length, comment);
 }
 void QHexView::removeMetadata(qint64 line) {
-    m_hexmetadata->removeMetadata(line);
+    m_hexdocument->metadata()->removeMetadata(line, m_options.line_length);
 }
 void QHexView::removeBackground(qint64 line) {
-    m_hexmetadata->removeBackground(line);
+    m_hexdocument->metadata()->removeBackground(line, m_options.line_length);
 }
 void QHexView::removeForeground(qint64 line) {
-    m_hexmetadata->removeForeground(line);
+    m_hexdocument->metadata()->removeForeground(line, m_options.line_length);
 }
 void QHexView::removeComments(qint64 line) {
-    m_hexmetadata->removeComments(line);
+    m_hexdocument->metadata()->removeComments(line, m_options.line_length);
+}
+void QHexView::unhighlight(qint64 line) {
+    m_hexdocument->metadata()->unhighlight(line, m_options.line_length);
+}
+void QHexView::clearMetadata() { m_hexdocument->metadata()->clear(); }
+
+void QHexView::setMatches(const QList<QPair<qint64, qint64>>& matches) {
+    m_matches.setMatches(matches);
+    this->viewport()->update();
+    this->verticalScrollBar()->update();
+}
+
+void QHexView::clearMatches() {
+    if(m_matches.isEmpty())
+        return;
+
+    m_matches.clear();
+    this->viewport()->update();
+    this->verticalScrollBar()->update();
+}
+
+void QHexView::setMinimapVisible(bool b) {
+    if(!m_minimap) {
+        if(!b)
+            return;
+        m_minimap = new QHexMinimap(this);
+    }
+
+    // Statistics are computed on first use and kept by the document
+    if(b)
+        m_minimap->setBlockStats(m_hexdocument->blockStats());
+
+    m_minimap->setVisible(b);
+    this->setViewportMargins(0, 0, b ? m_minimap->sizeHint().width() : 0, 0);
+    this->layoutMinimap();
+    this->checkState();
+}
+
+void QHexView::resetStats() {
+    if(m_hexdocument)
+        m_hexdocument->resetStats();
 }
-void QHexView::unhighlight(qint64 line) { m_hexmetadata->unhighlight(line); }
-void QHexView::clearMetadata() { m_hexmetadata->clear(); }
 
 #if defined(QHEXVIEW_ENABLE_DIALOGS)
 void QHexView::showFind() {
@@ -379,7 +494,21 @@ void QHexView::clear() {
 }
 
 void QHexView::cut(bool hex) {
-    this->copy(hex);
+    if(m_readonly || m_hexcursor->selectionLength() <= LAZY_COPY_SIZE)
+        this->copy(hex);
+    else {
+        // Removing it would empty the lazy copy, export it first
+        QHexMimeData* mimedata = this->createMimeData(
+            hex ? QHexExportFormat::Hex : QHexExportFormat::Raw);
+
+        if(!mimedata->exportData()) {
+            delete mimedata;
+            return;
+        }
+
+        qApp->clipboard()->setMimeData(mimedata);
+    }
+
     if(m_readonly)
         return;
 
@@ -394,57 +523,19 @@ void QHexView::copyVisual() const {
     QByteArray bytes = m_hexcursor->hasSelection() ? this->selectedBytes()
                                                    : this->visibleBytes();
 
-    auto nbytes = static_cast<qint64>(bytes.size());
+    // Address, groups, ASCII column and newline for every copied row
+    qint64 nlines = qMin<qint64>(this->visibleLines(),
+                                 static_cast<qint64>(this->lines() - line));
+    qint64 linelen = this->addressWidth() + (m_options.line_length * 4) +
+                     (m_options.line_length / m_options.group_length) + 2;
+
     QString s;
+    s.reserve(static_cast<int>(qMax<qint64>(nlines, 0) * linelen));
 
     for(qint64 i = 0, l = 0; line < this->lines() && l < this->visibleLines();
         l++, line++) {
-        quint64 address = line * m_options.line_length + this->baseAddress();
-        QString addrstr = QString::number(address, 16)
-                              .rightJustified(this->addressWidth(), '0')
-                              .toUpper();
-
-        s += addrstr;
-
-        for(unsigned int col = 0u; col < m_options.line_length;) {
-            s += " ";
-
-            for(unsigned int byteidx = 0u; byteidx < m_options.group_length;
-                byteidx++, col++) {
-                qint64 adjcol,
-                    pos = this->positionFromLineCol(line, col, adjcol);
-
-                if(m_hexdocument->accept(pos)) {
-                    s += (i + adjcol) >= nbytes
-                             ? "  "
-                             : QString{QHexUtils::toHex(
-                                           bytes[static_cast<unsigned int>(
-                                               i + adjcol)])
-                                           .toUpper()};
-                }
-                else
-                    s += QString(m_options.invalid_char).repeated(2);
-            }
-        }
-
-        s += " ";
-
-        for(unsigned int col = 0u; col < m_options.line_length; col++) {
-            qint64 adjcol, pos = this->positionFromLineCol(line, col, adjcol);
-
-            if(m_hexdocument->accept(pos)) {
-                s += (i + adjcol) >= nbytes
-                         ? QChar{' '}
-                         : (QChar::isPrint(bytes[static_cast<int>(i + adjcol)])
-                                ? QChar{bytes[static_cast<int>(i + adjcol)]}
-                                : m_options.unprintable_char);
-            }
-            else
-                s += m_options.invalid_char;
-        }
-
+        this->formatLine(s, bytes, i, line);
         i += m_options.line_length;
-        s += "\n";
 
         if(i >= bytes.size())
             break;
@@ -454,12 +545,25 @@ void QHexView::copyVisual() const {
 }
 
 void QHexView::copyFormat(const QHexCopyFormat& cf) const {
+    if(m_hexcursor->selectionLength() > LAZY_COPY_SIZE) {
+        qApp->clipboard()->setMimeData(
+            this->createMimeData(QHexExportFormat::Format, cf));
+        return;
+    }
+
     QByteArray bytes = m_hexcursor->hasSelection()
                            ? this->selectedBytes()
                            : m_hexdocument->read(m_hexcursor->offset(), 1);
 
+    qApp->clipboard()->setText(
+        this->formatBytes(cf, bytes, 0, bytes.size()));
+}
+
+QString QHexView::formatBytes(const QHexCopyFormat& cf,
+                              const QByteArray& bytes, qint64 index,
+                              qint64 total) const {
     const bool IS_LONG =
-        cf.line_break && (bytes.length() > m_options.line_length);
+        cf.line_break && (total > static_cast<qint64>(m_options.line_length));
     const QString INDENT_CHAR = cf.use_tabs ? "\t" : " ";
 
     QString indentstr;
@@ -469,18 +573,36 @@ void QHexView::copyFormat(const QHexCopyFormat& cf) const {
     else if(cf.indent > 0)
         indentstr = INDENT_CHAR.repeated(cf.indent);
 
+    const QString LINE_SEPARATOR = cf.trim_last_separator
+                                       ? qstring_rtrim(cf.separator)
+                                       : cf.separator;
+
+    qint64 nlines = cf.line_break ? (bytes.size() / m_options.line_length) : 0;
+    qint64 bytelen = cf.byte_prefix.size() + 2 + cf.byte_suffix.size() +
+                     cf.separator.size();
+    qint64 len = cf.prefix.size() + cf.suffix.size() +
+                 (bytes.size() * bytelen) +
+                 ((nlines + 2) * (indentstr.size() + 1));
+
     QString s;
-    s += cf.prefix;
+    s.reserve(static_cast<int>(len));
 
-    if(IS_LONG)
-        s += "\n" + indentstr;
+    if(!index) {
+        s += cf.prefix;
+
+        if(IS_LONG) {
+            s += QLatin1Char('\n');
+            s += indentstr;
+        }
+    }
+
+    for(int j = 0; j < bytes.size(); j++) {
+        qint64 i = index + j;
 
-    for(int i = 0; i < bytes.size(); i++) {
         if(i) {
             if(cf.line_break && !(i % m_options.line_length)) {
-                s += cf.trim_last_separator ? qstring_rtrim(cf.separator)
-                                            : cf.separator;
-                s += "\n";
+                s += LINE_SEPARATOR;
+                s += QLatin1Char('\n');
                 if(IS_LONG)
                     s += indentstr;
             }
@@ -489,27 +611,122 @@ void QHexView::copyFormat(const QHexCopyFormat& cf) const {
         }
 
         s += cf.byte_prefix;
-        s += QHexUtils::toHex(bytes[i]).toUpper();
+        s += QLatin1String(
+            QHexUtils::hexDigits(static_cast<quint8>(bytes.at(j)), true), 2);
         s += cf.byte_suffix;
     }
 
-    if(IS_LONG)
-        s += "\n";
+    if(index + bytes.size() >= total) {
+        if(IS_LONG)
+            s += "\n";
 
-    s += cf.suffix;
-    qApp->clipboard()->setText(s);
+        s += cf.suffix;
+    }
+
+    return s;
 }
 
 void QHexView::copy(bool hex) const {
     QClipboard* c = qApp->clipboard();
 
+    if(m_hexcursor->selectionLength() > LAZY_COPY_SIZE) {
+        c->setMimeData(this->createMimeData(hex ? QHexExportFormat::Hex
+                                                : QHexExportFormat::Raw));
+        return;
+    }
+
     QByteArray bytes = m_hexcursor->hasSelection()
                            ? this->selectedBytes()
                            : m_hexdocument->read(m_hexcursor->offset(), 1);
 
     if(hex)
-        bytes = QHexUtils::toHex(bytes, ' ').toUpper();
-    c->setText(bytes);
+        c->setText(QString::fromLatin1(QHexUtils::toHex(bytes, ' ', true)));
+    else
+        c->setText(bytes);
+}
+
+bool QHexView::exportSelection(QIODevice* device, QHexExportFormat format,
+                               const QHexCopyFormat& cf) const {
+    if(m_hexcursor->hasSelection()) {
+        return this->exportRange(device, m_hexcursor->selectionStartOffset(),
+                                 m_hexcursor->selectionLength(), format, cf);
+    }
+
+    return this->exportRange(device, m_hexcursor->offset(), 1, format, cf);
+}
+
+bool QHexView::exportRange(QIODevice* device, qint64 offset, qint64 length,
+                           QHexExportFormat format,
+                           const QHexCopyFormat& cf) const {
+    if(!m_hexdocument || !device || !device->isWritable())
+        return false;
+
+    offset = qBound<qint64>(0, offset, m_hexdocument->length());
+    length = qBound<qint64>(0, length, m_hexdocument->length() - offset);
+
+    if(!length) {
+        return format != QHexExportFormat::Format ||
+               write_all(device, this->formatBytes(cf, {}, 0, 0).toUtf8());
+    }
+
+    if(format == QHexExportFormat::Visual) {
+        auto linelen = static_cast<qint64>(m_options.line_length);
+        qint64 lastline = (offset + length - 1) / linelen;
+        qint64 chunklines = qMax<qint64>(1, EXPORT_CHUNK / linelen);
+
+        for(qint64 line = offset / linelen; line <= lastline;
+            line += chunklines) {
+            qint64 n = qMin(chunklines, lastline - line + 1);
+            QByteArray bytes = m_hexdocument->read(line * linelen, n * linelen);
+
+            QString s;
+            s.reserve(static_cast<int>(
+                n * (this->addressWidth() + (linelen * 4) +
+                     (linelen / m_options.group_length) + 2)));
+
+            for(qint64 l = 0; l < n; l++)
+                this->formatLine(s, bytes, l * linelen, line + l);
+
+            if(!write_all(device, s.toUtf8()))
+                return false;
+        }
+
+        return true;
+    }
+
+    for(qint64 i = 0; i < length; i += EXPORT_CHUNK) {
+        QByteArray bytes =
+            m_hexdocument->read(offset + i, qMin(EXPORT_CHUNK, length - i));
+
+        switch(format) {
+            case QHexExportFormat::Hex:
+                if(i && !write_all(device, QByteArray(1, ' ')))
+                    return false;
+                bytes = QHexUtils::toHex(bytes, ' ', true);
+                break;
+
+            case QHexExportFormat::Format:
+                bytes = this->formatBytes(cf, bytes, i, length).toUtf8();
+                break;
+
+            default: break;
+        }
+
+        if(!write_all(device, bytes))
+            return false;
+    }
+
+    return true;
+}
+
+QHexMimeData* QHexView::createMimeData(QHexExportFormat format,
+                                       const QHexCopyFormat& cf) const {
+    if(m_hexcursor->hasSelection()) {
+        return new QHexMimeData(this, m_hexcursor->selectionStartOffset(),
+                                m_hexcursor->selectionLength(), format, cf);
+    }
+
+    return new QHexMimeData(this, m_hexcursor->offset(), 1, format, cf);
 }
 
 void QHexView::paste(bool hex) {
@@ -517,13 +734,14 @@ void QHexView::paste(bool hex) {
         return;
 
     QClipboard* c = qApp->clipboard();
-    QByteArray pastedata = c->text().toUtf8();
-    if(pastedata.isEmpty())
+    QString text = c->text();
+    if(text.isEmpty())
         return;
 
+    QByteArray pastedata = hex ? QHexUtils::fromHex(text.toLatin1())
+                               : text.toUtf8();
+
     this->removeSelection();
-    if(hex)
-        pastedata = QByteArray::fromHex(pastedata);
 
     if(m_hexcursor->mode() == QHexCursor::Mode::Insert)
         m_hexdocument->insert(m_hexcursor->offset(), pastedata);
@@ -608,17 +826,46 @@ void QHexView::checkOptions() {
     if(m_options.group_length <= 1)
         m_options.group_length = 1;
 
+    this->checkGlyphs();
+
     if(!m_options.header_format.foreground.isValid()) {
         m_options.header_format.foreground =
             this->palette().color(QPalette::Normal, QPalette::Highlight);
     }
+
+    if(m_options.match_format.background == Qt::NoBrush)
+        m_options.match_format.background = QColor{0xff, 0xc8, 0x00};
+}
+
+void QHexView::checkGlyphs() {
+    if(!m_glyphs.hex[0].isEmpty() &&
+       m_glyphs.unprintable == m_options.unprintable_char &&
+       m_glyphs.invalid == m_options.invalid_char)
+        return;
+
+    for(int i = 0; i < 256; i++) {
+        auto b = static_cast<quint8>(i);
+        auto ch = static_cast<char>(b);
+
+        m_glyphs.hex[i] =
+            QString::fromLatin1(QHexUtils::hexDigits(b, true), 2);
+        m_glyphs.ascii[i] = QChar::isPrint(ch)
+                                ? QString(QChar{ch})
+                                : QString(m_options.unprintable_char);
+    }
+
+    m_glyphs.hexblank = QStringLiteral("  ");
+    m_glyphs.asciiblank = QStringLiteral(" ");
+    m_glyphs.hexinvalid = QString(m_options.invalid_char).repeated(2);
+    m_glyphs.asciiinvalid = QString(m_options.invalid_char);
+    m_glyphs.unprintable = m_options.unprintable_char;
+    m_glyphs.invalid = m_options.invalid_char;
 }
 
 void QHexView::setLineLength(unsigned int l) {
     if(l == m_options.line_length)
         return;
     m_options.line_length = l;
-    m_hexmetadata->invalidate();
     this->checkAndUpdate(true);
 }
 
@@ -648,6 +895,9 @@ void QHexView::checkState() {
                    ? this->verticalScrollBar()->width()
                    : 0;
 
+    if(m_minimap && !m_minimap->isHidden())
+        vw += m_minimap->sizeHint().width();
+
     qreal pad = vw + this->cellWidth();
 
     this->setMaximumWidth(m_autowidth ? qCeil(this->endColumnX()) + qCeil(pad)
@@ -709,6 +959,72 @@ void QHexView::ensureVisible() {
         this->viewport()->update();
 }
 
+void QHexView::syncScroll() {
+    if(!m_syncview || m_syncing || !m_hexdocument)
+        return;
+
+    // Map the first visible byte through the diff, if any
+    qint64 offset = static_cast<qint64>(this->verticalScrollBar()->value()) *
+                    m_options.line_length;
+
+    if(m_hexdiff)
+        offset = m_hexdiff->mapOffset(m_hexdocument, offset);
+
+    QHexView* hexview = m_syncview;
+    if(!hexview->m_options.line_length)
+        return;
+
+    hexview->m_syncing = true;
+    hexview->verticalScrollBar()->setValue(
+        static_cast<int>(offset / hexview->m_options.line_length));
+    hexview->m_syncing = false;
+}
+
+void QHexView::layoutMinimap() {
+    if(!m_minimap || m_minimap->isHidden())
+        return;
+
+    // Right of the viewport, in the space left by its margins
+    QRect r = this->viewport()->geometry();
+    m_minimap->setGeometry(r.right() + 1, r.top(),
+                           m_minimap->sizeHint().width(), r.height());
+}
+
+void QHexView::prefetch() {
+    static const qint64 READAHEAD_MS = 250;
+    static const qint64 MAX_READAHEAD_PAGES = 16;
+
+    if(!m_hexdocument || !m_options.line_length)
+        return;
+
+    int value = this->verticalScrollBar()->value();
+    qint64 delta = value - m_lastscroll;
+    qint64 elapsed = qMax<qint64>(m_scrolltimer.restart(), 1);
+    m_lastscroll = value;
+
+    // Extrapolate the scroll velocity (lines/ms) over the read-ahead window
+    qint64 vislines = qMax(this->visibleLines(true), 1);
+    qint64 ahead =
+        qBound<qint64>(vislines, qAbs(delta) * READAHEAD_MS / elapsed,
+                       vislines * MAX_READAHEAD_PAGES);
+
+    qint64 first = this->firstVisibleLine(), last = first + vislines;
+
+    if(delta > 0) {
+        m_hexdocument->prefetch(last * m_options.line_length,
+                                ahead * m_options.line_length);
+    }
+    else if(delta < 0) {
+        qint64 aheadfirst = qMax<qint64>(first - ahead, 0);
+        m_hexdocument->prefetch(aheadfirst * m_options.line_length,
+                                (first - aheadfirst) * m_options.line_length);
+    }
+
+    // Visible lines are requested last, they have the highest priority
+    m_hexdocument->prefetch(first * m_options.line_length,
+                            vislines * m_options.line_length);
+}
+
 void QHexView::drawSeparators(QPainter* p) const {
     if(!m_options.hasFlag(QHexFlags::Separators))
         return;
@@ -868,6 +1184,11 @@ void QHexView::drawDocument(PaintContext* ctx) const {
 
     ctx->painter->setClipRect(this->documentRect());
 
+    qint64 visoffset = this->firstVisibleLine() * m_options.line_length;
+    qint64 vislength = this->visibleLines() * m_options.line_length;
+
+    ctx->matches = m_matches.range(visoffset, visoffset + vislength);
+
     auto do_draw_document = [&](qint64 line) {
         // Draw background
         if(m_options.linealt_background.isValid() && line % 2)
@@ -877,7 +1198,17 @@ void QHexView::drawDocument(PaintContext* ctx) const {
 
         // Draw contents
         this->drawAddressPart(ctx, line);
-        QByteArray linebytes = this->getLine(line);
+
+        // Still loading (the read is queued, it never blocks): painted
+        // again when data becomes available
+        QByteArray linebytes = m_hexdocument->peek(
+            line * m_options.line_length, m_options.line_length);
+
+        if(linebytes.size() <= this->getLastColumn(line)) {
+            this->drawPlaceholderPart(ctx);
+            return;
+        }
+
         this->drawHexPart(ctx, linebytes, line);
         this->drawAsciiPart(ctx, linebytes, line);
     };
@@ -943,22 +1274,9 @@ void QHexView::drawHexPart(PaintContext* ctx, const QByteArray& linebytes,
 
         for(unsigned int byteidx = 0u; byteidx < m_options.group_length;
             byteidx++, col++) {
-            QString s;
             quint8 b{};
-            qint64 adjcol, pos = this->positionFromLineCol(line, col, adjcol);
-
-            if(m_hexdocument->accept(pos)) {
-                s = linebytes.isEmpty() ||
-                            adjcol >= static_cast<qint64>(linebytes.size())
-                        ? "  "
-                        : QString(QHexUtils::toHex(linebytes.mid(adjcol, 1))
-                                      .toUpper());
-                b = static_cast<int>(adjcol) < linebytes.size()
-                        ? linebytes.at(adjcol)
-                        : 0x00;
-            }
-            else
-                s = QString(m_options.invalid_char).repeated(2);
+            const QString& s =
+                this->cellText(QHexArea::Hex, linebytes, 0, line, col, &b);
 
             cf = this->drawFormat(ctx, b, s, QHexArea::Hex, line, col,
                                   static_cast<int>(col) < linebytes.size());
@@ -973,31 +1291,117 @@ void QHexView::drawHexPart(PaintContext* ctx, const QByteArray& linebytes,
 void QHexView::drawAsciiPart(PaintContext* ctx, const QByteArray& linebytes,
                              quint64 line) const {
     for(unsigned int col = 0u; col < m_options.line_length; col++) {
-        QString s;
         quint8 b{};
-        qint64 adjcol;
-
-        if(m_hexdocument->accept(
-               this->positionFromLineCol(line, col, adjcol))) {
-            s = linebytes.isEmpty() ||
-                        adjcol >= static_cast<qint64>(linebytes.size())
-                    ? QChar{' '}
-                    : (QChar::isPrint(linebytes.at(adjcol))
-                           ? QChar{linebytes.at(adjcol)}
-                           : m_options.unprintable_char);
-
-            b = static_cast<int>(adjcol) < linebytes.size()
-                    ? linebytes.at(adjcol)
-                    : 0x00;
-        }
-        else
-            s = m_options.invalid_char;
+        const QString& s =
+            this->cellText(QHexArea::Ascii, linebytes, 0, line, col, &b);
 
         this->drawFormat(ctx, b, s, QHexArea::Ascii, line, col,
                          static_cast<int>(col) < linebytes.size());
     }
 }
 
+void QHexView::drawMatchMarkers(QPainter* p) const {
+    const QScrollBar* vscroll = this->verticalScrollBar();
+    qint64 length = m_hexdocument ? m_hexdocument->length() : 0;
+
+    QStyleOptionSlider opt;
+    opt.initFrom(vscroll);
+    opt.orientation = Qt::Vertical;
+    opt.subControls = QStyle::SC_All;
+    opt.minimum = vscroll->minimum();
+    opt.maximum = vscroll->maximum();
+    opt.sliderPosition = vscroll->sliderPosition();
+    opt.sliderValue = vscroll->value();
+    opt.singleStep = vscroll->singleStep();
+    opt.pageStep = vscroll->pageStep();
+
+    QRect groove = vscroll->style()->subControlRect(
+        QStyle::CC_ScrollBar, &opt, QStyle::SC_ScrollBarGroove, vscroll);
+
+    if(length <= 0 || groove.height() <= 0)
+        return;
+
+    // One lookup per pixel row, however many matches there are
+    QColor c = m_options.match_format.background.color();
+    qint64 h = groove.height();
+
+    for(qint64 y = 0; y < h; y++) {
+        qint64 begin = length * y / h;
+        qint64 end = qMax(length * (y + 1) / h, begin + 1);
+
+        if(m_matches.intersects(begin, end)) {
+            p->fillRect(groove.left() + 2, groove.top() + static_cast<int>(y),
+                        groove.width() - 4, 2, c);
+        }
+    }
+}
+
+void QHexView::drawPlaceholderPart(PaintContext* ctx) const {
+    QHexCharFormat cf{};
+    cf.foreground =
+        this->palette().color(QPalette::Disabled, QPalette::WindowText);
+
+    const QString s = QString(m_options.placeholder_char).repeated(2);
+
+    for(unsigned int col = 0u; col < m_options.line_length;) {
+        for(unsigned int byteidx = 0u; byteidx < m_options.group_length;
+            byteidx++, col++)
+            ctx->drawText(s, cf);
+
+        ctx->drawText(" ", cf);
+    }
+
+    ctx->drawText(" ", {});
+    ctx->drawText(
+        QString(m_options.placeholder_char).repeated(m_options.line_length),
+        cf);
+}
+
+void QHexView::formatLine(QString& s, const QByteArray& bytes, qint64 offset,
+                          quint64 line) const {
+    quint64 address = line * m_options.line_length + this->baseAddress();
+
+    s += QString::number(address, 16)
+             .rightJustified(this->addressWidth(), '0')
+             .toUpper();
+
+    for(unsigned int col = 0u; col < m_options.line_length;) {
+        s += QLatin1Char(' ');
+
+        for(unsigned int byteidx = 0u; byteidx < m_options.group_length;
+            byteidx++, col++)
+            s += this->cellText(QHexArea::Hex, bytes, offset, line, col);
+    }
+
+    s += QLatin1Char(' ');
+
+    for(unsigned int col = 0u; col < m_options.line_length; col++)
+        s += this->cellText(QHexArea::Ascii, bytes, offset, line, col);
+
+    s += QLatin1Char('\n');
+}
+
+// Shared by painting and copy/export: a lookup in the glyph tables, the
+// byte value is returned in b when the cell holds one
+const QString& QHexView::cellText(QHexArea area, const QByteArray& bytes,
+                                  qint64 offset, quint64 line,
+                                  unsigned int col, quint8* b) const {
+    bool hex = area == QHexArea::Hex;
+    qint64 adjcol, pos = this->positionFromLineCol(line, col, adjcol);
+
+    if(!m_hexdocument->accept(pos))
+        return hex ? m_glyphs.hexinvalid : m_glyphs.asciiinvalid;
+    if(offset + adjcol >= static_cast<qint64>(bytes.size()))
+        return hex ? m_glyphs.hexblank : m_glyphs.asciiblank;
+
+    auto v = static_cast<quint8>(bytes.at(static_cast<int>(offset + adjcol)));
+
+    if(b)
+        *b = v;
+
+    return hex ? m_glyphs.hex[v] : m_glyphs.ascii[v];
+}
+
 unsigned int QHexView::calcAddressWidth() const {
     if(!m_hexdocument)
         return 0;
@@ -1017,8 +1421,21 @@ int QHexView::visibleLines(bool absolute) const {
     return absolute ? vl : qMin<int>(this->lines(), vl);
 }
 
+qint64 QHexView::firstVisibleLine() const {
+    if(this->atBottom())
+        return qMax<qint64>(0, this->lines() - this->visibleLines());
+    return this->verticalScrollBar()->value();
+}
+
 qint64 QHexView::getLastColumn(qint64 line) const {
-    return this->getLine(line).size() - 1;
+    if(!m_hexdocument)
+        return -1;
+
+    // From the length, painting calls it for every cell
+    qint64 offset = line * m_options.line_length;
+    return qBound<qint64>(0, m_hexdocument->length() - offset,
+                          m_options.line_length) -
+           1;
 }
 qint64 QHexView::lastLine() const { return qMax<qint64>(0, this->lines() - 1); }
 
@@ -1116,6 +1533,18 @@ qint64 QHexView::replace(const QVariant& oldvalue, const QVariant& newvalue,
     return res.first;
 }
 
+int QHexView::replaceAll(const QVariant& oldvalue, const QVariant& newvalue,
+                         QHexFindMode mode, unsigned int options) const {
+    return QHexUtils::replaceAll(this, oldvalue, newvalue, mode, options);
+}
+
+int QHexView::findAll(const QVariant& value, QHexFindMode mode,
+                      unsigned int options) {
+    auto matches = QHexUtils::findAll(this, value, mode, options);
+    this->setMatches(matches);
+    return matches.size();
+}
+
 qint64 QHexView::find(const QVariant& value, qint64 offset, QHexFindMode mode,
                       unsigned int options, QHexFindDirection fd) const {
     auto res = QHexUtils::find(this, value, offset, mode, options, fd);
@@ -1248,6 +1677,8 @@ QHexCharFormat QHexView::drawFormat(PaintContext* ctx, quint8 b,
     QHexCharFormat cf{}, selcf{};
     QHexPosition pos{line, column};
 
+    QHEXVIEW_PROFILE_COUNT(m_hexdocument->profiler(), DrawFormats, 1);
+
     if(applyformat) {
         auto offset = m_hexcursor->positionToOffset(pos);
         bool hasdelegate =
@@ -1257,9 +1688,24 @@ QHexCharFormat QHexView::drawFormat(PaintContext* ctx, quint8 b,
             auto it = m_options.byte_colors.find(b);
             if(it != m_options.byte_colors.end())
                 cf = *it;
+
+            qint64 holebegin, holeend;
+
+            if(m_hexdocument->holeAt(offset, holebegin, holeend)) {
+                QHexCharFormat hcf = m_options.hole_format;
+
+                if(!hcf.foreground.isValid()) {
+                    hcf.foreground = this->palette().color(
+                        QPalette::Disabled, QPalette::WindowText);
+                }
+
+                merge_formats(cf, hcf);
+            }
         }
 
-        const QHexMetadataLine* metadataline = m_hexmetadata->find(line);
+        const QHexMetadataLine* metadataline =
+            m_hexdocument->metadata()->find(line, m_options.line_length);
+        QHEXVIEW_PROFILE_COUNT(m_hexdocument->profiler(), MetadataLookups, 1);
 
         if(metadataline) {
             for(const QHexMetadataItem& metadata : *metadataline) {
@@ -1338,6 +1784,48 @@ QHexCharFormat QHexView::drawFormat(PaintContext* ctx, quint8 b,
         }
     }
 
+    if(m_hexdiff) {
+        qint64 offset = this->hexCursor()->positionToOffset(pos);
+
+        switch(m_hexdiff->reasonAt(m_hexdocument, offset)) {
+            case QHexChangeReason::Replace:
+                cf = m_options.trackchange_format_overwrite;
+                break;
+
+            case QHexChangeReason::Insert:
+                cf = m_options.trackchange_format_insert;
+                break;
+
+            case QHexChangeReason::Remove:
+                cf = m_options.trackchange_format_remove;
+                break;
+
+            default: break;
+        }
+    }
+
+    if(ctx->matches.first < ctx->matches.second) {
+        qint64 offset = this->hexCursor()->positionToOffset(pos);
+        int idx = m_matches.indexOf(offset, ctx->matches.first,
+                                    ctx->matches.second);
+
+        if(idx != -1) {
+            const QHexCharFormat& mcf = m_options.match_format;
+            cf.background = mcf.background;
+            cf.foreground =
+                mcf.foreground.isValid()
+                    ? mcf.foreground
+                    : this->getReadableColor(mcf.background.color());
+
+            if(mcf.underline.isValid())
+                cf.underline = mcf.underline;
+
+            if(offset < m_matches.end(idx) - 1 &&
+               column < this->getLastColumn(line))
+                selcf = cf;
+        }
+    }
+
     if(this->hexCursor()->isSelected(line, column)) {
         qint64 offset = this->hexCursor()->positionToOffset(pos);
         qint64 selend = this->hexCursor()->selectionEndOffset();
@@ -1661,8 +2149,11 @@ bool QHexView::event(QEvent* e) {
                         offset, this->getByte(offset), this);
                 }
 
-                if(comment.isEmpty())
-                    comment = m_hexmetadata->getComment(pos.line, pos.column);
+                if(comment.isEmpty()) {
+                    comment = m_hexdocument->metadata()->getComment(
+                        m_hexcursor->positionToOffset(pos),
+                        m_options.line_length);
+                }
 
                 if(!comment.isEmpty())
                     QToolTip::showText(helpevent->globalPos(), comment);
@@ -1678,15 +2169,32 @@ bool QHexView::event(QEvent* e) {
     return QAbstractScrollArea::event(e);
 }
 
+bool QHexView::eventFilter(QObject* o, QEvent* e) {
+    if(o == this->verticalScrollBar() && e->type() == QEvent::Paint &&
+       !m_matches.isEmpty()) {
+        o->event(e); // Draw the scrollbar first
+
+        QPainter painter(this->verticalScrollBar());
+        this->drawMatchMarkers(&painter);
+        return true;
+    }
+
+    return QAbstractScrollArea::eventFilter(o, e);
+}
+
 void QHexView::showEvent(QShowEvent* e) {
     QAbstractScrollArea::showEvent(e);
     this->checkAndUpdate(true);
+    this->prefetch();
 }
 
 void QHexView::paintEvent(QPaintEvent*) {
     if(!m_hexdocument)
         return;
 
+    QHEXVIEW_PROFILE_SCOPE(m_hexdocument->profiler(), "paint", PaintTime);
+    QHEXVIEW_PROFILE_COUNT(m_hexdocument->profiler(), Frames, 1);
+
     QPainter painter(this->viewport());
     painter.translate(-this->horizontalScrollBar()->value(), 0);
     painter.setFont(this->font());
@@ -1713,6 +2221,8 @@ void QHexView::paintEvent(QPaintEvent*) {
 void QHexView::resizeEvent(QResizeEvent* e) {
     this->checkState();
     QAbstractScrollArea::resizeEvent(e);
+    this->layoutMinimap();
+    this->prefetch(); // More lines may be visible
 }
 
 void QHexView::focusInEvent(QFocusEvent* e) {
@@ -1872,7 +2382,10 @@ QByteArray QHexView::getLine(qint64 line) const {
 }
 
 uchar QHexView::getByte(qint64 offset) const {
-    return m_hexdocument && offset < m_hexdocument->length()
-               ? m_hexdocument->at(offset)
-               : uchar{};
+    if(!m_hexdocument || offset >= m_hexdocument->length())
+        return uchar{};
+
+    // Zero while it's still loading, like the placeholders
+    QByteArray b = m_hexdocument->peek(offset, 1);
+    return b.isEmpty() ? uchar{} : static_cast<uchar>(b.at(0));
 }